@@ -0,0 +1,342 @@
+#include <Hinae/Matrix4.hpp>
+#include <Hinae/Transform.hpp>
+#include <Hinae/Bounds3.hpp>
+#include <Hinae/rng.hpp>
+#include <Hinae/physics.hpp>
+#include <Hinae/fresnel_table.hpp>
+#include <Hinae/sampling.hpp>
+#include <Hinae/equation.hpp>
+#include <Hinae/intersection.hpp>
+#include <Hinae/spectrum.hpp>
+
+#include <memory>
+
+#include "harness.hpp"
+
+using namespace Hinae;
+
+// 每个内核在几种批大小下分别测量：16基本在寄存器和L1中，1024在L1/L2中，65536会超出L2
+static constexpr usize SIZES[] = {16, 1024, 65536};
+
+template <std::floating_point T>
+static const char* type_name() { return std::is_same_v<T, f32> ? "f32" : "f64"; }
+
+template <std::floating_point T>
+static std::string name(const char* kernel, usize n)
+{
+    return std::string(kernel) + "/" + type_name<T>() + "/" + std::to_string(n);
+}
+
+// 固定种子，保证每次运行的输入完全相同
+template <std::floating_point T>
+static std::vector<T> uniform(usize n, T lo, T hi, std::uint64_t seed)
+{
+    PCG32 rng(seed);
+    std::vector<T> ret(n);
+    for(T& x : ret) x = lo + (hi - lo) * rng.get<T>();
+    return ret;
+}
+
+template <std::floating_point T>
+static std::vector<Matrix4<T>> matrices(usize n, std::uint64_t seed)
+{
+    const auto v = uniform<T>(n * 4, -1, 1, seed);
+    std::vector<Matrix4<T>> ret(n);
+    for(usize i = 0; i < n; i++)
+    {
+        const T* p = &v[i * 4];
+        ret[i] = Transform<T>::translate({p[0], p[1], p[2]})
+               * Transform<T>::template rotate<Axis::Y>(p[3] * 180)
+               * Transform<T>::scale(2 + p[0], 2 + p[1], 2 + p[2]);
+    }
+    return ret;
+}
+
+template <std::floating_point T>
+static std::vector<Bounds3<T>> boxes(usize n, std::uint64_t seed)
+{
+    const auto v = uniform<T>(n * 6, -10, 10, seed);
+    std::vector<Bounds3<T>> ret(n);
+    for(usize i = 0; i < n; i++)
+        ret[i] = Bounds3<T>({v[i * 6], v[i * 6 + 1], v[i * 6 + 2]}, {v[i * 6 + 3], v[i * 6 + 4], v[i * 6 + 5]});
+    return ret;
+}
+
+template <std::floating_point T>
+static std::vector<Point2<T>> points2(usize n, std::uint64_t seed)
+{
+    const auto v = uniform<T>(n * 2, 0, 1, seed);
+    std::vector<Point2<T>> ret(n);
+    for(usize i = 0; i < n; i++) ret[i] = {v[i * 2], v[i * 2 + 1]};
+    return ret;
+}
+
+template <std::floating_point T>
+static void register_matrix(Bench::Registry& r, usize n)
+{
+    r.add(name<T>("matrix4.mul", n), n, [a = matrices<T>(n, 1), b = matrices<T>(n, 2), out = std::vector<Matrix4<T>>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            for(usize i = 0; i < a.size(); i++) out[i] = a[i] * b[i];
+            Bench::do_not_optimize(out.data());
+        }
+    });
+
+    r.add(name<T>("matrix4.inverse", n), n, [a = matrices<T>(n, 3), out = std::vector<Matrix4<T>>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            for(usize i = 0; i < a.size(); i++) out[i] = a[i].inverse();
+            Bench::do_not_optimize(out.data());
+        }
+    });
+
+    r.add(name<T>("matrix4.adjugate", n), n, [a = matrices<T>(n, 4), out = std::vector<Matrix4<T>>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            for(usize i = 0; i < a.size(); i++) out[i] = a[i].adjugate();
+            Bench::do_not_optimize(out.data());
+        }
+    });
+}
+
+template <std::floating_point T>
+static void register_transform(Bench::Registry& r, usize n)
+{
+    const auto v = uniform<T>(n * 3, -10, 10, 5);
+    std::vector<Point3<T>> points(n);
+    for(usize i = 0; i < n; i++) points[i] = {v[i * 3], v[i * 3 + 1], v[i * 3 + 2]};
+
+    r.add(name<T>("transform.point", n), n, [m = matrices<T>(1, 6)[0], points, out = std::vector<Point3<T>>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            for(usize i = 0; i < points.size(); i++) out[i] = m * points[i];
+            Bench::do_not_optimize(out.data());
+        }
+    });
+
+    r.add(name<T>("transform.bounds", n), n, [m = Affine3<T>(matrices<T>(1, 7)[0]), b = boxes<T>(n, 8), out = std::vector<Bounds3<T>>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            transform<T>(m, b, out);
+            Bench::do_not_optimize(out.data());
+        }
+    });
+}
+
+template <std::floating_point T>
+static void register_bounds(Bench::Registry& r, usize n)
+{
+    // 光线从原点附近射向随机方向，大约一半的包围盒会被击中，分支预测器无法记住结果
+    const auto d = uniform<T>(3, -1, 1, 9);
+    const Ray3<T> ray({0, 0, 0}, Vector3<T>(d[0], d[1], d[2]).normalized());
+    r.add(name<T>("bounds3.intersect", n), n, [ray, b = boxes<T>(n, 10)](usize iterations)
+    {
+        const Vector3<T> inv_dir(ONE<T> / ray.direction.x, ONE<T> / ray.direction.y, ONE<T> / ray.direction.z);
+        for(usize it = 0; it < iterations; it++)
+        {
+            usize hits = 0;
+            for(const auto& box : b) hits += box.intersect(ray, inv_dir);
+            Bench::do_not_optimize(hits);
+        }
+    });
+}
+
+template <std::floating_point T>
+static void register_rng(Bench::Registry& r, usize n)
+{
+    r.add(name<T>("rng.pcg32", n), n, [rng = PCG32(11), out = std::vector<T>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            for(T& x : out) x = rng.get<T>();
+            Bench::do_not_optimize(out.data());
+        }
+    });
+
+    r.add(name<T>("rng.xoshiro128x8", n), n, [rng = Xoshiro128x8(12), out = std::vector<T>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            rng.fill(std::span<T>(out));
+            Bench::do_not_optimize(out.data());
+        }
+    });
+
+    // RNG不可复制，放在shared_ptr中让std::function可以复制这个闭包
+    r.add(name<T>("rng.mt19937", n), n, [rng = std::make_shared<RNG<T>>(13), out = std::vector<T>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            for(T& x : out) x = rng->get();
+            Bench::do_not_optimize(out.data());
+        }
+    });
+}
+
+template <std::floating_point T>
+static void register_fresnel(Bench::Registry& r, usize n)
+{
+    r.add(name<T>("fresnel.dielectric", n), n, [c = uniform<T>(n, -1, 1, 14), out = std::vector<T>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            Fresnel::dielectric<T>(c, T(1.5), out);
+            Bench::do_not_optimize(out.data());
+        }
+    });
+
+    r.add(name<T>("fresnel.conductor", n), n, [c = uniform<T>(n, 0, 1, 15), out = std::vector<T>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            Fresnel::conductor<T>(c, T(0.2), T(3.9), out);
+            Bench::do_not_optimize(out.data());
+        }
+    });
+
+    // 查找表只有f32版本
+    if constexpr(std::is_same_v<T, f32>)
+    {
+        r.add(name<T>("fresnel_table.eval", n), n, [table = FresnelTable<f32>::dielectric(1.5f), c = uniform<T>(n, -1, 1, 16), out = std::vector<T>(n)](usize iterations) mutable
+        {
+            for(usize it = 0; it < iterations; it++)
+            {
+                table.eval(std::span<const f32>(c), std::span<f32>(out));
+                Bench::do_not_optimize(out.data());
+            }
+        });
+    }
+}
+
+template <std::floating_point T>
+static void register_sampling(Bench::Registry& r, usize n)
+{
+    r.add(name<T>("sampling.cosine_hemisphere", n), n,
+          [u = points2<T>(n, 17), x = std::vector<T>(n), y = std::vector<T>(n), z = std::vector<T>(n), pdf = std::vector<T>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            sample_cosine_hemisphere<T>(u, Vector3SoA<T>(x, y, z), pdf);
+            Bench::do_not_optimize(pdf.data());
+        }
+    });
+}
+
+template <std::floating_point T>
+static void register_equation(Bench::Registry& r, usize n)
+{
+    r.add(name<T>("equation.quadratic", n), n,
+          [a = uniform<T>(n, -4, 4, 18), b = uniform<T>(n, -4, 4, 19), c = uniform<T>(n, -4, 4, 20),
+           x0 = std::vector<T>(n), x1 = std::vector<T>(n), count = std::vector<std::uint8_t>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            const usize solved = solve_quadratic<T>(a, b, c, x0, x1, count);
+            Bench::do_not_optimize(solved);
+        }
+    });
+}
+
+template <std::floating_point T>
+static void register_intersection(Bench::Registry& r, usize n)
+{
+    // 一条光线对n个球
+    {
+        auto cx = uniform<T>(n, -10, 10, 21), cy = uniform<T>(n, -10, 10, 22), cz = uniform<T>(n, 5, 50, 23);
+        auto radius = uniform<T>(n, T(0.1), 2, 24);
+        r.add(name<T>("intersect.ray_spheres", n), n, [cx, cy, cz, radius](usize iterations)
+        {
+            const SphereSoA<T> spheres{Point3SoA<const T>(cx, cy, cz), radius};
+            const Ray3<T> ray({0, 0, 0}, Vector3<T>(T(0.1), T(0.05), 1).normalized());
+            for(usize it = 0; it < iterations; it++)
+            {
+                const auto hit = intersect(ray, std::numeric_limits<T>::infinity(), spheres);
+                Bench::do_not_optimize(hit);
+            }
+        });
+    }
+
+    // n条光线对一个球，t_max每轮重置
+    {
+        auto ox = uniform<T>(n, -1, 1, 25), oy = uniform<T>(n, -1, 1, 26), oz = std::vector<T>(n, -5);
+        auto dx = uniform<T>(n, T(-0.2), T(0.2), 27), dy = uniform<T>(n, T(-0.2), T(0.2), 28), dz = std::vector<T>(n, 1);
+        r.add(name<T>("intersect.rays_sphere", n), n,
+              [ox, oy, oz, dx, dy, dz, t = std::vector<T>(n), nx = std::vector<T>(n), ny = std::vector<T>(n), nz = std::vector<T>(n)](usize iterations) mutable
+        {
+            const Sphere<T> sphere{{0, 0, 0}, 1};
+            for(usize it = 0; it < iterations; it++)
+            {
+                std::fill(t.begin(), t.end(), std::numeric_limits<T>::infinity());
+                const usize hits = intersect(Point3SoA<const T>(ox, oy, oz), Vector3SoA<const T>(dx, dy, dz), sphere, std::span<T>(t), Vector3SoA<T>(nx, ny, nz));
+                Bench::do_not_optimize(hits);
+            }
+        });
+    }
+}
+
+template <std::floating_point T>
+static void register_spectrum(Bench::Registry& r, usize n)
+{
+    // 每个元素是一个8波长的光谱：乘加后转换到XYZ
+    using S = SampledSpectrum<T, 8>;
+    std::vector<S> a(n), b(n);
+    std::vector<SampledWavelengths<T, 8>> w(n);
+    const auto v = uniform<T>(n * 17, 0, 1, 29);
+    for(usize i = 0; i < n; i++)
+    {
+        for(usize j = 0; j < 8; j++)
+        {
+            a[i].values[j] = v[i * 17 + j];
+            b[i].values[j] = v[i * 17 + 8 + j];
+        }
+        w[i] = SampledWavelengths<T, 8>::sample_uniform(v[i * 17 + 16]);
+    }
+
+    r.add(name<T>("spectrum.mul_add", n), n, [a, b, out = std::vector<S>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            for(usize i = 0; i < a.size(); i++) out[i] = a[i] * b[i] + a[i];
+            Bench::do_not_optimize(out.data());
+        }
+    });
+
+    r.add(name<T>("spectrum.to_xyz", n), n, [a, w, out = std::vector<Vector3<T>>(n)](usize iterations) mutable
+    {
+        for(usize it = 0; it < iterations; it++)
+        {
+            for(usize i = 0; i < a.size(); i++) out[i] = to_xyz(a[i], w[i]);
+            Bench::do_not_optimize(out.data());
+        }
+    });
+}
+
+template <std::floating_point T>
+static void register_all(Bench::Registry& r)
+{
+    for(usize n : SIZES)
+    {
+        register_matrix<T>(r, n);
+        register_transform<T>(r, n);
+        register_bounds<T>(r, n);
+        register_rng<T>(r, n);
+        register_fresnel<T>(r, n);
+        register_sampling<T>(r, n);
+        register_equation<T>(r, n);
+        register_intersection<T>(r, n);
+        register_spectrum<T>(r, n);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Bench::Registry registry;
+    register_all<f32>(registry);
+    register_all<f64>(registry);
+    return Bench::run(registry, argc, argv);
+}
@@ -0,0 +1,413 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "perf.hpp"
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// 微基准测试框架：预热、按时间自动确定迭代次数、多次采样取中位数，
+// 结果可以写成JSON，并和保存的基线做显著性检验来发现性能回归
+namespace Bench
+{
+
+// 阻止编译器把没有使用的结果优化掉
+template <typename T>
+inline void do_not_optimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+    _ReadWriteBarrier();
+#endif
+}
+
+// 运行一次基准，body(iterations)需要把测量的内核执行iterations次
+using Body = std::function<void(usize)>;
+
+struct Options
+{
+    std::string filter;         // 名字包含这个子串时才运行
+    std::string json;           // 结果写到这个文件
+    std::string baseline;       // 和这个文件中的结果比较
+    double threshold = 0.05;    // 中位数变慢超过5%并且统计显著才算回归
+    double alpha = 0.01;        // Mann-Whitney U检验的显著性水平
+    usize samples = 21;
+    double sample_time = 0.01;  // 每个样本至少运行的秒数
+    double warmup_time = 0.05;
+    bool list = false;
+    bool perf = true;           // 读取硬件计数器
+
+    static void usage()
+    {
+        std::cout << "usage: bench [--filter=S] [--json=FILE] [--compare=BASELINE] [--threshold=0.05]\n"
+                     "             [--alpha=0.01] [--samples=21] [--sample-time=0.01] [--warmup=0.05] [--list] [--no-perf]\n";
+    }
+
+    static std::optional<Options> parse(int argc, char** argv)
+    {
+        Options ret;
+        for(int i = 1; i < argc; i++)
+        {
+            const std::string_view arg = argv[i];
+            const auto value = [&](std::string_view key) -> std::optional<std::string>
+            {
+                if(arg.size() > key.size() && arg.substr(0, key.size()) == key && arg[key.size()] == '=')
+                    return std::string(arg.substr(key.size() + 1));
+                return std::nullopt;
+            };
+
+            if(arg == "--list")                          ret.list = true;
+            else if(arg == "--no-perf")                  ret.perf = false;
+            else if(auto v = value("--filter"))          ret.filter = *v;
+            else if(auto v = value("--json"))            ret.json = *v;
+            else if(auto v = value("--compare"))         ret.baseline = *v;
+            else if(auto v = value("--threshold"))       ret.threshold = std::stod(*v);
+            else if(auto v = value("--alpha"))           ret.alpha = std::stod(*v);
+            else if(auto v = value("--samples"))         ret.samples = std::max<usize>(3, std::stoul(*v));
+            else if(auto v = value("--sample-time"))     ret.sample_time = std::stod(*v);
+            else if(auto v = value("--warmup"))          ret.warmup_time = std::stod(*v);
+            else
+            {
+                usage();
+                return std::nullopt;
+            }
+        }
+        return ret;
+    }
+};
+
+// 每个样本是一轮计时折算出的单个元素耗时(ns)
+struct Result
+{
+    std::string name;
+    usize items = 0;
+    usize iterations = 0;
+    std::vector<double> samples;
+
+    double median = 0, mad = 0, mean = 0, stddev = 0, min = 0;
+
+    // 所有样本合计的计数器除以处理的元素总数
+    CounterValues per_item;
+
+    double ipc() const { return per_item[Counter::Instructions] / per_item[Counter::Cycles]; }
+
+    void summarize()
+    {
+        std::vector<double> sorted = samples;
+        std::sort(sorted.begin(), sorted.end());
+        const auto median_of = [](const std::vector<double>& v)
+        {
+            const usize n = v.size();
+            return n % 2 == 1 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+        };
+
+        median = median_of(sorted);
+        min = sorted.front();
+
+        // 中位数绝对偏差，乘1.4826后在正态分布下与标准差一致
+        std::vector<double> deviation(sorted.size());
+        for(usize i = 0; i < sorted.size(); i++)
+            deviation[i] = std::abs(sorted[i] - median);
+        std::sort(deviation.begin(), deviation.end());
+        mad = 1.4826 * median_of(deviation);
+
+        mean = 0;
+        for(double s : samples) mean += s;
+        mean /= static_cast<double>(samples.size());
+        stddev = 0;
+        for(double s : samples) stddev += (s - mean) * (s - mean);
+        stddev = std::sqrt(stddev / static_cast<double>(std::max<usize>(1, samples.size() - 1)));
+    }
+};
+
+// 双侧Mann-Whitney U检验(正态近似，秩相同时取平均秩)，返回p值
+// 不假设耗时服从正态分布，对偶尔被调度打断产生的离群样本不敏感
+inline double mann_whitney_p(const std::vector<double>& a, const std::vector<double>& b)
+{
+    const usize n1 = a.size(), n2 = b.size();
+    if(n1 == 0 || n2 == 0) return 1;
+
+    std::vector<std::pair<double, bool>> all;
+    all.reserve(n1 + n2);
+    for(double x : a) all.emplace_back(x, true);
+    for(double x : b) all.emplace_back(x, false);
+    std::sort(all.begin(), all.end(), [](const auto& l, const auto& r) { return l.first < r.first; });
+
+    double rank_a = 0, ties = 0;
+    for(usize i = 0; i < all.size();)
+    {
+        usize j = i;
+        while(j < all.size() && all[j].first == all[i].first) j++;
+        const double rank = (static_cast<double>(i + j) + 1) / 2;
+        for(usize k = i; k < j; k++)
+            if(all[k].second) rank_a += rank;
+        const double t = static_cast<double>(j - i);
+        ties += t * t * t - t;
+        i = j;
+    }
+
+    const double N1 = static_cast<double>(n1), N2 = static_cast<double>(n2), N = N1 + N2;
+    const double u = rank_a - N1 * (N1 + 1) / 2;
+    const double variance = N1 * N2 / 12 * ((N + 1) - ties / (N * (N - 1)));
+    if(variance <= 0) return 1;
+    const double z = (u - N1 * N2 / 2) / std::sqrt(variance);
+    return std::erfc(std::abs(z) / std::sqrt(2.0));
+}
+
+struct Registry
+{
+    struct Entry
+    {
+        std::string name;
+        usize items;
+        Body body;
+    };
+
+    std::vector<Entry> entries;
+
+    // items是body执行一次处理的元素个数，结果按单个元素的耗时报告
+    void add(std::string name, usize items, Body body)
+    {
+        entries.push_back({std::move(name), items, std::move(body)});
+    }
+};
+
+inline Result measure(const Registry::Entry& entry, const Options& options, PerfCounters* counters)
+{
+    using clock = std::chrono::steady_clock;
+    const auto seconds = [](clock::duration d) { return std::chrono::duration<double>(d).count(); };
+
+    // 预热：让缓存、分支预测和CPU频率稳定下来，同时估计单次迭代的耗时
+    usize warmup_iterations = 0;
+    const auto warmup_begin = clock::now();
+    do
+    {
+        entry.body(1);
+        warmup_iterations++;
+    } while(seconds(clock::now() - warmup_begin) < options.warmup_time);
+    const double per_iteration = seconds(clock::now() - warmup_begin) / static_cast<double>(warmup_iterations);
+
+    Result ret;
+    ret.name = entry.name;
+    ret.items = entry.items;
+    ret.iterations = std::max<usize>(1, static_cast<usize>(std::ceil(options.sample_time / per_iteration)));
+    ret.samples.reserve(options.samples);
+    if(counters) counters->start();
+    for(usize s = 0; s < options.samples; s++)
+    {
+        const auto begin = clock::now();
+        entry.body(ret.iterations);
+        const double ns = std::chrono::duration<double, std::nano>(clock::now() - begin).count();
+        ret.samples.push_back(ns / static_cast<double>(ret.iterations * ret.items));
+    }
+    if(counters)
+    {
+        ret.per_item = counters->stop();
+        for(double& v : ret.per_item.value)
+            v /= static_cast<double>(options.samples * ret.iterations * ret.items);
+    }
+    ret.summarize();
+    return ret;
+}
+
+inline void write_json(const std::string& path, const std::vector<Result>& results)
+{
+    std::ofstream out(path);
+    out.precision(6);
+    out << "{\n  \"version\": 1,\n";
+#if defined(__VERSION__)
+    out << "  \"compiler\": \"" << __VERSION__ << "\",\n";
+#endif
+#ifdef USE_SIMD
+    out << "  \"simd\": true,\n";
+#else
+    out << "  \"simd\": false,\n";
+#endif
+    out << "  \"benchmarks\": [\n";
+    for(usize i = 0; i < results.size(); i++)
+    {
+        const Result& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"items\": " << r.items << ", \"iterations\": " << r.iterations
+            << ", \"median_ns\": " << r.median << ", \"mad_ns\": " << r.mad << ", \"mean_ns\": " << r.mean
+            << ", \"stddev_ns\": " << r.stddev << ", \"min_ns\": " << r.min;
+        for(usize c = 0; c < COUNTER_COUNT; c++)
+            if(!std::isnan(r.per_item.value[c]))
+                out << ", \"" << COUNTER_NAMES[c] << "_per_item\": " << r.per_item.value[c];
+        if(!std::isnan(r.ipc()))
+            out << ", \"ipc\": " << r.ipc();
+        out << ", \"samples\": [";
+        for(usize s = 0; s < r.samples.size(); s++)
+            out << (s == 0 ? "" : ", ") << r.samples[s];
+        out << "]}" << (i + 1 == results.size() ? "\n" : ",\n");
+    }
+    out << "  ]\n}\n";
+}
+
+// 只读取write_json写出的格式：每个基准是一个不含嵌套对象的{...}
+inline std::vector<Result> read_json(const std::string& path)
+{
+    std::ifstream in(path);
+    std::stringstream buffer;
+    buffer << in.rdbuf();
+    const std::string text = buffer.str();
+
+    const auto field = [](std::string_view object, std::string_view key) -> std::string_view
+    {
+        // 不用operator+拼接，g++12在-O3下会误报-Wrestrict
+        std::string quoted;
+        quoted.reserve(key.size() + 3);
+        quoted += '"';
+        quoted += key;
+        quoted += "\":";
+        const usize at = object.find(quoted);
+        if(at == std::string_view::npos) return {};
+        usize begin = object.find_first_not_of(' ', at + quoted.size());
+        if(begin == std::string_view::npos) return {};
+        if(object[begin] == '"')
+            return object.substr(begin + 1, object.find('"', begin + 1) - begin - 1);
+        if(object[begin] == '[')
+            return object.substr(begin + 1, object.find(']', begin) - begin - 1);
+        return object.substr(begin, object.find_first_of(",}", begin) - begin);
+    };
+
+    std::vector<Result> ret;
+    for(usize at = text.find("{\"name\""); at != std::string::npos; at = text.find("{\"name\"", at + 1))
+    {
+        const std::string_view object = std::string_view(text).substr(at, text.find('}', at) - at + 1);
+        Result r;
+        r.name = std::string(field(object, "name"));
+        r.items = std::stoul(std::string(field(object, "items")));
+        std::stringstream samples{std::string(field(object, "samples"))};
+        for(std::string s; std::getline(samples, s, ',');)
+            r.samples.push_back(std::stod(s));
+        if(r.samples.empty()) continue;
+        r.summarize();
+        ret.push_back(std::move(r));
+    }
+    return ret;
+}
+
+// 有计数器时在右侧追加每个元素的周期、指令、缓存/分支未命中、向量指令数和IPC
+inline void print_header(bool perf)
+{
+    std::printf("%-44s %10s %12s %8s %14s", "benchmark", "items", "ns/item", "+-MAD", "Mitems/s");
+    if(perf) std::printf(" %10s %10s %10s %10s %10s %6s", "cyc/item", "ins/item", "llc/item", "brm/item", "vec/item", "IPC");
+    std::printf("\n");
+}
+
+inline void print(const Result& r, bool perf)
+{
+    std::printf("%-44s %10zu %12.3f %7.1f%% %14.2f", r.name.c_str(), r.items, r.median,
+                r.median > 0 ? 100 * r.mad / r.median : 0.0, r.median > 0 ? 1e3 / r.median : 0.0);
+    if(perf)
+    {
+        const auto column = [](double v, int width, int precision)
+        {
+            if(std::isnan(v)) std::printf(" %*s", width, "-");
+            else std::printf(" %*.*f", width, precision, v);
+        };
+        for(double v : r.per_item.value) column(v, 10, 3);
+        column(r.ipc(), 6, 2);
+    }
+    std::printf("\n");
+}
+
+// 返回回归的个数
+inline usize compare(const std::vector<Result>& current, const std::vector<Result>& baseline, const Options& options)
+{
+    usize regressions = 0;
+    std::printf("\n%-44s %12s %12s %9s %10s  %s\n", "benchmark", "base ns", "now ns", "change", "p", "verdict");
+    for(const Result& now : current)
+    {
+        const auto base = std::find_if(baseline.begin(), baseline.end(), [&](const Result& r) { return r.name == now.name; });
+        if(base == baseline.end())
+        {
+            std::printf("%-44s %12s %12.3f %9s %10s  new\n", now.name.c_str(), "-", now.median, "-", "-");
+            continue;
+        }
+
+        const double change = now.median / base->median - 1;
+        const double p = mann_whitney_p(now.samples, base->samples);
+        const bool significant = p < options.alpha;
+        const char* verdict = "same";
+        if(significant && change > options.threshold)
+        {
+            verdict = "REGRESSION";
+            regressions++;
+        }
+        else if(significant && change < -options.threshold)
+        {
+            verdict = "improved";
+        }
+        std::printf("%-44s %12.3f %12.3f %+8.1f%% %10.2g  %s\n", now.name.c_str(), base->median, now.median, 100 * change, p, verdict);
+    }
+    return regressions;
+}
+
+// 解析参数、运行、输出；有回归时返回1，可以直接作为CI的检查
+inline int run(Registry& registry, int argc, char** argv)
+{
+    const auto options = Options::parse(argc, argv);
+    if(!options) return 2;
+
+    if(options->list)
+    {
+        for(const auto& e : registry.entries) std::cout << e.name << '\n';
+        return 0;
+    }
+
+    std::optional<PerfCounters> counters;
+    if(options->perf)
+    {
+        counters.emplace();
+        if(!counters->available())
+        {
+            std::cerr << "perf counters unavailable: " << counters->reason() << ", reporting time only\n";
+            counters.reset();
+        }
+    }
+
+    std::vector<Result> results;
+    print_header(counters.has_value());
+    for(const auto& entry : registry.entries)
+    {
+        if(!options->filter.empty() && entry.name.find(options->filter) == std::string::npos) continue;
+        results.push_back(measure(entry, *options, counters ? &*counters : nullptr));
+        print(results.back(), counters.has_value());
+    }
+
+    if(!options->json.empty())
+        write_json(options->json, results);
+
+    if(!options->baseline.empty())
+    {
+        const auto baseline = read_json(options->baseline);
+        if(baseline.empty())
+        {
+            std::cerr << "cannot read baseline " << options->baseline << '\n';
+            return 2;
+        }
+        const usize regressions = compare(results, baseline, *options);
+        std::printf("\n%zu regression(s)\n", regressions);
+        return regressions == 0 ? 0 : 1;
+    }
+    return 0;
+}
+
+}
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// 用Linux perf_event_open读取硬件计数器，只统计用户态
+// 打不开的计数器(虚拟机、容器、perf_event_paranoid过高、非Linux)记为不可用，不影响计时
+namespace Bench
+{
+
+using usize = std::size_t;
+
+enum class Counter
+{
+    Cycles,
+    Instructions,
+    CacheMisses,
+    BranchMisses,
+    // 厂商相关的原始事件：Intel为FP_ARITH_INST_RETIRED的所有packed类型，AMD为FpRetSseAvxOps
+    VectorOps,
+    Count
+};
+
+inline constexpr usize COUNTER_COUNT = static_cast<usize>(Counter::Count);
+inline constexpr const char* COUNTER_NAMES[COUNTER_COUNT] = {"cycles", "instructions", "cache_misses", "branch_misses", "vector_ops"};
+
+// 一次测量中各计数器的总数，不可用的计数器为NaN
+struct CounterValues
+{
+    std::array<double, COUNTER_COUNT> value;
+
+    CounterValues() { value.fill(std::numeric_limits<double>::quiet_NaN()); }
+
+    double operator [] (Counter c) const { return value[static_cast<usize>(c)]; }
+    double& operator [] (Counter c) { return value[static_cast<usize>(c)]; }
+
+    bool any() const
+    {
+        for(double v : value)
+            if(!std::isnan(v)) return true;
+        return false;
+    }
+};
+
+class PerfCounters
+{
+#if defined(__linux__)
+    std::array<int, COUNTER_COUNT> fd;
+    int error = 0;
+
+    static int open(std::uint32_t type, std::uint64_t config)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        // 计数器数量不够时内核会分时复用，读出enabled/running时间后按比例还原
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    // 没有通用的向量指令事件，只识别两家常见厂商的原始编码
+    static std::uint64_t vector_event()
+    {
+        std::ifstream cpuinfo("/proc/cpuinfo");
+        for(std::string line; std::getline(cpuinfo, line);)
+        {
+            if(line.rfind("vendor_id", 0) != 0) continue;
+            if(line.find("GenuineIntel") != std::string::npos) return 0xFCC7;
+            if(line.find("AuthenticAMD") != std::string::npos) return 0xFF03;
+            break;
+        }
+        return 0;
+    }
+
+public:
+    PerfCounters()
+    {
+        fd[0] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        error = fd[0] < 0 ? errno : 0;
+        fd[1] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fd[2] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+        fd[3] = open(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+        const std::uint64_t raw = vector_event();
+        fd[4] = raw != 0 ? open(PERF_TYPE_RAW, raw) : -1;
+    }
+
+    ~PerfCounters()
+    {
+        for(int f : fd)
+            if(f >= 0) close(f);
+    }
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator = (const PerfCounters&) = delete;
+
+    bool available() const
+    {
+        for(int f : fd)
+            if(f >= 0) return true;
+        return false;
+    }
+
+    // 不可用的原因，用于提示用户
+    std::string reason() const
+    {
+        if(error == ENOENT || error == EOPNOTSUPP)
+            return "no hardware PMU exposed (virtual machine or container?)";
+        if(error == EACCES || error == EPERM)
+            return "permission denied, try lowering /proc/sys/kernel/perf_event_paranoid";
+        return error == 0 ? "" : std::strerror(error);
+    }
+
+    void start()
+    {
+        for(int f : fd)
+        {
+            if(f < 0) continue;
+            ioctl(f, PERF_EVENT_IOC_RESET, 0);
+            ioctl(f, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+
+    CounterValues stop()
+    {
+        for(int f : fd)
+            if(f >= 0) ioctl(f, PERF_EVENT_IOC_DISABLE, 0);
+
+        CounterValues ret;
+        for(usize i = 0; i < COUNTER_COUNT; i++)
+        {
+            std::uint64_t data[3];   // value, time_enabled, time_running
+            if(fd[i] < 0 || read(fd[i], data, sizeof(data)) != sizeof(data) || data[2] == 0) continue;
+            ret.value[i] = static_cast<double>(data[0]) * (static_cast<double>(data[1]) / static_cast<double>(data[2]));
+        }
+        return ret;
+    }
+#else
+public:
+    bool available() const { return false; }
+    std::string reason() const { return "perf_event_open is only available on Linux"; }
+    void start() {}
+    CounterValues stop() { return {}; }
+#endif
+};
+
+}
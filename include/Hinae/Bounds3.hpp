@@ -3,6 +3,7 @@
 #include "Vector3.hpp"
 #include "Point3.hpp"
 #include "Ray3.hpp"
+#include "stats.hpp"
 
 NAMESPACE_BEGIN(Hinae)
 
@@ -24,15 +25,19 @@ struct Bounds3
         : p_min(min(p1, p2))
         , p_max(max(p1, p2)) {}
 
-    const Point3<T>& operator [] (usize i) const
+    constexpr const Point3<T>& operator [] (usize i) const
     {
         assert(i < 2);
+        if(std::is_constant_evaluated())
+            return i == 0 ? p_min : p_max;
         return (&p_min)[i];
     }
 
-    Point3<T>& operator [] (usize i)
+    constexpr Point3<T>& operator [] (usize i)
     {
         assert(i < 2);
+        if(std::is_constant_evaluated())
+            return i == 0 ? p_min : p_max;
         return (&p_min)[i];
     }
 
@@ -71,7 +76,25 @@ struct Bounds3
         const T enter = min(min_t, max_t).max_component();
         const T exit  = max(min_t, max_t).min_component();
 
-        return enter <= exit && exit > 0;
+        const bool hit = enter <= exit && exit > 0;
+        Stats::count<Stat::RayBoxTests>();
+        Stats::count<Stat::RayBoxHits>(hit);
+        return hit;
+    }
+
+    // 只接受t_max之前的交点，遍历BVH时用当前最近的交点裁剪
+    constexpr bool intersect(const Ray3<T> &ray, const Vector3<T>& inv_dir, T t_max) const
+    {
+        const Vector3<T> min_t = (p_min - ray.origin) * inv_dir;
+        const Vector3<T> max_t = (p_max - ray.origin) * inv_dir;
+
+        const T enter = min(min_t, max_t).max_component();
+        const T exit  = max(min_t, max_t).min_component();
+
+        const bool hit = enter <= exit && exit > 0 && enter < t_max;
+        Stats::count<Stat::RayBoxTests>();
+        Stats::count<Stat::RayBoxHits>(hit);
+        return hit;
     }
 };
 
@@ -102,6 +125,14 @@ overlaps(const Bounds3<T>& b1, const Bounds3<T>& b2)
     return x && y && z;
 }
 
+template <arithmetic T> constexpr bool
+contains(const Bounds3<T>& outer, const Bounds3<T>& inner)
+{
+    return outer.p_min.x <= inner.p_min.x && inner.p_max.x <= outer.p_max.x
+        && outer.p_min.y <= inner.p_min.y && inner.p_max.y <= outer.p_max.y
+        && outer.p_min.z <= inner.p_min.z && inner.p_max.z <= outer.p_max.z;
+}
+
 template <arithmetic T>
 std::ostream& operator << (std::ostream& os, const Bounds3<T>& b)
 {
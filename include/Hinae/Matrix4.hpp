@@ -87,15 +87,20 @@ public:
         };
     }
 
-    Matrix4<T> operator * (const Matrix4<T>& rhs) const
+    constexpr Matrix4<T> operator * (const Matrix4<T>& rhs) const
 	{
 		Matrix4<T> ret;
 #ifdef USE_SIMD
+        // simd只支持float，编译期求值和其他类型走下面的标量实现
         if constexpr(std::is_same_v<f32, T>)
-            sse_matrix4x4_mul(data, rhs.data, ret.data);
-        else
-            static_assert(false, "simd only support float type");
-#else
+        {
+            if(!std::is_constant_evaluated())
+            {
+                sse_matrix4x4_mul(data, rhs.data, ret.data);
+                return ret;
+            }
+        }
+#endif
         const Matrix4<T>& lhs = *this;
         T sum;
 		for(usize i = 0; i < 4; i++)
@@ -110,7 +115,6 @@ public:
                 ret[i][j] = sum;
             }
         }
-#endif
 		return ret;
 	}
 
@@ -121,37 +125,37 @@ public:
 
         Index(const Index&) = delete;
         Index(Index&&) = delete;
-        ~Index() = default;
+        constexpr ~Index() = default;
         Index& operator = (const Index&) = delete;
         Index& operator = (Index&&) = delete;
 
-        Index(Matrix4<T>& m, usize i): m(m), i(i) { assert(i < 4); }
+        constexpr Index(Matrix4<T>& m, usize i): m(m), i(i) { assert(i < 4); }
 
-        operator T () const { return m.data[i]; }
+        constexpr operator T () const { return m.data[i]; }
 
-        Index& operator [] (usize index)
+        constexpr Index& operator [] (usize index)
 		{
 			assert(index < 4);
 			i = i * 4 + index;
 			return *this;
 		}
 
-		Index& operator = (T x)
+		constexpr Index& operator = (T x)
 		{
 			m.data[i] = x;
 			return *this;
 		}
 
-		Index& operator += (T x)
+		constexpr Index& operator += (T x)
 		{
 			m.data[i] += x;
 			return *this;
 		}
     };
 
-    Index operator [] (usize index) { return { *this, index }; }
+    constexpr Index operator [] (usize index) { return { *this, index }; }
 
-    Index operator [] (usize index) const
+    constexpr Index operator [] (usize index) const
     {
         return
         {
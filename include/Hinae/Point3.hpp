@@ -7,8 +7,9 @@ NAMESPACE_BEGIN(Hinae)
 using Point3f = Point3<f32>;
 using Point3d = Point3<f64>;
 using Point3i = Point3<isize>;
+using Point3h = Point3<f16>;
 
-template <arithmetic T>
+template <storage T>
 struct Point3
 {
     T x, y, z;
@@ -16,7 +17,7 @@ struct Point3
     constexpr Point3(T v) : x(v), y(v), z(v) {}
     constexpr Point3(T x, T y, T z) : x(x), y(y), z(z) {}
 
-    template <arithmetic U>
+    template <storage U>
     constexpr explicit Point3(const Point3<U>& p)
         : x(static_cast<T>(p.x))
         , y(static_cast<T>(p.y))
@@ -31,26 +32,30 @@ struct Point3
 
     constexpr Point3<T> operator += (const Vector3<T>& v) { x += v.x; y += v.y; z += v.z; }
 
-    T operator [] (usize i) const
+    constexpr T operator [] (usize i) const
     { 
         assert(i <= 2);
+        if(std::is_constant_evaluated())
+            return i == 0 ? x : (i == 1 ? y : z);
         return (&x)[i];
     }
     
-    T& operator [] (usize i)
+    constexpr T& operator [] (usize i)
     { 
         assert(i <= 2);
+        if(std::is_constant_evaluated())
+            return i == 0 ? x : (i == 1 ? y : z);
         return (&x)[i];
     }
 
-    T operator [] (Axis axis) const
+    constexpr T operator [] (Axis axis) const
     { 
-        return (&x)[static_cast<usize>(axis)];
+        return (*this)[static_cast<usize>(axis)];
     }
 
-    T& operator [] (Axis axis)
+    constexpr T& operator [] (Axis axis)
     { 
-        return (&x)[static_cast<usize>(axis)];
+        return (*this)[static_cast<usize>(axis)];
     }
 };
 
@@ -72,7 +77,7 @@ constexpr T distance2(const Point3<T>& lhs, const Point3<T>& rhs)
     return (lhs - rhs).norm2();
 }
 
-template <arithmetic T>
+template <storage T>
 std::ostream& operator << (std::ostream& os, const Point3<T>& v)
 {
     return os << std::make_tuple(v.x, v.y, v.z);
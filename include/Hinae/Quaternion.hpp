@@ -42,19 +42,19 @@ struct Quaternion
 
     static constexpr Quaternion<T> pure(const Vector3<T>& v) { return {ZERO<T>, v}; }
 
-    static Quaternion<T> rotate(T angle, const Vector3<T>& v)
+    static constexpr Quaternion<T> rotate(T angle, const Vector3<T>& v)
     {
         const T a = angle / 2;
-        return {std::cos(a), v * std::sin(a)};
+        return {cos(a), v * sin(a)};
     }
 
     constexpr Quaternion<T> conjugate() const { return {real, -image}; }
 
     constexpr T norm2() const { return real * real + image.norm2(); }
 
-    T norm() const { return std::sqrt(norm2()); }
+    constexpr T norm() const { return static_cast<T>(sqrt(norm2())); }
 
-    Quaternion<T> normalized() const { return (*this) * reciprocal(norm()); }
+    constexpr Quaternion<T> normalized() const { return (*this) * reciprocal(norm()); }
 
     constexpr Quaternion<T> inverse() const { return conjugate() * reciprocal(norm2()); }
 };
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <span>
+
+#include "Vector3.hpp"
+#include "Point3.hpp"
+#include "Point2.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+// 非拥有的SoA视图，x/y/z分别指向三段等长的连续内存
+// 批量函数在这种布局上可以直接被编译器向量化
+template <arithmetic T>
+struct Vector3SoA
+{
+    using value_type = std::remove_const_t<T>;
+
+    std::span<T> x, y, z;
+
+    constexpr Vector3SoA() = default;
+    constexpr Vector3SoA(std::span<T> x, std::span<T> y, std::span<T> z)
+        : x(x), y(y), z(z)
+    {
+        assert(x.size() == y.size() && x.size() == z.size());
+    }
+
+    template <arithmetic U>
+        requires std::is_const_v<T> && std::same_as<const U, T>
+    constexpr Vector3SoA(const Vector3SoA<U>& v) : x(v.x), y(v.y), z(v.z) {}
+
+    constexpr usize size() const { return x.size(); }
+
+    constexpr Vector3<value_type> operator [] (usize i) const { return {x[i], y[i], z[i]}; }
+
+    constexpr void set(usize i, const Vector3<value_type>& v) const
+        requires (!std::is_const_v<T>)
+    {
+        x[i] = v.x; y[i] = v.y; z[i] = v.z;
+    }
+};
+
+template <arithmetic T>
+struct Point3SoA
+{
+    using value_type = std::remove_const_t<T>;
+
+    std::span<T> x, y, z;
+
+    constexpr Point3SoA() = default;
+    constexpr Point3SoA(std::span<T> x, std::span<T> y, std::span<T> z)
+        : x(x), y(y), z(z)
+    {
+        assert(x.size() == y.size() && x.size() == z.size());
+    }
+
+    template <arithmetic U>
+        requires std::is_const_v<T> && std::same_as<const U, T>
+    constexpr Point3SoA(const Point3SoA<U>& p) : x(p.x), y(p.y), z(p.z) {}
+
+    constexpr usize size() const { return x.size(); }
+
+    constexpr Point3<value_type> operator [] (usize i) const { return {x[i], y[i], z[i]}; }
+
+    constexpr void set(usize i, const Point3<value_type>& p) const
+        requires (!std::is_const_v<T>)
+    {
+        x[i] = p.x; y[i] = p.y; z[i] = p.z;
+    }
+};
+
+template <arithmetic T>
+struct Point2SoA
+{
+    using value_type = std::remove_const_t<T>;
+
+    std::span<T> x, y;
+
+    constexpr Point2SoA() = default;
+    constexpr Point2SoA(std::span<T> x, std::span<T> y)
+        : x(x), y(y)
+    {
+        assert(x.size() == y.size());
+    }
+
+    template <arithmetic U>
+        requires std::is_const_v<T> && std::same_as<const U, T>
+    constexpr Point2SoA(const Point2SoA<U>& p) : x(p.x), y(p.y) {}
+
+    constexpr usize size() const { return x.size(); }
+
+    constexpr Point2<value_type> operator [] (usize i) const { return {x[i], y[i]}; }
+
+    constexpr void set(usize i, const Point2<value_type>& p) const
+        requires (!std::is_const_v<T>)
+    {
+        x[i] = p.x; y[i] = p.y;
+    }
+};
+
+NAMESPACE_END(Hinae)
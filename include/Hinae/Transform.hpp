@@ -1,5 +1,7 @@
 #pragma once
 
+#include <span>
+
 #include "Quaternion.hpp"
 #include "Bounds3.hpp"
 #include "Matrix4.hpp"
@@ -7,6 +9,7 @@
 #include "Point3.hpp"
 #include "Point4.hpp"
 #include "Ray3.hpp"
+#include "stats.hpp"
 
 NAMESPACE_BEGIN(Hinae)
 
@@ -53,21 +56,182 @@ constexpr Ray3<T> operator * (const Matrix4<T>& lhs, const Ray3<T>& rhs)
     };
 }
 
+// 仿射变换的3x4形式，省去恒为(0, 0, 0, 1)的最后一行
+template <arithmetic T>
+struct Affine3
+{
+    T m[3][4];
+
+    constexpr Affine3() = default;
+
+    constexpr explicit Affine3(const Matrix4<T>& matrix)
+    {
+        for(usize i = 0; i < 3; i++)
+            for(usize j = 0; j < 4; j++)
+                m[i][j] = matrix[i][j];
+    }
+
+    constexpr Matrix4<T> matrix() const
+    {
+        return
+        {
+            m[0][0], m[0][1], m[0][2], m[0][3],
+            m[1][0], m[1][1], m[1][2], m[1][3],
+            m[2][0], m[2][1], m[2][2], m[2][3],
+            ZERO<T>, ZERO<T>, ZERO<T>, ONE<T>
+        };
+    }
+};
+
+template <arithmetic T>
+constexpr bool is_affine(const Matrix4<T>& m)
+{
+    return is_zero<T>(m[3][0]) && is_zero<T>(m[3][1]) && is_zero<T>(m[3][2]) && is_one<T>(m[3][3]);
+}
+
+// Arvo 1990, "Transforming Axis-Aligned Bounding Boxes"
+template <arithmetic T>
+constexpr Bounds3<T> operator * (const Affine3<T>& lhs, const Bounds3<T>& rhs)
+{
+    Bounds3<T> ret;
+    for(usize i = 0; i < 3; i++)
+    {
+        T lo = lhs.m[i][3], hi = lhs.m[i][3];
+        for(usize j = 0; j < 3; j++)
+        {
+            const T a = lhs.m[i][j] * rhs.p_min[j];
+            const T b = lhs.m[i][j] * rhs.p_max[j];
+            lo += min(a, b);
+            hi += max(a, b);
+        }
+        ret.p_min[i] = lo;
+        ret.p_max[i] = hi;
+    }
+    return ret;
+}
+
+// 透视矩阵下包围盒不再保持轴对齐，变换八个顶点后取包围盒
+// 只要有顶点落在w <= 0的一侧，投影后的范围就是无界的，直接返回整个空间
+template <arithmetic T>
+constexpr Bounds3<T> projective_transform(const Matrix4<T>& lhs, const Bounds3<T>& rhs)
+{
+    constexpr T highest = std::numeric_limits<T>::has_infinity ? std::numeric_limits<T>::infinity() : MAX_NUMBER<T>;
+    constexpr T lowest  = std::numeric_limits<T>::has_infinity ? -highest : std::numeric_limits<T>::lowest();
+
+    Point3<T> lo{highest}, hi{lowest};
+    for(usize i = 0; i < 8; i++)
+    {
+        const Point4<T> p = lhs * Point4<T>{rhs[i & 1].x, rhs[(i >> 1) & 1].y, rhs[i >> 2].z, ONE<T>};
+        if(p.w <= ZERO<T>)
+            return {Point3<T>{lowest}, Point3<T>{highest}};
+        const Point3<T> q{p.x / p.w, p.y / p.w, p.z / p.w};
+        lo = min(lo, q);
+        hi = max(hi, q);
+    }
+    return {lo, hi};
+}
+
 template <arithmetic T>
 constexpr Bounds3<T> operator * (const Matrix4<T>& lhs, const Bounds3<T>& rhs)
 {
-    const Vector3<T> xa = lhs.column(0) * rhs.p_min.x;
-    const Vector3<T> xb = lhs.column(0) * rhs.p_max.x;
-    const Vector3<T> ya = lhs.column(1) * rhs.p_min.y;
-    const Vector3<T> yb = lhs.column(1) * rhs.p_max.y;
-    const Vector3<T> za = lhs.column(2) * rhs.p_min.z;
-    const Vector3<T> zb = lhs.column(2) * rhs.p_max.z;
-    const auto translate = as<Point3, T>(lhs.column(3));
-    return
+    if(is_affine(lhs))
+        return Affine3<T>{lhs} * rhs;
+    else
+        return projective_transform(lhs, rhs);
+}
+
+#ifdef USE_SIMD
+// 每次处理4个包围盒：把AoS的24个f32转置成6个SoA寄存器，每个寄存器是4个包围盒的同一个分量
+// 矩阵元素广播到寄存器，Arvo的每一项对4个包围盒同时计算，累加顺序与标量版本相同，结果逐位一致
+inline void sse_transform_bounds(const Affine3<f32>& lhs, std::span<const Bounds3<f32>> from, std::span<Bounds3<f32>> to)
+{
+    static_assert(sizeof(Bounds3<f32>) == 6 * sizeof(f32));
+
+    __m128 m[3][4];
+    for(usize i = 0; i < 3; i++)
+        for(usize j = 0; j < 4; j++)
+            m[i][j] = _mm_set1_ps(lhs.m[i][j]);
+
+    usize i = 0;
+    for(; i + 4 <= from.size(); i += 4)
     {
-        translate + (min(xa, xb) + min(ya, yb) + min(za, zb)),
-        translate + (max(xa, xb) + max(ya, yb) + max(za, zb))
-    };
+        // 包围盒a、b、c、d，每个6个分量
+        const f32* src = &from[i].p_min.x;
+        const __m128 v0 = _mm_loadu_ps(src),      v1 = _mm_loadu_ps(src + 4),  v2 = _mm_loadu_ps(src + 8);
+        const __m128 v3 = _mm_loadu_ps(src + 12), v4 = _mm_loadu_ps(src + 16), v5 = _mm_loadu_ps(src + 20);
+
+        // (a0 a1 b0 b1) (a2 a3 b2 b3) (a4 a5 b4 b5)，c、d同理
+        const __m128 p0 = _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 2, 1, 0)), q0 = _mm_shuffle_ps(v0, v2, _MM_SHUFFLE(1, 0, 3, 2));
+        const __m128 r0 = _mm_shuffle_ps(v1, v2, _MM_SHUFFLE(3, 2, 1, 0));
+        const __m128 p1 = _mm_shuffle_ps(v3, v4, _MM_SHUFFLE(3, 2, 1, 0)), q1 = _mm_shuffle_ps(v3, v5, _MM_SHUFFLE(1, 0, 3, 2));
+        const __m128 r1 = _mm_shuffle_ps(v4, v5, _MM_SHUFFLE(3, 2, 1, 0));
+
+        const __m128 lo_in[3]{_mm_shuffle_ps(p0, p1, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(p0, p1, _MM_SHUFFLE(3, 1, 3, 1)),
+                              _mm_shuffle_ps(q0, q1, _MM_SHUFFLE(2, 0, 2, 0))};
+        const __m128 hi_in[3]{_mm_shuffle_ps(q0, q1, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(r0, r1, _MM_SHUFFLE(2, 0, 2, 0)),
+                              _mm_shuffle_ps(r0, r1, _MM_SHUFFLE(3, 1, 3, 1))};
+
+        __m128 lo[3], hi[3];
+        for(usize r = 0; r < 3; r++)
+        {
+            lo[r] = hi[r] = m[r][3];
+            for(usize c = 0; c < 3; c++)
+            {
+                const __m128 x = _mm_mul_ps(m[r][c], lo_in[c]);
+                const __m128 y = _mm_mul_ps(m[r][c], hi_in[c]);
+                lo[r] = _mm_add_ps(lo[r], _mm_min_ps(x, y));
+                hi[r] = _mm_add_ps(hi[r], _mm_max_ps(x, y));
+            }
+        }
+
+        // 转置回AoS
+        const __m128 s0 = _mm_unpacklo_ps(lo[0], lo[1]), s1 = _mm_unpackhi_ps(lo[0], lo[1]);
+        const __m128 t0 = _mm_unpacklo_ps(lo[2], hi[0]), t1 = _mm_unpackhi_ps(lo[2], hi[0]);
+        const __m128 u0 = _mm_unpacklo_ps(hi[1], hi[2]), u1 = _mm_unpackhi_ps(hi[1], hi[2]);
+        f32* dst = &to[i].p_min.x;
+        _mm_storeu_ps(dst,      _mm_movelh_ps(s0, t0));
+        _mm_storeu_ps(dst + 4,  _mm_shuffle_ps(u0, s0, _MM_SHUFFLE(3, 2, 1, 0)));
+        _mm_storeu_ps(dst + 8,  _mm_movehl_ps(u0, t0));
+        _mm_storeu_ps(dst + 12, _mm_movelh_ps(s1, t1));
+        _mm_storeu_ps(dst + 16, _mm_shuffle_ps(u1, s1, _MM_SHUFFLE(3, 2, 1, 0)));
+        _mm_storeu_ps(dst + 20, _mm_movehl_ps(u1, t1));
+    }
+    for(; i < from.size(); i++)
+        to[i] = lhs * from[i];
+}
+#endif
+
+template <arithmetic T>
+void transform(const Affine3<T>& lhs, std::span<const Bounds3<T>> from, std::span<Bounds3<T>> to)
+{
+    assert(from.size() == to.size());
+    Stats::batch<Stat::TransformedBounds>(from.size());
+#ifdef USE_SIMD
+    if constexpr(std::is_same_v<f32, T>)
+    {
+        sse_transform_bounds(lhs, from, to);
+        return;
+    }
+#endif
+    for(usize i = 0; i < from.size(); i++)
+        to[i] = lhs * from[i];
+}
+
+// 仿射矩阵走批量Arvo，透视矩阵逐个变换顶点
+template <arithmetic T>
+void transform(const Matrix4<T>& lhs, std::span<const Bounds3<T>> from, std::span<Bounds3<T>> to)
+{
+    assert(from.size() == to.size());
+    if(is_affine(lhs))
+    {
+        transform(Affine3<T>{lhs}, from, to);
+    }
+    else
+    {
+        Stats::batch<Stat::TransformedBounds>(from.size());
+        for(usize i = 0; i < from.size(); i++)
+            to[i] = projective_transform(lhs, from[i]);
+    }
 }
 
 template <arithmetic T>
@@ -114,11 +278,11 @@ struct Transform
     }
 
     template <Axis axis>
-    static Matrix4<T> rotate(T degree)
+    static constexpr Matrix4<T> rotate(T degree)
     {
         const T radian = to_radian(degree);
-        const T s = std::sin(radian);
-        const T c = std::cos(radian);
+        const T s = sin(radian);
+        const T c = cos(radian);
         if constexpr(axis == Axis::X)
         {
             return
@@ -181,10 +345,9 @@ struct Transform
         };
     }
 
-    static Matrix4<T> perspective(T fov, T aspect, T z_near, T z_far)
+    static constexpr Matrix4<T> perspective(T fov, T aspect, T z_near, T z_far)
     {
-		const T tan = std::tan(to_radian(fov / 2));
-		const T cot = 1 / tan;
+		const T cot = 1 / tan(to_radian(fov / 2));
 
         const T a11 = cot / aspect;
         const T a22 = cot;
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <span>
+
 #include "Vector3.hpp"
+#include "SoA.hpp"
 
 NAMESPACE_BEGIN(Hinae)
 
@@ -19,25 +22,25 @@ constexpr T cos_to_sin2(T cos)
 template <arithmetic T>
 constexpr T sin2_to_cos(T sin2)
 {
-    return std::sqrt(ONE<T> - sin2);
+    return sqrt(ONE<T> - sin2);
 }
 
 template <arithmetic T>
 constexpr T cos2_to_sin(T cos2)
 {
-    return std::sqrt(ONE<T> - cos2);
+    return sqrt(ONE<T> - cos2);
 }
 
 template <arithmetic T>
 constexpr T sin_to_cos(T sin)
 {
-    return std::sqrt(sin_to_cos2(sin));
+    return sqrt(sin_to_cos2(sin));
 }
 
 template <arithmetic T>
 constexpr T cos_to_sin(T cos)
 {
-    return std::sqrt(cos_to_sin2(cos));
+    return sqrt(cos_to_sin2(cos));
 }
 
 NAMESPACE_BEGIN(Local)
@@ -57,7 +60,7 @@ constexpr T cos2_theta(const Vector3<T>& v)
 template <arithmetic T>
 constexpr T abs_cos_theta(const Vector3<T>& v)
 {
-    return std::abs(cos_theta(v));
+    return fabs(cos_theta(v));
 }
 
 template <arithmetic T>
@@ -112,4 +115,78 @@ constexpr T sin2_phi(const Vector3<T>& v)
 
 NAMESPACE_END(Local)
 
+// 一次算好theta和phi的三角函数，之后的访问不再开方
+// 取值与Local::中的同名函数一致，可以直接替换
+template <std::floating_point T>
+struct LocalDirection
+{
+private:
+    Vector3<T> w;
+    T cos2_theta_, sin2_theta_, sin_theta_;
+    T cos_phi_, sin_phi_;
+
+public:
+    constexpr LocalDirection() = default;
+
+    constexpr LocalDirection(const Vector3<T>& w)
+        : w(w)
+        , cos2_theta_(w.z * w.z)
+        , sin2_theta_(cos_to_sin2(w.z))
+        , sin_theta_(sqrt(sin2_theta_))
+    {
+        const bool degenerate = is_zero(sin_theta_);
+        const T inv = degenerate ? ZERO<T> : ONE<T> / sin_theta_;
+        cos_phi_ = degenerate ? ONE<T> : clamp(-ONE<T>, w.x * inv, ONE<T>);
+        sin_phi_ = degenerate ? ONE<T> : clamp(-ONE<T>, w.y * inv, ONE<T>);
+    }
+
+    constexpr const Vector3<T>& direction() const { return w; }
+
+    constexpr T cos_theta() const { return w.z; }
+    constexpr T cos2_theta() const { return cos2_theta_; }
+    constexpr T abs_cos_theta() const { return fabs(w.z); }
+    constexpr T sin_theta() const { return sin_theta_; }
+    constexpr T sin2_theta() const { return sin2_theta_; }
+    constexpr T tan_theta() const { return sin_theta_ / w.z; }
+    constexpr T tan2_theta() const { return sin2_theta_ / cos2_theta_; }
+
+    constexpr T cos_phi() const { return cos_phi_; }
+    constexpr T sin_phi() const { return sin_phi_; }
+    constexpr T cos2_phi() const { return cos_phi_ * cos_phi_; }
+    constexpr T sin2_phi() const { return sin_phi_ * sin_phi_; }
+};
+
+template <std::floating_point T>
+void make_local_directions(std::span<const Vector3<T>> w, std::span<LocalDirection<T>> out)
+{
+    assert(out.size() == w.size());
+    for(usize i = 0; i < w.size(); i++)
+        out[i] = LocalDirection<T>(w[i]);
+}
+
+template <std::floating_point T>
+void make_local_directions(Vector3SoA<const T> w, std::span<LocalDirection<T>> out)
+{
+    assert(out.size() == w.size());
+    for(usize i = 0; i < w.size(); i++)
+        out[i] = LocalDirection<T>(w[i]);
+}
+
+NAMESPACE_BEGIN(Local)
+
+// 让同一份BSDF代码既可以传Vector3也可以传LocalDirection
+template <std::floating_point T> constexpr T cos_theta(const LocalDirection<T>& v) { return v.cos_theta(); }
+template <std::floating_point T> constexpr T cos2_theta(const LocalDirection<T>& v) { return v.cos2_theta(); }
+template <std::floating_point T> constexpr T abs_cos_theta(const LocalDirection<T>& v) { return v.abs_cos_theta(); }
+template <std::floating_point T> constexpr T sin_theta(const LocalDirection<T>& v) { return v.sin_theta(); }
+template <std::floating_point T> constexpr T sin2_theta(const LocalDirection<T>& v) { return v.sin2_theta(); }
+template <std::floating_point T> constexpr T tan_theta(const LocalDirection<T>& v) { return v.tan_theta(); }
+template <std::floating_point T> constexpr T tan2_theta(const LocalDirection<T>& v) { return v.tan2_theta(); }
+template <std::floating_point T> constexpr T cos_phi(const LocalDirection<T>& v) { return v.cos_phi(); }
+template <std::floating_point T> constexpr T sin_phi(const LocalDirection<T>& v) { return v.sin_phi(); }
+template <std::floating_point T> constexpr T cos2_phi(const LocalDirection<T>& v) { return v.cos2_phi(); }
+template <std::floating_point T> constexpr T sin2_phi(const LocalDirection<T>& v) { return v.sin2_phi(); }
+
+NAMESPACE_END(Local)
+
 NAMESPACE_END(Hinae)
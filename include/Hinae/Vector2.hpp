@@ -47,7 +47,7 @@ struct Vector2
     constexpr void operator /= (const Vector2<T>& rhs) { x /= rhs.x; y /= rhs.y; }
 
     constexpr T norm2() const { return x * x + y * y; }
-    constexpr T norm()  const { return static_cast<T>(std::sqrt(norm2())); }
+    constexpr T norm()  const { return static_cast<T>(sqrt(norm2())); }
 
     constexpr void normalize() { (*this) *= reciprocal(norm()); }
     constexpr Vector2<T> normalized() const { return (*this) * reciprocal(norm()); }
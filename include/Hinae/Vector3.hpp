@@ -7,8 +7,9 @@ NAMESPACE_BEGIN(Hinae)
 using Vector3f = Vector3<f32>;
 using Vector3d = Vector3<f64>;
 using Vector3i = Vector3<isize>;
+using Vector3h = Vector3<f16>;
 
-template <arithmetic T>
+template <storage T>
 struct Vector3
 {
     T x, y, z;
@@ -16,7 +17,7 @@ struct Vector3
     constexpr Vector3(T v) : x(v), y(v), z(v) {}
     constexpr Vector3(T x, T y, T z) : x(x), y(y), z(z) {}
 
-    template <arithmetic U>
+    template <storage U>
     constexpr explicit Vector3(const Vector3<U>& p)
         : x(static_cast<T>(p.x))
         , y(static_cast<T>(p.y))
@@ -48,7 +49,7 @@ struct Vector3
     constexpr void operator /= (const Vector3<T>& rhs) { x /= rhs.x; y /= rhs.y; z /= rhs.z; }
 
     constexpr T norm2() const { return x * x + y * y + z * z; }
-    T norm()  const { return static_cast<T>(std::sqrt(norm2())); }
+    constexpr T norm()  const { return static_cast<T>(sqrt(norm2())); }
 
     constexpr void normalize() { (*this) /= norm(); }
     constexpr Vector3<T> normalized() const { return (*this) / norm(); }
@@ -67,26 +68,30 @@ struct Vector3
         return (x < y) ? ( x < z ? Axis::X : Axis::Z ) : ( y < z ? Axis::Y : Axis::Z );
     }
 
-    T operator [] (usize i) const
+    constexpr T operator [] (usize i) const
     { 
         assert(i <= 2);
+        if(std::is_constant_evaluated())
+            return i == 0 ? x : (i == 1 ? y : z);
         return (&x)[i];
     }
     
-    T& operator [] (usize i)
+    constexpr T& operator [] (usize i)
     { 
         assert(i <= 2);
+        if(std::is_constant_evaluated())
+            return i == 0 ? x : (i == 1 ? y : z);
         return (&x)[i];
     }
 
-    T operator [] (Axis axis) const
+    constexpr T operator [] (Axis axis) const
     { 
-        return (&x)[static_cast<usize>(axis)];
+        return (*this)[static_cast<usize>(axis)];
     }
 
-    T& operator [] (Axis axis)
+    constexpr T& operator [] (Axis axis)
     { 
-        return (&x)[static_cast<usize>(axis)];
+        return (*this)[static_cast<usize>(axis)];
     }
 };
 
@@ -112,7 +117,7 @@ constexpr Vector3<T> operator + (T lhs, const Vector3<T>& rhs) { return rhs + lh
 template <arithmetic T>
 constexpr Vector3<T> operator * (T lhs, const Vector3<T>& rhs) { return rhs * lhs; }
 
-template <arithmetic T>
+template <storage T>
 std::ostream& operator << (std::ostream& os, const Vector3<T>& v)
 {
     return os << std::make_tuple(v.x, v.y, v.z);
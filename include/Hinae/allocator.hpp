@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "basic_type.hpp"
+
+// 每帧重建的数据(BVH节点、图元下标、光线队列)用的分配器
+// 内存按块向系统申请，块首按缓存行对齐；reset只把指针拨回开头，已经申请的块留给下一帧复用，预热之后不再调用malloc
+
+NAMESPACE_BEGIN(Hinae)
+
+NAMESPACE_BEGIN(Memory)
+
+inline std::byte* allocate_aligned(usize bytes)
+{
+    return static_cast<std::byte*>(::operator new(bytes, std::align_val_t{CACHE_LINE}));
+}
+
+inline void free_aligned(std::byte* p)
+{
+    ::operator delete(p, std::align_val_t{CACHE_LINE});
+}
+
+constexpr usize align_up(usize x, usize align) { return (x + align - 1) & ~(align - 1); }
+
+NAMESPACE_END(Memory)
+
+// 单线程的线性分配器，只能整体释放
+class alignas(CACHE_LINE) Arena
+{
+private:
+    struct Chunk
+    {
+        std::byte* data;
+        usize size;
+    };
+
+    std::vector<Chunk> chunks;
+    usize current = 0;     // 正在使用的块
+    usize offset = 0;      // 块内已经用掉的字节数
+    usize chunk_size;
+
+    void* try_allocate(usize bytes, usize align)
+    {
+        const Chunk& c = chunks[current];
+        const auto base = reinterpret_cast<std::uintptr_t>(c.data);
+        const usize start = Memory::align_up(base + offset, align) - base;
+        if(start + bytes > c.size) return nullptr;
+        offset = start + bytes;
+        return c.data + start;
+    }
+
+public:
+    explicit Arena(usize chunk_size = 64 * 1024) : chunk_size(Memory::align_up(chunk_size, CACHE_LINE)) {}
+
+    ~Arena() { release(); }
+
+    Arena(const Arena&) = delete;
+    Arena& operator = (const Arena&) = delete;
+
+    // align必须是2的幂
+    void* allocate(usize bytes, usize align = alignof(std::max_align_t))
+    {
+        assert(align != 0 && (align & (align - 1)) == 0);
+        bytes = std::max<usize>(bytes, 1);
+
+        // 上一帧留下的块依次往后用，放不下的块在这一帧里跳过
+        for(; current < chunks.size(); current++, offset = 0)
+            if(void* p = try_allocate(bytes, align)) return p;
+
+        // 超过块大小的请求单独申请一块，下一帧同样的请求还能复用它
+        const usize size = std::max(chunk_size, Memory::align_up(bytes + (align > CACHE_LINE ? align : 0), CACHE_LINE));
+        chunks.push_back({Memory::allocate_aligned(size), size});
+        current = chunks.size() - 1;
+        offset = 0;
+        return try_allocate(bytes, align);
+    }
+
+    // 只有最后一次分配可以真正归还(例如用完立即释放的临时缓冲区)，其他的要等reset
+    void deallocate(void* p, usize bytes)
+    {
+        if(current >= chunks.size()) return;
+        const Chunk& c = chunks[current];
+        if(static_cast<std::byte*>(p) + std::max<usize>(bytes, 1) == c.data + offset)
+            offset = static_cast<usize>(static_cast<std::byte*>(p) - c.data);
+    }
+
+    template <typename T>
+    T* allocate_array(usize n)
+    {
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    // 析构函数不会被调用
+    template <typename T, typename... Args>
+    T* create(Args&&... args)
+    {
+        return ::new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+    // O(1)，之前分配的内存全部失效
+    void reset()
+    {
+        current = 0;
+        offset = 0;
+    }
+
+    // 把内存还给系统
+    void release()
+    {
+        for(const Chunk& c : chunks) Memory::free_aligned(c.data);
+        chunks.clear();
+        reset();
+    }
+
+    usize chunk_count() const { return chunks.size(); }
+
+    // 从第一块开头到当前位置的字节数，包括因为放不下而跳过的块尾
+    usize used() const
+    {
+        if(chunks.empty()) return 0;
+        usize ret = offset;
+        for(usize i = 0; i < current; i++) ret += chunks[i].size;
+        return ret;
+    }
+
+    usize capacity() const
+    {
+        usize ret = 0;
+        for(const Chunk& c : chunks) ret += c.size;
+        return ret;
+    }
+};
+
+// 每个线程一个Arena，线程之间不需要加锁，各自的Arena按缓存行对齐不会伪共享
+class ThreadArenas
+{
+private:
+    static u64 next_id()
+    {
+        static std::atomic<u64> id = 1;
+        return id++;
+    }
+
+    const u64 id = next_id();
+    usize chunk_size;
+    std::mutex mutex;
+    std::vector<std::pair<std::thread::id, std::unique_ptr<Arena>>> arenas;
+
+public:
+    explicit ThreadArenas(usize chunk_size = 64 * 1024) : chunk_size(chunk_size) {}
+
+    ThreadArenas(const ThreadArenas&) = delete;
+    ThreadArenas& operator = (const ThreadArenas&) = delete;
+
+    // 当前线程的Arena，线程局部缓存命中时不加锁
+    // 缓存记录的是实例编号而不是地址，实例销毁后同一地址上新建的实例不会误用旧的缓存
+    Arena& local()
+    {
+        struct Cache
+        {
+            u64 owner = 0;
+            Arena* arena = nullptr;
+        };
+        thread_local Cache cache;
+        if(cache.owner == id) return *cache.arena;
+
+        std::lock_guard lock(mutex);
+        const auto self = std::this_thread::get_id();
+        auto it = std::find_if(arenas.begin(), arenas.end(), [&](const auto& a) { return a.first == self; });
+        if(it == arenas.end())
+        {
+            arenas.emplace_back(self, std::make_unique<Arena>(chunk_size));
+            it = std::prev(arenas.end());
+        }
+        cache = {id, it->second.get()};
+        return *cache.arena;
+    }
+
+    // 在没有线程分配时调用(例如两帧之间)
+    void reset()
+    {
+        std::lock_guard lock(mutex);
+        for(auto& a : arenas) a.second->reset();
+    }
+
+    usize capacity()
+    {
+        std::lock_guard lock(mutex);
+        usize ret = 0;
+        for(auto& a : arenas) ret += a.second->capacity();
+        return ret;
+    }
+};
+
+// 固定大小对象的池，空闲的槽位串成链表，分配和释放都是O(1)
+template <typename T>
+class Pool
+{
+    static_assert(alignof(T) <= CACHE_LINE);
+
+private:
+    union Slot
+    {
+        Slot* next;
+        alignas(T) std::byte storage[sizeof(T)];
+    };
+
+    std::vector<Slot*> blocks;
+    usize current = 0;
+    usize index = 0;        // 当前块中已经用掉的槽位数
+    usize block_size;
+    Slot* free_list = nullptr;
+
+public:
+    explicit Pool(usize block_size = 1024) : block_size(std::max<usize>(block_size, 1)) {}
+
+    ~Pool()
+    {
+        for(Slot* b : blocks) Memory::free_aligned(reinterpret_cast<std::byte*>(b));
+    }
+
+    Pool(const Pool&) = delete;
+    Pool& operator = (const Pool&) = delete;
+
+    T* allocate()
+    {
+        if(free_list != nullptr)
+        {
+            Slot* s = free_list;
+            free_list = s->next;
+            return reinterpret_cast<T*>(s->storage);
+        }
+        if(current < blocks.size() && index == block_size)
+        {
+            current++;
+            index = 0;
+        }
+        if(current == blocks.size())
+            blocks.push_back(reinterpret_cast<Slot*>(Memory::allocate_aligned(Memory::align_up(block_size * sizeof(Slot), CACHE_LINE))));
+        return reinterpret_cast<T*>(blocks[current][index++].storage);
+    }
+
+    void deallocate(T* p)
+    {
+        Slot* s = reinterpret_cast<Slot*>(p);
+        s->next = free_list;
+        free_list = s;
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args)
+    {
+        return ::new(allocate()) T(std::forward<Args>(args)...);
+    }
+
+    void destroy(T* p)
+    {
+        p->~T();
+        deallocate(p);
+    }
+
+    // O(1)，所有对象失效，不调用析构函数
+    void reset()
+    {
+        current = 0;
+        index = 0;
+        free_list = nullptr;
+    }
+
+    usize capacity() const { return blocks.size() * block_size; }
+};
+
+// 标准库容器用的分配器，不小于一个缓存行的分配按缓存行对齐
+template <typename T>
+struct ArenaAllocator
+{
+    using value_type = T;
+
+    Arena* arena;
+
+    ArenaAllocator(Arena& arena) noexcept : arena(&arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.arena) {}
+
+    T* allocate(usize n)
+    {
+        if(n > std::numeric_limits<usize>::max() / sizeof(T)) throw std::bad_array_new_length();
+        const usize bytes = n * sizeof(T);
+        const usize align = bytes >= CACHE_LINE ? std::max(alignof(T), CACHE_LINE) : alignof(T);
+        return static_cast<T*>(arena->allocate(bytes, align));
+    }
+
+    void deallocate(T* p, usize n) noexcept { arena->deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator == (const ArenaAllocator<U>& other) const noexcept { return arena == other.arena; }
+};
+
+// 节点数组、图元下标和光线队列
+// std::vector扩容时先分配新缓冲区再释放旧的，旧缓冲区不在顶端，要等reset才能复用
+// 边push_back边扩容最多占用最终容量约两倍的内存，知道大小时先reserve
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+template <typename T>
+using ArenaDeque = std::deque<T, ArenaAllocator<T>>;
+
+NAMESPACE_END(Hinae)
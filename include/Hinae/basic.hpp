@@ -6,6 +6,7 @@
 #include <iostream>
 #include <tuple>
 
+#include "constexpr_math.hpp"
 #include "basic_type.hpp"
 
 NAMESPACE_BEGIN(Hinae)
@@ -29,12 +29,22 @@ using i64 = std::int_fast64_t;
 using usize = std::size_t;
 using isize = std::make_signed<usize>::type;
 
+// 按缓存行对齐可以避免多线程写相邻数据时的伪共享
+inline constexpr usize CACHE_LINE = 64;
+
 using f32 = float;
 using f64 = double;
 
+// 16位半精度浮点，只用于存储，运算时转成f32，定义在f16.hpp
+struct f16;
+
 template <typename T>
 concept arithmetic = std::is_arithmetic_v<T>;
 
+// 可以作为几何体分量存储的类型，比arithmetic多了只用于存储的f16
+template <typename T>
+concept storage = arithmetic<T> || std::same_as<std::remove_cv_t<T>, f16>;
+
 template <typename T>
 concept signed_numeric = std::is_signed_v<T>;
 
@@ -74,7 +84,7 @@ inline constexpr T PI_OVER_4 = static_cast<T>(0.78539816339744830961);
 template <typename T>
 inline constexpr T SQRT2 = std::numbers::sqrt2_v<T>;
 
-template <arithmetic T>
+template <storage T>
 struct Vector3;
 
 template <arithmetic T>
@@ -83,7 +93,7 @@ struct Vector2;
 template <arithmetic T>
 struct Point4;
 
-template <arithmetic T>
+template <storage T>
 struct Point3;
 
 template <arithmetic T>
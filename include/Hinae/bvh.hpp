@@ -0,0 +1,485 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include "Bounds3.hpp"
+#include "Ray3.hpp"
+#include "SoA.hpp"
+#include "intersection.hpp"
+#include "mapped_file.hpp"
+#include "stats.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+// 展平的BVH节点，按深度优先排列，左子节点紧跟在父节点后面
+// 节点之间只用下标相互引用，整个数组可以原样写入文件，映射之后直接遍历
+struct BVHNode
+{
+    Bounds3f bounds;
+    std::uint32_t offset;   // 叶节点：第一个图元在indices中的位置；内部节点：右子节点的下标
+    std::uint16_t count;    // 叶节点的图元数，内部节点为0
+    std::uint8_t axis;      // 内部节点的划分轴，遍历时按光线方向先访问近的子节点
+    std::uint8_t pad = 0;
+
+    constexpr bool is_leaf() const { return count != 0; }
+};
+
+static_assert(sizeof(BVHNode) == 32 && std::is_trivially_copyable_v<BVHNode>);
+
+struct BVHHit
+{
+    f32 t;
+    std::uint32_t primitive;
+};
+
+// 不拥有数据的BVH，可以指向内存中构建的结果，也可以指向映射的文件
+struct BVHView
+{
+    std::span<const BVHNode> nodes;
+    std::span<const std::uint32_t> indices;
+
+    // hit(primitive, t_max)返回光线与第primitive个图元的交点，没有比t_max更近的交点时返回INFINITY
+    template <typename F>
+    std::optional<BVHHit> intersect(const Ray3f& ray, f32 t_max, F&& hit) const
+    {
+        if(nodes.empty()) return std::nullopt;
+
+        const Vector3f inv_dir{ONE<f32> / ray.direction.x, ONE<f32> / ray.direction.y, ONE<f32> / ray.direction.z};
+        const std::array<bool, 3> negative{inv_dir.x < 0, inv_dir.y < 0, inv_dir.z < 0};
+
+        // 构建时限制了树的深度，栈不会溢出
+        std::array<std::uint32_t, 64> stack;
+        usize top = 0;
+        std::uint32_t current = 0;
+        std::uint64_t visits = 0, tests = 0;
+        BVHHit ret{t_max, MAX_NUMBER<std::uint32_t>};
+
+        for(;;)
+        {
+            const BVHNode& node = nodes[current];
+            visits++;
+            if(node.bounds.intersect(ray, inv_dir, ret.t))
+            {
+                if(!node.is_leaf())
+                {
+                    const bool far_first = negative[node.axis];
+                    stack[top++] = far_first ? current + 1 : node.offset;
+                    current = far_first ? node.offset : current + 1;
+                    continue;
+                }
+                for(std::uint32_t i = node.offset; i < node.offset + node.count; i++)
+                {
+                    const f32 t = hit(indices[i], ret.t);
+                    if(t < ret.t) ret = {t, indices[i]};
+                }
+                tests += node.count;
+            }
+            if(top == 0) break;
+            current = stack[--top];
+        }
+
+        Stats::count<Stat::Traversals>();
+        Stats::count<Stat::NodeVisits>(visits);
+        Stats::count<Stat::PrimitiveTests>(tests);
+        Stats::record<Histogram::NodesPerTraversal>(visits);
+        Stats::record<Histogram::PrimitivesPerTraversal>(tests);
+
+        if(ret.primitive == MAX_NUMBER<std::uint32_t>) return std::nullopt;
+        return ret;
+    }
+};
+
+NAMESPACE_BEGIN(BVHBuild)
+
+struct Item
+{
+    Bounds3f bounds;
+    Point3f centroid;
+    std::uint32_t index;
+};
+
+inline constexpr usize BINS = 12;
+inline constexpr usize MAX_SAH_DEPTH = 32;
+
+// 超过MAX_SAH_DEPTH后改为按中位数对半分，剩下的层数不超过32，遍历栈的64层足够
+inline std::uint32_t build(std::vector<BVHNode>& nodes, std::span<Item> items, std::uint32_t first, usize max_leaf, usize depth)
+{
+    const auto self = static_cast<std::uint32_t>(nodes.size());
+    nodes.push_back({});
+
+    Bounds3f bounds = items[0].bounds, centroids(items[0].centroid);
+    for(const Item& item : items)
+    {
+        bounds = Union(bounds, item.bounds);
+        centroids = Union(centroids, item.centroid);
+    }
+    nodes[self].bounds = bounds;
+
+    const usize n = items.size();
+    const auto axis = static_cast<usize>(centroids.max_extent());
+    const f32 lo = centroids.p_min[axis], extent = centroids.p_max[axis] - lo;
+    const auto make_leaf = [&]
+    {
+        nodes[self].offset = first;
+        nodes[self].count = static_cast<std::uint16_t>(n);
+        return self;
+    };
+    if(n <= max_leaf) return make_leaf();
+
+    // 按质心分桶估计SAH代价，选代价最小的分界
+    usize mid = n / 2;
+    if(depth < MAX_SAH_DEPTH && extent > 0)
+    {
+        const auto bin_of = [&](const Item& item)
+        {
+            return min(static_cast<usize>((item.centroid[axis] - lo) / extent * BINS), BINS - 1);
+        };
+
+        std::array<usize, BINS> count{};
+        std::array<Bounds3f, BINS> bin_bounds;
+        for(const Item& item : items)
+        {
+            const usize b = bin_of(item);
+            bin_bounds[b] = count[b]++ == 0 ? item.bounds : Union(bin_bounds[b], item.bounds);
+        }
+
+        std::array<f32, BINS - 1> cost{};
+        Bounds3f acc;
+        usize acc_count = 0;
+        for(usize b = 0; b + 1 < BINS; b++)
+        {
+            if(count[b] != 0) acc = acc_count == 0 ? bin_bounds[b] : Union(acc, bin_bounds[b]);
+            acc_count += count[b];
+            cost[b] = acc_count == 0 ? 0 : static_cast<f32>(acc_count) * acc.surface_area();
+        }
+        acc_count = 0;
+        for(usize b = BINS - 1; b > 0; b--)
+        {
+            if(count[b] != 0) acc = acc_count == 0 ? bin_bounds[b] : Union(acc, bin_bounds[b]);
+            acc_count += count[b];
+            cost[b - 1] += acc_count == 0 ? 0 : static_cast<f32>(acc_count) * acc.surface_area();
+        }
+
+        const usize best = static_cast<usize>(std::min_element(cost.begin(), cost.end()) - cost.begin());
+        // 遍历一个节点的代价按求交一个图元的1/8估计
+        const f32 leaf_cost = static_cast<f32>(n) * bounds.surface_area();
+        if(cost[best] + bounds.surface_area() / 8 >= leaf_cost && n <= MAX_NUMBER<std::uint16_t>) return make_leaf();
+
+        mid = static_cast<usize>(std::partition(items.begin(), items.end(), [&](const Item& item) { return bin_of(item) <= best; }) - items.begin());
+    }
+    if(mid == 0 || mid == n || extent == 0)
+    {
+        mid = n / 2;
+        std::nth_element(items.begin(), items.begin() + static_cast<isize>(mid), items.end(), [&](const Item& a, const Item& b)
+        {
+            return a.centroid[axis] < b.centroid[axis];
+        });
+    }
+
+    nodes[self].axis = static_cast<std::uint8_t>(axis);
+    build(nodes, items.first(mid), first, max_leaf, depth + 1);
+    const std::uint32_t right = build(nodes, items.subspan(mid), first + static_cast<std::uint32_t>(mid), max_leaf, depth + 1);
+    nodes[self].offset = right;
+    return self;
+}
+
+NAMESPACE_END(BVHBuild)
+
+// 在内存中构建的BVH，按分桶SAH划分
+struct BVH
+{
+    std::vector<BVHNode> nodes;
+    std::vector<std::uint32_t> indices;
+
+    static BVH build(std::span<const Bounds3f> bounds, usize max_leaf = 4)
+    {
+        assert(bounds.size() < MAX_NUMBER<std::uint32_t>);
+        BVH ret;
+        if(bounds.empty()) return ret;
+
+        std::vector<BVHBuild::Item> items(bounds.size());
+        for(usize i = 0; i < bounds.size(); i++)
+            items[i] = {bounds[i], bounds[i].centroid(), static_cast<std::uint32_t>(i)};
+
+        ret.nodes.reserve(2 * bounds.size());
+        BVHBuild::build(ret.nodes, items, 0, std::clamp<usize>(max_leaf, 1, MAX_NUMBER<std::uint16_t>), 0);
+
+        ret.indices.resize(items.size());
+        for(usize i = 0; i < items.size(); i++)
+            ret.indices[i] = items[i].index;
+        return ret;
+    }
+
+    BVHView view() const { return {nodes, indices}; }
+};
+
+// 三角形网格场景：BVH、每个图元的包围盒、SoA顶点和三角形的顶点下标
+// 没有三角形时(例如只存包围盒)hit需要自己提供
+struct SceneView
+{
+    BVHView bvh;
+    std::span<const Bounds3f> primitive_bounds;
+    Point3SoA<const f32> vertices;
+    std::span<const std::array<std::uint32_t, 3>> triangles;
+
+    std::optional<PrimitiveHit<f32>> intersect(const Ray3f& ray, f32 t_max) const
+    {
+        const auto hit = bvh.intersect(ray, t_max, [&](std::uint32_t i, f32 t)
+        {
+            const auto [a, b, c] = triangles[i];
+            return Intersection::triangle(ray.origin, ray.direction, t, vertices[a], vertices[b], vertices[c]);
+        });
+        if(!hit) return std::nullopt;
+
+        const auto [a, b, c] = triangles[hit->primitive];
+        const Vector3f n = cross(vertices[b] - vertices[a], vertices[c] - vertices[a]).normalized();
+        return PrimitiveHit<f32>{hit->t, n, hit->primitive};
+    }
+};
+
+NAMESPACE_BEGIN(SceneFormat)
+
+// 文件里的各段，每段的偏移和字节数记录在头部
+enum class Section : std::uint32_t
+{
+    Nodes,
+    Indices,
+    PrimitiveBounds,
+    VertexX,
+    VertexY,
+    VertexZ,
+    Triangles,
+    Count
+};
+
+inline constexpr usize SECTION_COUNT = static_cast<usize>(Section::Count);
+
+// 每段的起点按缓存行对齐，mmap的起点按页对齐，映射之后各段也是对齐的
+inline constexpr usize ALIGNMENT = 64;
+
+// FNV-1a
+constexpr std::uint64_t checksum(std::span<const std::byte> bytes, std::uint64_t hash = 0xcbf29ce484222325)
+{
+    for(std::byte b : bytes)
+        hash = (hash ^ static_cast<std::uint64_t>(b)) * 0x100000001b3;
+    return hash;
+}
+
+struct SectionRange
+{
+    std::uint64_t offset;
+    std::uint64_t bytes;
+};
+
+// 磁盘格式：头部后面是各段数据，全部用相对文件开头的偏移，没有指针
+// 按写入机器的字节序存储，不做转换；头部的endian字段记录写入时的字节序，字节序不同的机器上打开会被拒绝
+// header_checksum覆盖头部中它之前的所有字段，打开时检查；payload_checksum覆盖所有段的内容，只在verify时检查
+struct Header
+{
+    static constexpr std::uint32_t MAGIC = 0x48564248;  // "HBVH"
+    static constexpr std::uint32_t VERSION = 1;
+    static constexpr std::uint32_t ENDIAN = 0x01020304;
+
+    std::uint32_t magic = MAGIC;
+    std::uint32_t version = VERSION;
+    std::uint32_t endian = ENDIAN;
+    std::uint32_t header_size = 0;
+    std::uint64_t file_size = 0;
+    std::array<SectionRange, SECTION_COUNT> sections{};
+    std::uint64_t payload_checksum = 0;
+    std::uint64_t header_checksum = 0;
+
+    std::uint64_t compute_checksum() const
+    {
+        return checksum(std::as_bytes(std::span(this, 1)).first(offsetof(Header, header_checksum)));
+    }
+
+    const SectionRange& operator [] (Section s) const { return sections[static_cast<usize>(s)]; }
+    SectionRange& operator [] (Section s) { return sections[static_cast<usize>(s)]; }
+};
+
+static_assert(std::is_trivially_copyable_v<Header> && sizeof(Header) == 152);
+
+// 每段的元素大小
+inline constexpr std::array<usize, SECTION_COUNT> ELEMENT_SIZE =
+{
+    sizeof(BVHNode), sizeof(std::uint32_t), sizeof(Bounds3f), sizeof(f32), sizeof(f32), sizeof(f32), sizeof(std::array<std::uint32_t, 3>)
+};
+
+inline std::array<std::span<const std::byte>, SECTION_COUNT> sections(const SceneView& scene)
+{
+    return
+    {
+        std::as_bytes(scene.bvh.nodes), std::as_bytes(scene.bvh.indices), std::as_bytes(scene.primitive_bounds),
+        std::as_bytes(scene.vertices.x), std::as_bytes(scene.vertices.y), std::as_bytes(scene.vertices.z),
+        std::as_bytes(scene.triangles)
+    };
+}
+
+// 各段元素类型的最大对齐，文件内容的起点满足这个对齐即可，不必是映射时的页对齐
+inline constexpr usize BASE_ALIGNMENT = std::max({alignof(BVHNode), alignof(std::uint32_t), alignof(Bounds3f), alignof(f32),
+                                                  alignof(std::array<std::uint32_t, 3>)});
+
+template <typename T>
+std::span<const T> view(std::span<const std::byte> file, const SectionRange& r)
+{
+    return {reinterpret_cast<const T*>(file.data() + r.offset), static_cast<usize>(r.bytes / sizeof(T))};
+}
+
+// 只检查头部和各段的范围，是O(1)的，不读取段的内容
+inline std::optional<SceneView> parse(std::span<const std::byte> file)
+{
+    if(file.size() < sizeof(Header) || reinterpret_cast<std::uintptr_t>(file.data()) % BASE_ALIGNMENT != 0) return {};
+
+    Header header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if(header.magic != Header::MAGIC || header.version != Header::VERSION || header.endian != Header::ENDIAN) return {};
+    if(header.header_size != sizeof(Header) || header.file_size != file.size()) return {};
+    if(header.header_checksum != header.compute_checksum()) return {};
+
+    for(usize i = 0; i < SECTION_COUNT; i++)
+    {
+        const SectionRange& r = header.sections[i];
+        if(r.offset % ALIGNMENT != 0 || r.offset < sizeof(Header) || r.offset > file.size()) return {};
+        if(r.bytes > file.size() - r.offset || r.bytes % ELEMENT_SIZE[i] != 0) return {};
+    }
+
+    using enum Section;
+    SceneView ret;
+    ret.bvh.nodes = view<BVHNode>(file, header[Nodes]);
+    ret.bvh.indices = view<std::uint32_t>(file, header[Indices]);
+    ret.primitive_bounds = view<Bounds3f>(file, header[PrimitiveBounds]);
+    const auto x = view<f32>(file, header[VertexX]), y = view<f32>(file, header[VertexY]), z = view<f32>(file, header[VertexZ]);
+    if(x.size() != y.size() || x.size() != z.size()) return {};
+    ret.vertices = {x, y, z};
+    ret.triangles = view<std::array<std::uint32_t, 3>>(file, header[Triangles]);
+    return ret;
+}
+
+NAMESPACE_END(SceneFormat)
+
+// 先写临时文件再重命名，其他进程不会映射到写了一半的文件
+inline bool write_scene(const std::filesystem::path& path, const SceneView& scene)
+{
+    using namespace SceneFormat;
+    const auto data = sections(scene);
+
+    Header header;
+    header.header_size = sizeof(Header);
+    std::uint64_t offset = sizeof(Header);
+    header.payload_checksum = checksum({});
+    for(usize i = 0; i < SECTION_COUNT; i++)
+    {
+        offset = (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        header.sections[i] = {offset, data[i].size()};
+        header.payload_checksum = checksum(data[i], header.payload_checksum);
+        offset += data[i].size();
+    }
+    header.file_size = offset;
+    header.header_checksum = header.compute_checksum();
+
+    const std::filesystem::path tmp = temporary_path(path);
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if(!out) return false;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        std::uint64_t written = sizeof(Header);
+        const char zeros[ALIGNMENT] = {};
+        for(usize i = 0; i < SECTION_COUNT; i++)
+        {
+            out.write(zeros, static_cast<std::streamsize>(header.sections[i].offset - written));
+            out.write(reinterpret_cast<const char*>(data[i].data()), static_cast<std::streamsize>(data[i].size()));
+            written = header.sections[i].offset + data[i].size();
+        }
+        // 缓冲区在close时才写完，写满磁盘之类的错误到这里才能看到
+        out.close();
+        if(!out)
+        {
+            std::error_code ec;
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if(!ec) return true;
+    std::filesystem::remove(tmp, ec);
+    return false;
+}
+
+// 映射的场景文件，打开时只检查头部，不做任何反序列化
+struct SceneFile
+{
+private:
+    MappedFile file;
+    SceneView view_;
+
+public:
+    SceneFile(const SceneFile&) = delete;
+    SceneFile& operator = (const SceneFile&) = delete;
+
+    // 映射地址在移动时不变，view可以直接跟着移动
+    SceneFile(SceneFile&&) noexcept = default;
+    SceneFile& operator = (SceneFile&&) noexcept = default;
+
+    // 魔数、版本、字节序、头部校验和或者段范围不对时返回空
+    static std::optional<SceneFile> open(const std::filesystem::path& path)
+    {
+        auto mapped = MappedFile::open(path);
+        if(!mapped) return {};
+        auto view = SceneFormat::parse(mapped->bytes());
+        if(!view) return {};
+        return SceneFile(std::move(*mapped), *view);
+    }
+
+    const SceneView& view() const { return view_; }
+
+    // 完整检查：内容的校验和，以及节点、下标、三角形引用的范围，需要读取整个文件
+    bool verify() const
+    {
+        using namespace SceneFormat;
+        Header header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        std::uint64_t hash = checksum({});
+        for(const auto& s : sections(view_)) hash = checksum(s, hash);
+        if(hash != header.payload_checksum) return false;
+
+        const auto& nodes = view_.bvh.nodes;
+        const auto& indices = view_.bvh.indices;
+        const usize primitives = view_.triangles.empty() ? view_.primitive_bounds.size() : view_.triangles.size();
+
+        // 子节点的下标总是大于父节点，遍历一定会结束；深度不超过遍历栈的大小
+        std::vector<std::uint8_t> depth(nodes.size(), 0);
+        for(usize i = 0; i < nodes.size(); i++)
+        {
+            const BVHNode& n = nodes[i];
+            if(n.is_leaf())
+            {
+                if(static_cast<usize>(n.offset) + n.count > indices.size()) return false;
+                continue;
+            }
+            if(n.offset <= i + 1 || n.offset >= nodes.size() || n.axis >= 3 || depth[i] >= 63) return false;
+            depth[i + 1] = std::max<std::uint8_t>(depth[i + 1], depth[i] + 1);
+            depth[n.offset] = std::max<std::uint8_t>(depth[n.offset], depth[i] + 1);
+        }
+        for(std::uint32_t i : indices)
+            if(i >= primitives) return false;
+        for(const auto& t : view_.triangles)
+            for(std::uint32_t v : t)
+                if(v >= view_.vertices.size()) return false;
+        return true;
+    }
+
+private:
+    SceneFile(MappedFile file, const SceneView& view) : file(std::move(file)), view_(view) {}
+};
+
+NAMESPACE_END(Hinae)
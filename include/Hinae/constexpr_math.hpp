@@ -0,0 +1,198 @@
+#pragma once
+
+#include <cmath>
+
+#include <bit>
+
+#include "basic_type.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+// 编译期可求值的数学函数，运行期仍然走标准库
+// 标准库的sqrt/sin/cos/tan/exp在C++20中不是constexpr，clang下无法常量求值
+NAMESPACE_BEGIN(Constexpr)
+
+template <std::floating_point T>
+constexpr bool is_nan(T x) { return x != x; }
+
+// 清除符号位，-0的结果是+0，NaN原样返回
+template <std::floating_point T>
+constexpr T fabs(T x)
+{
+    if(x < ZERO<T>)  return -x;
+    if(x == ZERO<T>) return ZERO<T>;
+    return x;
+}
+
+template <std::floating_point T>
+constexpr T sqrt(T x)
+{
+    if(is_nan(x) || x < ZERO<T>) return std::numeric_limits<T>::quiet_NaN();
+    if(x == ZERO<T> || x == INFINITY_<T>) return x;
+
+    // 用位运算得到指数减半的初值，再用long double做牛顿迭代
+    const f64 d = static_cast<f64>(x);
+    const long double a = x;
+    long double y = d < 1e-300 ? d * 1e150
+                  : std::bit_cast<f64>((std::bit_cast<std::uint64_t>(d) >> 1) + 0x1ff7a3bea91d9b1bull);
+
+    for(usize i = 0; i < 64; i++)
+    {
+        const long double next = (y + a / y) / 2;
+        if(next == y) break;
+        y = next;
+    }
+    return static_cast<T>(y);
+}
+
+// 把弧度归约到[-pi, pi]后用泰勒级数求和，全程使用long double
+constexpr long double reduce_radian(long double x)
+{
+    constexpr long double two_pi = 6.283185307179586476925286766559005768L;
+    if(x / two_pi > -1e18L && x / two_pi < 1e18L)
+        x -= static_cast<long double>(static_cast<std::int64_t>(x / two_pi)) * two_pi;
+    else
+    {
+        // 商超出int64的范围，像fmod一样从高位开始逐次减去2pi * 2^k，每次相减都是精确的
+        const bool negative = x < 0;
+        long double y = negative ? -x : x, m = two_pi;
+        while(m * 2 <= y) m *= 2;
+        for(; m >= two_pi; m /= 2)
+            if(y >= m) y -= m;
+        x = negative ? -y : y;
+    }
+    if(x > two_pi / 2)  x -= two_pi;
+    if(x < -two_pi / 2) x += two_pi;
+    return x;
+}
+
+constexpr long double sin_series(long double x)
+{
+    long double term = x, sum = x;
+    for(int n = 1; n < 32; n++)
+    {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr long double cos_series(long double x)
+{
+    long double term = 1, sum = 1;
+    for(int n = 1; n < 32; n++)
+    {
+        term *= -x * x / ((2 * n - 1) * (2 * n));
+        sum += term;
+    }
+    return sum;
+}
+
+template <std::floating_point T>
+constexpr T sin(T x)
+{
+    if(is_nan(x) || x == INFINITY_<T> || x == -INFINITY_<T>) return std::numeric_limits<T>::quiet_NaN();
+    return static_cast<T>(sin_series(reduce_radian(x)));
+}
+
+template <std::floating_point T>
+constexpr T cos(T x)
+{
+    if(is_nan(x) || x == INFINITY_<T> || x == -INFINITY_<T>) return std::numeric_limits<T>::quiet_NaN();
+    return static_cast<T>(cos_series(reduce_radian(x)));
+}
+
+template <std::floating_point T>
+constexpr T tan(T x)
+{
+    if(is_nan(x) || x == INFINITY_<T> || x == -INFINITY_<T>) return std::numeric_limits<T>::quiet_NaN();
+    const long double r = reduce_radian(x);
+    return static_cast<T>(sin_series(r) / cos_series(r));
+}
+
+// x = k * ln2 + r，|r| <= ln2 / 2，r用泰勒级数，2^k逐次乘2
+template <std::floating_point T>
+constexpr T exp(T x)
+{
+    if(is_nan(x)) return x;
+    if(x > static_cast<T>(std::numeric_limits<T>::max_exponent) * static_cast<T>(0.6931471805599453)) return INFINITY_<T>;
+    if(x < static_cast<T>(std::numeric_limits<T>::min_exponent - std::numeric_limits<T>::digits) * static_cast<T>(0.6931471805599453))
+        return ZERO<T>;
+
+    constexpr long double ln2 = 0.693147180559945309417232121458176568L;
+    const long double xl = x;
+    const std::int64_t k = static_cast<std::int64_t>(xl / ln2 + (xl < 0 ? -0.5L : 0.5L));
+    const long double r = xl - static_cast<long double>(k) * ln2;
+
+    long double term = 1, sum = 1;
+    for(int n = 1; n < 32; n++)
+    {
+        term *= r / n;
+        sum += term;
+    }
+    for(std::int64_t i = 0; i < k; i++)  sum *= 2;
+    for(std::int64_t i = k; i < 0; i++)  sum /= 2;
+    return static_cast<T>(sum);
+}
+
+NAMESPACE_END(Constexpr)
+
+// 浮点数的绝对值，std::abs在C++20中不是constexpr
+template <std::floating_point T>
+constexpr T fabs(T x)
+{
+    if(std::is_constant_evaluated())
+        return Constexpr::fabs(x);
+    else
+        return std::abs(x);
+}
+
+template <std::floating_point T>
+constexpr T sqrt(T x)
+{
+    if(std::is_constant_evaluated())
+        return Constexpr::sqrt(x);
+    else
+        return std::sqrt(x);
+}
+
+template <std::integral T>
+constexpr f64 sqrt(T x) { return sqrt(static_cast<f64>(x)); }
+
+template <std::floating_point T>
+constexpr T sin(T x)
+{
+    if(std::is_constant_evaluated())
+        return Constexpr::sin(x);
+    else
+        return std::sin(x);
+}
+
+template <std::floating_point T>
+constexpr T cos(T x)
+{
+    if(std::is_constant_evaluated())
+        return Constexpr::cos(x);
+    else
+        return std::cos(x);
+}
+
+template <std::floating_point T>
+constexpr T tan(T x)
+{
+    if(std::is_constant_evaluated())
+        return Constexpr::tan(x);
+    else
+        return std::tan(x);
+}
+
+template <std::floating_point T>
+constexpr T exp(T x)
+{
+    if(std::is_constant_evaluated())
+        return Constexpr::exp(x);
+    else
+        return std::exp(x);
+}
+
+NAMESPACE_END(Hinae)
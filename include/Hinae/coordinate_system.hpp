@@ -2,6 +2,7 @@
 
 #include "Vector3.hpp"
 #include "Point3.hpp"
+#include "SoA.hpp"
 
 NAMESPACE_BEGIN(Hinae)
 
@@ -11,13 +12,65 @@ local_coordinate_system(const Vector3<T>& v1)
 {
     const auto [x, y, z] = v1;
     Vector3<T> v2;
-    if(std::abs(x) > std::abs(y))
-        v2 = Vector3<T>{-z, ZERO<T>, x} / std::sqrt(x * x + z * z);
+    if(fabs(x) > fabs(y))
+        v2 = Vector3<T>{-z, ZERO<T>, x} / sqrt(x * x + z * z);
     else
-        v2 = Vector3<T>{ZERO<T>, z, -y} / std::sqrt(y * y + z * z);
+        v2 = Vector3<T>{ZERO<T>, z, -y} / sqrt(y * y + z * z);
     return {v2, cross(v1, v2)};
 }
 
+// Duff et al. 2017, "Building an Orthonormal Basis, Revisited"
+// n必须是单位向量，没有分支也没有开方，结果在n.z = -1附近依然连续
+template <std::floating_point T>
+constexpr std::tuple<Vector3<T>, Vector3<T>>
+branchless_coordinate_system(const Vector3<T>& n)
+{
+    const T s = n.z >= ZERO<T> ? ONE<T> : -ONE<T>;
+    const T a = -ONE<T> / (s + n.z);
+    const T b = n.x * n.y * a;
+    return
+    {
+        Vector3<T>{ONE<T> + s * n.x * n.x * a, s * b, -s * n.x},
+        Vector3<T>{b, s + n.y * n.y * a, -n.y}
+    };
+}
+
+template <std::floating_point T>
+void branchless_coordinate_system(Vector3SoA<const T> n, Vector3SoA<T> t, Vector3SoA<T> b)
+{
+    assert(t.size() == n.size() && b.size() == n.size());
+    const T* nx = n.x.data();
+    const T* ny = n.y.data();
+    const T* nz = n.z.data();
+    T* tx = t.x.data();
+    T* ty = t.y.data();
+    T* tz = t.z.data();
+    T* bx = b.x.data();
+    T* by = b.y.data();
+    T* bz = b.z.data();
+    for(usize i = 0; i < n.size(); i++)
+    {
+        const T s = nz[i] >= ZERO<T> ? ONE<T> : -ONE<T>;
+        const T a = -ONE<T> / (s + nz[i]);
+        const T c = nx[i] * ny[i] * a;
+        tx[i] = ONE<T> + s * nx[i] * nx[i] * a;
+        ty[i] = s * c;
+        tz[i] = -s * nx[i];
+        bx[i] = c;
+        by[i] = s + ny[i] * ny[i] * a;
+        bz[i] = -ny[i];
+    }
+}
+
+template <std::floating_point T>
+void branchless_coordinate_system(
+    std::span<const Vector3<T>> n, std::span<Vector3<T>> t, std::span<Vector3<T>> b)
+{
+    assert(t.size() == n.size() && b.size() == n.size());
+    for(usize i = 0; i < n.size(); i++)
+        std::tie(t[i], b[i]) = branchless_coordinate_system(n[i]);
+}
+
 template <arithmetic T>
 constexpr Point3<T> cartesian_to_spherical(const Point3<T>& p)
 {
@@ -36,9 +89,9 @@ constexpr Point3<T> spherical_to_cartesian(const Point3<T>& p)
     const auto [r, theta, phi] = p;
     return
     {
-        r * std::sin(theta) * std::cos(phi),
-        r * std::sin(theta) * std::sin(phi),
-        r * std::cos(theta)
+        r * sin(theta) * cos(phi),
+        r * sin(theta) * sin(phi),
+        r * cos(theta)
     };
 }
 
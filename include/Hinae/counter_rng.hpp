@@ -0,0 +1,182 @@
+#pragma once
+
+#include "rng.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+// Salmon et al. 2011, "Parallel Random Numbers: As Easy as 1, 2, 3"
+// Philox4x32-10，没有可变状态，同样的(counter, key)永远得到同样的输出
+struct Philox4x32
+{
+    using Counter = std::array<std::uint32_t, 4>;
+    using Key = std::array<std::uint32_t, 2>;
+
+    static constexpr std::uint32_t M0 = 0xd2511f53;
+    static constexpr std::uint32_t M1 = 0xcd9e8d57;
+    static constexpr std::uint32_t W0 = 0x9e3779b9;
+    static constexpr std::uint32_t W1 = 0xbb67ae85;
+    static constexpr usize ROUNDS = 10;
+
+    static constexpr Counter eval(Counter c, Key k)
+    {
+        for(usize r = 0; r < ROUNDS; r++)
+        {
+            const std::uint64_t p0 = static_cast<std::uint64_t>(M0) * c[0];
+            const std::uint64_t p1 = static_cast<std::uint64_t>(M1) * c[2];
+            c =
+            {
+                static_cast<std::uint32_t>(p1 >> 32) ^ c[1] ^ k[0],
+                static_cast<std::uint32_t>(p1),
+                static_cast<std::uint32_t>(p0 >> 32) ^ c[3] ^ k[1],
+                static_cast<std::uint32_t>(p0)
+            };
+            k[0] += W0;
+            k[1] += W1;
+        }
+        return c;
+    }
+
+    // N组counter按SoA排列同时计算，循环体没有分支，可以被编译器向量化
+    template <usize N>
+    static constexpr void eval(std::uint32_t (&c)[4][N], Key k)
+    {
+        for(usize r = 0; r < ROUNDS; r++)
+        {
+            for(usize i = 0; i < N; i++)
+            {
+                const std::uint64_t p0 = static_cast<std::uint64_t>(M0) * c[0][i];
+                const std::uint64_t p1 = static_cast<std::uint64_t>(M1) * c[2][i];
+                const std::uint32_t c1 = c[1][i], c3 = c[3][i];
+                c[0][i] = static_cast<std::uint32_t>(p1 >> 32) ^ c1 ^ k[0];
+                c[1][i] = static_cast<std::uint32_t>(p1);
+                c[2][i] = static_cast<std::uint32_t>(p0 >> 32) ^ c3 ^ k[1];
+                c[3][i] = static_cast<std::uint32_t>(p0);
+            }
+            k[0] += W0;
+            k[1] += W1;
+        }
+    }
+};
+
+// 以(像素, 样本序号, 维度)为counter的随机数，任何线程都可以在任意时刻算出任意一个样本
+// 一个Philox块有4个32位字，全部用上：32位的类型每块4个维度，64位的类型每块2个维度
+// 维度d在第d / PER_BLOCK块的第d % PER_BLOCK个位置，连续的维度共用同一个块
+struct CounterRNG
+{
+    static constexpr usize LANES = 8;
+
+    // 按定长类型区分，u32等fast类型的位宽随平台变化，会改变counter到输出的对应关系
+    template <arithmetic T>
+    static constexpr usize PER_BLOCK = std::is_same_v<T, f64> || std::is_same_v<T, std::uint64_t> ? 2 : 4;
+
+    Philox4x32::Key key;
+
+    constexpr CounterRNG(std::uint64_t seed = 0)
+        : key{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)} {}
+
+    constexpr Philox4x32::Counter bits(std::uint64_t pixel, std::uint32_t index, std::uint32_t block) const
+    {
+        return Philox4x32::eval(counter(pixel, index, block), key);
+    }
+
+    // 浮点数在[0, 1)，整数取满位宽
+    // 单个维度也要算一整个块，需要连续几个维度时用get4或者fill_dimensions
+    template <arithmetic T>
+    constexpr T get(std::uint64_t pixel, std::uint32_t index, std::uint32_t dimension) const
+    {
+        constexpr usize n = PER_BLOCK<T>;
+        return convert<T>(bits(pixel, index, dimension / n), dimension % n);
+    }
+
+    // 从first_dimension开始的连续4个维度，first_dimension是PER_BLOCK的倍数时32位的类型只算1个块，64位的类型算2个块
+    template <arithmetic T>
+    constexpr std::array<T, 4> get4(std::uint64_t pixel, std::uint32_t index, std::uint32_t first_dimension) const
+    {
+        constexpr usize n = PER_BLOCK<T>;
+        std::array<T, 4> ret;
+        const usize skip = first_dimension % n;
+        const std::uint32_t first_block = first_dimension / static_cast<std::uint32_t>(n);
+        for(usize b = 0; b * n < skip + 4; b++)
+        {
+            const auto c = bits(pixel, index, first_block + static_cast<std::uint32_t>(b));
+            for(usize w = 0; w < n; w++)
+            {
+                const usize pos = b * n + w;
+                if(pos >= skip && pos - skip < 4) ret[pos - skip] = convert<T>(c, w);
+            }
+        }
+        return ret;
+    }
+
+    // 同一个像素同一个维度，样本序号从first_index开始连续的一段，每个样本一个块
+    template <arithmetic T>
+    constexpr void fill_samples(std::uint64_t pixel, std::uint32_t first_index, std::uint32_t dimension, std::span<T> out) const
+    {
+        constexpr usize n = PER_BLOCK<T>;
+        const std::uint32_t block = dimension / static_cast<std::uint32_t>(n);
+        const usize word = dimension % n;
+        eval_blocks(out.size(), [&](usize i) { return counter(pixel, first_index + static_cast<std::uint32_t>(i), block); },
+                    [&](usize i, const Philox4x32::Counter& c) { out[i] = convert<T>(c, word); });
+    }
+
+    // 同一个样本，维度从first_dimension开始连续的一段，每个块的输出全部用上
+    template <arithmetic T>
+    constexpr void fill_dimensions(std::uint64_t pixel, std::uint32_t index, std::uint32_t first_dimension, std::span<T> out) const
+    {
+        constexpr usize n = PER_BLOCK<T>;
+        const usize skip = first_dimension % n;
+        const std::uint32_t first_block = first_dimension / static_cast<std::uint32_t>(n);
+        eval_blocks((skip + out.size() + n - 1) / n,
+                    [&](usize b) { return counter(pixel, index, first_block + static_cast<std::uint32_t>(b)); },
+                    [&](usize b, const Philox4x32::Counter& c)
+                    {
+                        for(usize w = 0; w < n; w++)
+                        {
+                            const usize pos = b * n + w;
+                            if(pos >= skip && pos - skip < out.size()) out[pos - skip] = convert<T>(c, w);
+                        }
+                    });
+    }
+
+private:
+    static constexpr Philox4x32::Counter counter(std::uint64_t pixel, std::uint32_t index, std::uint32_t block)
+    {
+        return {static_cast<std::uint32_t>(pixel), static_cast<std::uint32_t>(pixel >> 32), index, block};
+    }
+
+    // 32位的类型取第i个字，64位的类型取第2i和2i+1个字
+    template <arithmetic T>
+    static constexpr T convert(const Philox4x32::Counter& c, usize i)
+    {
+        static_assert(portable_random<T>, "use f32, f64, std::uint32_t or std::uint64_t");
+        if constexpr(std::is_same_v<T, f32>)
+            return bits_to_unit_f32(c[i]);
+        else if constexpr(std::is_same_v<T, f64>)
+            return bits_to_unit_f64((static_cast<std::uint64_t>(c[2 * i]) << 32) | c[2 * i + 1]);
+        else if constexpr(std::is_same_v<T, std::uint64_t>)
+            return (static_cast<std::uint64_t>(c[2 * i]) << 32) | c[2 * i + 1];
+        else
+            return c[i];
+    }
+
+    // count个块按LANES个一组同时计算，emit(i, 第i个块的输出)
+    template <typename Counter, typename Emit>
+    constexpr void eval_blocks(usize count, Counter&& counter, Emit&& emit) const
+    {
+        for(usize i = 0; i < count; i += LANES)
+        {
+            std::uint32_t c[4][LANES];
+            for(usize l = 0; l < LANES; l++)
+            {
+                const auto v = counter(i + l);
+                for(usize k = 0; k < 4; k++) c[k][l] = v[k];
+            }
+            Philox4x32::eval(c, key);
+            const usize n = min(LANES, count - i);
+            for(usize l = 0; l < n; l++)
+                emit(i + l, Philox4x32::Counter{c[0][l], c[1][l], c[2][l], c[3][l]});
+        }
+    }
+};
+
+NAMESPACE_END(Hinae)
@@ -0,0 +1,318 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "Point2.hpp"
+#include "SoA.hpp"
+#include "rng.hpp"
+#include "coordinate_system.hpp"
+#include "parallel.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+NAMESPACE_BEGIN(Distribution)
+
+// 按固定大小分块，在全局线程池上并行；块的划分与线程数无关，所以多线程构建的结果和单线程完全一致
+inline constexpr usize GRAIN = 16384;
+
+// cdf比func多一项，cdf[0] = 0，cdf[n] = 1；返回func在[0, 1]上的积分
+// 全为0时退化成均匀分布
+template <std::floating_point T>
+T build_cdf(std::span<const T> func, std::span<T> cdf)
+{
+    assert(cdf.size() == func.size() + 1);
+    const usize n = func.size();
+    f64 sum = 0;
+    for(usize i = 0; i < n; i++)
+        sum += fabs(func[i]);
+
+    // 前缀和用f64累加，避免f32在长数组上丢失精度
+    f64 prefix = 0;
+    cdf[0] = ZERO<T>;
+    for(usize i = 0; i < n; i++)
+    {
+        prefix += fabs(func[i]);
+        cdf[i + 1] = static_cast<T>(is_zero(sum) ? static_cast<f64>(i + 1) / n : prefix / sum);
+    }
+    cdf[n] = ONE<T>;
+    return static_cast<T>(sum / n);
+}
+
+// 满足cdf[i] <= u的最大的i，用条件移动代替分支
+template <std::floating_point T>
+constexpr usize find_interval(std::span<const T> cdf, T u)
+{
+    const T* base = cdf.data();
+    usize len = cdf.size() - 1;
+    while(len > 1)
+    {
+        const usize half = len / 2;
+        base = base[half] <= u ? base + half : base;
+        len -= half;
+    }
+    return static_cast<usize>(base - cdf.data());
+}
+
+// 返回[0, 1)内的样本、pdf和所在的区间
+template <std::floating_point T>
+constexpr std::tuple<T, T, usize>
+sample_continuous(std::span<const T> func, std::span<const T> cdf, T integral, T u)
+{
+    const usize n = func.size();
+    const usize offset = find_interval(cdf, u);
+    const T width = cdf[offset + 1] - cdf[offset];
+    const T du = width > ZERO<T> ? (u - cdf[offset]) / width : ZERO<T>;
+    const T x = min((static_cast<T>(offset) + du) / static_cast<T>(n), ONE<T> - std::numeric_limits<T>::epsilon() / 2);
+    const T pdf = integral > ZERO<T> ? fabs(func[offset]) / integral : ONE<T>;
+    return {x, pdf, offset};
+}
+
+NAMESPACE_END(Distribution)
+
+// Vose 1991，O(n)构建，O(1)采样的离散分布
+template <std::floating_point T>
+struct AliasTable
+{
+private:
+    struct Bin
+    {
+        T q;
+        std::uint32_t alias;
+    };
+
+    std::vector<Bin> bins;
+    std::vector<T> pmfs;
+
+public:
+    AliasTable() = default;
+
+    explicit AliasTable(std::span<const T> weights) : bins(weights.size()), pmfs(weights.size())
+    {
+        const usize n = weights.size();
+        assert(n > 0 && n <= MAX_NUMBER<std::uint32_t>);
+
+        // 求和与归一化按块并行
+        const usize chunks = (n + Distribution::GRAIN - 1) / Distribution::GRAIN;
+        std::vector<f64> partial(chunks);
+        parallel_for(0, chunks, 1, [&](usize c)
+        {
+            const usize end = min(n, (c + 1) * Distribution::GRAIN);
+            f64 sum = 0;
+            for(usize i = c * Distribution::GRAIN; i < end; i++) sum += fabs(weights[i]);
+            partial[c] = sum;
+        });
+        f64 sum = 0;
+        for(f64 s : partial) sum += s;
+
+        std::vector<f64> q(n);
+        parallel_for(0, n, Distribution::GRAIN, [&](usize begin, usize end)
+        {
+            for(usize i = begin; i < end; i++)
+            {
+                const f64 p = is_zero(sum) ? 1.0 / n : fabs(weights[i]) / sum;
+                pmfs[i] = static_cast<T>(p);
+                q[i] = p * n;
+            }
+        });
+
+        // 配对过程本身是串行的，q保留f64精度避免累积误差
+        std::vector<std::uint32_t> small, large;
+        for(usize i = 0; i < n; i++)
+            (q[i] < 1 ? small : large).push_back(static_cast<std::uint32_t>(i));
+        while(!small.empty() && !large.empty())
+        {
+            const std::uint32_t s = small.back(), l = large.back();
+            small.pop_back();
+            large.pop_back();
+            bins[s] = {static_cast<T>(q[s]), l};
+            q[l] -= 1 - q[s];
+            (q[l] < 1 ? small : large).push_back(l);
+        }
+        // 剩下的只差浮点误差，直接取自己
+        for(std::uint32_t i : small) bins[i] = {ONE<T>, i};
+        for(std::uint32_t i : large) bins[i] = {ONE<T>, i};
+    }
+
+    usize size() const { return bins.size(); }
+
+    T pmf(usize i) const { return pmfs[i]; }
+
+    // 返回序号和概率，u的剩余部分可以继续当作[0, 1)内的随机数使用
+    std::tuple<std::uint32_t, T> sample(T u, T* u_remapped = nullptr) const
+    {
+        const T scaled = u * static_cast<T>(bins.size());
+        const usize offset = min(static_cast<usize>(scaled), bins.size() - 1);
+        const T up = min(scaled - static_cast<T>(offset), ONE<T> - std::numeric_limits<T>::epsilon() / 2);
+        const Bin& bin = bins[offset];
+        const bool self = up < bin.q;
+        const std::uint32_t i = self ? static_cast<std::uint32_t>(offset) : bin.alias;
+        if(u_remapped)
+            *u_remapped = self ? up / bin.q : min((up - bin.q) / (ONE<T> - bin.q), ONE<T> - std::numeric_limits<T>::epsilon() / 2);
+        return {i, pmfs[i]};
+    }
+
+    std::tuple<std::uint32_t, T> sample(RNG<T>& rng) const { return sample(rng.get()); }
+
+    void sample(std::span<const T> u, std::span<std::uint32_t> index, std::span<T> pmf) const
+    {
+        assert(index.size() == u.size() && pmf.size() == u.size());
+        for(usize i = 0; i < u.size(); i++)
+            std::tie(index[i], pmf[i]) = sample(u[i]);
+    }
+};
+
+// [0, 1]上的分段常数分布
+template <std::floating_point T>
+struct Distribution1D
+{
+private:
+    std::vector<T> func;
+    std::vector<T> cdf;
+    T func_int = ZERO<T>;
+
+public:
+    Distribution1D() = default;
+
+    explicit Distribution1D(std::span<const T> f) : func(f.begin(), f.end()), cdf(f.size() + 1)
+    {
+        assert(!f.empty());
+        func_int = Distribution::build_cdf<T>(func, cdf);
+    }
+
+    usize size() const { return func.size(); }
+
+    T integral() const { return func_int; }
+
+    // [0, 1]以外的pdf为0
+    T pdf(T x) const
+    {
+        if(!(x >= ZERO<T> && x <= ONE<T>)) return ZERO<T>;
+        const usize offset = min(static_cast<usize>(x * static_cast<T>(func.size())), func.size() - 1);
+        return func_int > ZERO<T> ? fabs(func[offset]) / func_int : ONE<T>;
+    }
+
+    T discrete_pmf(usize i) const { return cdf[i + 1] - cdf[i]; }
+
+    // 返回样本、pdf和所在的区间
+    std::tuple<T, T, usize> sample_continuous(T u) const
+    {
+        return Distribution::sample_continuous<T>(func, cdf, func_int, u);
+    }
+
+    std::tuple<usize, T> sample_discrete(T u) const
+    {
+        const usize offset = Distribution::find_interval<T>(cdf, u);
+        return {offset, discrete_pmf(offset)};
+    }
+
+    std::tuple<T, T, usize> sample_continuous(RNG<T>& rng) const { return sample_continuous(rng.get()); }
+
+    void sample_continuous(std::span<const T> u, std::span<T> x, std::span<T> pdf) const
+    {
+        assert(x.size() == u.size() && pdf.size() == u.size());
+        for(usize i = 0; i < u.size(); i++)
+        {
+            const auto [s, p, _] = sample_continuous(u[i]);
+            x[i] = s;
+            pdf[i] = p;
+        }
+    }
+};
+
+// [0, 1]^2上的分段常数分布，先按边缘分布选行(v)，再按条件分布选列(u)
+// func按行存储，共nv行每行nu个
+template <std::floating_point T>
+struct Distribution2D
+{
+private:
+    usize nu = 0, nv = 0;
+    std::vector<T> func;
+    std::vector<T> cdf;
+    std::vector<T> row_integrals;
+    Distribution1D<T> marginal;
+
+    std::span<const T> row_func(usize v) const { return {func.data() + v * nu, nu}; }
+    std::span<const T> row_cdf(usize v) const { return {cdf.data() + v * (nu + 1), nu + 1}; }
+
+public:
+    Distribution2D() = default;
+
+    // 每一行的条件分布互相独立，按行并行构建
+    Distribution2D(std::span<const T> f, usize nu, usize nv)
+        : nu(nu), nv(nv), func(f.begin(), f.end()), cdf(nv * (nu + 1)), row_integrals(nv)
+    {
+        assert(nu > 0 && nv > 0 && f.size() == nu * nv);
+        const usize rows_per_chunk = max<usize>(1, Distribution::GRAIN / nu);
+        parallel_for(0, nv, rows_per_chunk, [&](usize begin, usize end)
+        {
+            for(usize v = begin; v < end; v++)
+                row_integrals[v] = Distribution::build_cdf<T>(row_func(v), {cdf.data() + v * (nu + 1), nu + 1});
+        });
+        marginal = Distribution1D<T>(row_integrals);
+    }
+
+    usize width() const { return nu; }
+    usize height() const { return nv; }
+
+    T integral() const { return marginal.integral(); }
+
+    std::tuple<Point2<T>, T> sample(const Point2<T>& u) const
+    {
+        const auto [y, pdf_v, v] = marginal.sample_continuous(u.y);
+        const auto [x, pdf_u, _] = Distribution::sample_continuous<T>(row_func(v), row_cdf(v), row_integrals[v], u.x);
+        return {{x, y}, pdf_u * pdf_v};
+    }
+
+    std::tuple<Point2<T>, T> sample(RNG<T>& rng) const
+    {
+        const T u = rng.get();
+        return sample(Point2<T>{u, rng.get()});
+    }
+
+    T pdf(const Point2<T>& p) const
+    {
+        if(!(p.x >= ZERO<T> && p.x <= ONE<T> && p.y >= ZERO<T> && p.y <= ONE<T>)) return ZERO<T>;
+        const usize iu = min(static_cast<usize>(p.x * static_cast<T>(nu)), nu - 1);
+        const usize iv = min(static_cast<usize>(p.y * static_cast<T>(nv)), nv - 1);
+        return marginal.integral() > ZERO<T> ? fabs(func[iv * nu + iu]) / marginal.integral() : ONE<T>;
+    }
+
+    void sample(std::span<const Point2<T>> u, Point2SoA<T> out, std::span<T> pdf) const
+    {
+        assert(out.size() == u.size() && pdf.size() == u.size());
+        for(usize i = 0; i < u.size(); i++)
+        {
+            const auto [p, density] = sample(u[i]);
+            out.set(i, p);
+            pdf[i] = density;
+        }
+    }
+};
+
+// 等距柱状投影的环境贴图: x对应phi∈[0, 2pi)，y对应theta∈[0, pi]
+// 构建分布时每一行的亮度需要乘上sin(theta)，pdf在这里换算成对立体角
+template <std::floating_point T>
+std::tuple<Vector3<T>, T> sample_equirectangular(const Distribution2D<T>& dist, const Point2<T>& u)
+{
+    const auto [uv, pdf_uv] = dist.sample(u);
+    const T theta = uv.y * PI<T>;
+    const T phi = uv.x * 2 * PI<T>;
+    const Point3<T> p = spherical_to_cartesian(Point3<T>{ONE<T>, theta, phi});
+    const T sin_theta = std::sin(theta);
+    const T pdf = sin_theta > ZERO<T> ? pdf_uv / (2 * PI<T> * PI<T> * sin_theta) : ZERO<T>;
+    return {{p.x, p.y, p.z}, pdf};
+}
+
+template <std::floating_point T>
+T equirectangular_pdf(const Distribution2D<T>& dist, const Vector3<T>& w)
+{
+    const Point3<T> s = cartesian_to_spherical(Point3<T>{w.x, w.y, w.z});
+    const T theta = s.y;
+    const T phi = s.z < ZERO<T> ? s.z + 2 * PI<T> : s.z;
+    const T sin_theta = std::sin(theta);
+    if(sin_theta <= ZERO<T>) return ZERO<T>;
+    return dist.pdf({phi * INV_2PI<T>, theta * INV_PI<T>}) / (2 * PI<T> * PI<T> * sin_theta);
+}
+
+NAMESPACE_END(Hinae)
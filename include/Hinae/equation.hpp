@@ -1,11 +1,342 @@
 #pragma once
 
+#ifdef USE_SIMD
+#include <immintrin.h>
+#endif
+
+#include <array>
+#include <span>
 #include <optional>
 
-#include "basic_type.hpp"
+#include "basic.hpp"
 
 NAMESPACE_BEGIN(Hinae)
 
+// 实根按升序存放，重根会重复出现
+template <std::floating_point T, usize N>
+struct Roots
+{
+    std::array<T, N> x{};
+    u32 count = 0;
+
+    constexpr void insert(T v)
+    {
+        assert(count < N);
+        usize i = count++;
+        for(; i > 0 && x[i - 1] > v; i--) x[i] = x[i - 1];
+        x[i] = v;
+    }
+
+    constexpr usize size() const { return count; }
+    constexpr bool empty() const { return count == 0; }
+
+    constexpr T operator [] (usize i) const { return x[i]; }
+
+    constexpr const T* begin() const { return x.data(); }
+    constexpr const T* end() const { return x.data() + count; }
+};
+
+NAMESPACE_BEGIN(Equation)
+
+// a * b - c * d
+// f32转成f64计算(乘积是精确的)，f64在有硬件fma时用Kahan的方法消除相减的抵消误差
+template <std::floating_point T>
+constexpr T difference_of_products(T a, T b, T c, T d)
+{
+    if constexpr(std::is_same_v<T, f32>)
+    {
+        return static_cast<f32>(static_cast<f64>(a) * b - static_cast<f64>(c) * d);
+    }
+    else
+    {
+#ifdef FP_FAST_FMA
+        if(!std::is_constant_evaluated() && std::is_same_v<T, f64>)
+        {
+            const T cd = c * d;
+            const T error = std::fma(-c, d, cd);
+            return std::fma(a, b, -cd) + error;
+        }
+#endif
+        return a * b - c * d;
+    }
+}
+
+// c[0]是最高次项系数，返回(f(x), f'(x))
+template <std::floating_point T, usize N>
+constexpr std::tuple<T, T> horner(const std::array<T, N>& c, T x)
+{
+    T f = c[0], df = 0;
+    for(usize i = 1; i < N; i++)
+    {
+        df = df * x + f;
+        f = f * x + c[i];
+    }
+    return {f, df};
+}
+
+// 在原多项式上做几次牛顿迭代，残差不再下降时停止，重根附近导数接近0也不会跑飞
+template <std::floating_point T, usize N>
+constexpr T polish(const std::array<T, N>& c, T x)
+{
+    auto [f, df] = horner(c, x);
+    for(usize i = 0; i < 4 && !is_zero(f) && !is_zero(df); i++)
+    {
+        const T next = x - f / df;
+        const auto [nf, ndf] = horner(c, next);
+        if(std::abs(nf) >= std::abs(f)) break;
+        x = next;
+        f = nf;
+        df = ndf;
+    }
+    return x;
+}
+
+// a * x^2 + 2 * half_b * x + c = 0，已知判别式det = half_b^2 - a * c时的两个根(较小的在前)
+// 较小的根用Vieta公式求；没有分支，det为负时结果无意义，由调用者丢弃
+template <std::floating_point T>
+constexpr std::tuple<T, T> sorted_roots(T a, T half_b, T c, T det)
+{
+    const T s = sqrt(max(det, ZERO<T>));
+    const T q = -(half_b + (half_b < 0 ? -s : s));
+    // q为0(b和c都是0)时c / q是NaN，先算出来再选择，循环里就没有条件执行的除法
+    const T cq = c / q;
+    const T r0 = q / a, r1 = is_zero(q) ? ZERO<T> : cq;
+    return {min(r0, r1), max(r0, r1)};
+}
+
+// f32的三次/四次方程条件数太差，内部用f64求解
+template <std::floating_point T>
+using wide_t = std::conditional_t<std::is_same_v<T, f32>, f64, T>;
+
+NAMESPACE_END(Equation)
+
+// a * x^2 + b * x + c = 0
+// a为0时退化成一次方程；用Vieta公式求较小的根，避免b^2远大于4ac时的抵消误差
+template <std::floating_point T>
+constexpr Roots<T, 2> solve_quadratic(T a, T b, T c)
+{
+    Roots<T, 2> ret;
+    if(is_zero(a))
+    {
+        if(!is_zero(b)) ret.insert(-c / b);
+        return ret;
+    }
+
+    const T det = Equation::difference_of_products(b, b, 4 * a, c);
+    if(det < 0) return ret;
+    const T s = sqrt(det);
+    const T q = -(b < 0 ? b - s : b + s) / 2;
+    if(is_zero(q))
+    {
+        // 只有b和c都是0时q才为0
+        ret.insert(ZERO<T>);
+        ret.insert(ZERO<T>);
+    }
+    else
+    {
+        ret.insert(q / a);
+        ret.insert(c / q);
+    }
+    return ret;
+}
+
+// a * x^3 + b * x^2 + c * x + d = 0
+// 三个实根时用三角形式，一个实根时用Cardano公式，最后在原方程上牛顿迭代修正
+template <std::floating_point T>
+Roots<T, 3> solve_cubic(T a, T b, T c, T d)
+{
+    Roots<T, 3> ret;
+    if(is_zero(a))
+    {
+        for(T x : solve_quadratic(b, c, d)) ret.insert(x);
+        return ret;
+    }
+
+    using W = Equation::wide_t<T>;
+    const std::array<W, 4> p{1, static_cast<W>(b) / a, static_cast<W>(c) / a, static_cast<W>(d) / a};
+    const W A = p[1], B = p[2], C = p[3];
+    const W Q = (A * A - 3 * B) / 9;
+    const W R = (A * (2 * A * A - 9 * B) + 27 * C) / 54;
+    const W Q3 = Q * Q * Q;
+
+    if(R * R <= Q3 && Q > 0)
+    {
+        const W theta = std::acos(clamp<W>(-1, R / std::sqrt(Q3), 1));
+        const W m = -2 * std::sqrt(Q);
+        for(W k : {W(0), W(1), W(-1)})
+            ret.insert(static_cast<T>(Equation::polish(p, m * std::cos((theta + k * 2 * PI<W>) / 3) - A / 3)));
+    }
+    else
+    {
+        const W S = -std::copysign(std::cbrt(std::abs(R) + std::sqrt(R * R - Q3)), R);
+        const W U = is_zero(S) ? 0 : Q / S;
+        ret.insert(static_cast<T>(Equation::polish(p, S + U - A / 3)));
+    }
+    return ret;
+}
+
+// a * x^4 + b * x^3 + c * x^2 + d * x + e = 0
+// Ferrari方法：消去三次项后用预解三次方程的最大根把四次式分解成两个二次式
+template <std::floating_point T>
+Roots<T, 4> solve_quartic(T a, T b, T c, T d, T e)
+{
+    Roots<T, 4> ret;
+    if(is_zero(a))
+    {
+        for(T x : solve_cubic(b, c, d, e)) ret.insert(x);
+        return ret;
+    }
+
+    using W = Equation::wide_t<T>;
+    const std::array<W, 5> coeff{1, static_cast<W>(b) / a, static_cast<W>(c) / a,
+                                 static_cast<W>(d) / a, static_cast<W>(e) / a};
+    const W A = coeff[1] / 4, B = coeff[2], C = coeff[3], D = coeff[4];
+
+    // x = y - A，y^4 + p * y^2 + q * y + r = 0
+    const W A2 = A * A;
+    const W p = B - 6 * A2;
+    const W q = C - 2 * B * A + 8 * A2 * A;
+    const W r = D - C * A + B * A2 - 3 * A2 * A2;
+
+    const auto add = [&](W y) { ret.insert(static_cast<T>(Equation::polish(coeff, y - A))); };
+
+    const auto resolvent = solve_cubic<W>(1, p, p * p / 4 - r, -q * q / 8);
+    const W m = resolvent[resolvent.size() - 1];
+    const W scale = max(std::abs(p), std::sqrt(std::abs(r)));
+    if(m > 16 * std::numeric_limits<W>::epsilon() * scale)
+    {
+        // (y^2 + p/2 + m)^2 = (sqrt(2m) * y - q / (2 * sqrt(2m)))^2
+        const W s = std::sqrt(2 * m);
+        const W t = q / (2 * s);
+        for(W y : solve_quadratic<W>(1, -s, p / 2 + m + t)) add(y);
+        for(W y : solve_quadratic<W>(1, s, p / 2 + m - t)) add(y);
+    }
+    else
+    {
+        // q接近0，按y^2的二次方程求解
+        for(W z : solve_quadratic<W>(1, p, r))
+        {
+            if(z < 0) continue;
+            const W y = std::sqrt(z);
+            add(-y);
+            add(y);
+        }
+    }
+    return ret;
+}
+
+// 批量求解SoA形式的二次方程，x0 <= x1，count是每个方程的实根个数，没有实根的方程两个根都填NaN
+// 循环体没有分支，可以被编译器自动向量化；返回有实根的方程个数
+template <std::floating_point T>
+usize solve_quadratic(std::span<const T> a, std::span<const T> b, std::span<const T> c,
+                      std::span<T> x0, std::span<T> x1, std::span<std::uint8_t> count)
+{
+    assert(b.size() == a.size() && c.size() == a.size());
+    assert(x0.size() == a.size() && x1.size() == a.size() && count.size() == a.size());
+    constexpr T nan = std::numeric_limits<T>::quiet_NaN();
+    usize ret = 0;
+    for(usize i = 0; i < a.size(); i++)
+    {
+        const T ai = a[i], bi = b[i], ci = c[i];
+        const T det = Equation::difference_of_products(bi, bi, 4 * ai, ci);
+        const auto [r0, r1] = Equation::sorted_roots(ai, bi / 2, ci, det / 4);
+        const T linear = -ci / bi;
+
+        const bool is_linear = is_zero(ai);
+        const std::uint8_t n = is_linear ? (is_zero(bi) ? 0 : 1) : (det < 0 ? 0 : 2);
+        x0[i] = n == 0 ? nan : is_linear ? linear : r0;
+        x1[i] = n == 0 ? nan : is_linear ? linear : r1;
+        count[i] = n;
+        ret += n != 0;
+    }
+    return ret;
+}
+
+#ifdef USE_SIMD
+NAMESPACE_BEGIN(Equation)
+
+// 4个方程一组，判别式同样转成f64计算，结果和标量版本一致；返回有实根的方程的掩码
+inline int sse_quadratic(const f32* a, const f32* b, const f32* c, f32* x0, f32* x1)
+{
+    const __m128 va = _mm_loadu_ps(a), vb = _mm_loadu_ps(b), vc = _mm_loadu_ps(c);
+    const __m128 zero = _mm_setzero_ps(), sign = _mm_set1_ps(-0.0f);
+
+    const auto det_pd = [](__m128 a, __m128 b, __m128 c)
+    {
+        const __m128d ad = _mm_cvtps_pd(_mm_mul_ps(_mm_set1_ps(4), a));
+        const __m128d bd = _mm_cvtps_pd(b), cd = _mm_cvtps_pd(c);
+        return _mm_cvtpd_ps(_mm_sub_pd(_mm_mul_pd(bd, bd), _mm_mul_pd(ad, cd)));
+    };
+    const __m128 det = _mm_movelh_ps(det_pd(va, vb, vc),
+                                     det_pd(_mm_movehl_ps(va, va), _mm_movehl_ps(vb, vb), _mm_movehl_ps(vc, vc)));
+
+    // q = -(b + copysign(s, b)) / 2
+    const __m128 s = _mm_sqrt_ps(_mm_max_ps(det, zero));
+    const __m128 q = _mm_mul_ps(_mm_xor_ps(_mm_add_ps(vb, _mm_or_ps(s, _mm_and_ps(vb, sign))), sign), _mm_set1_ps(0.5f));
+    const __m128 r0 = _mm_div_ps(q, va);
+    const __m128 r1 = _mm_andnot_ps(_mm_cmpeq_ps(q, zero), _mm_div_ps(vc, q));
+    const __m128 linear = _mm_div_ps(_mm_xor_ps(vc, sign), vb);
+
+    const __m128 is_linear = _mm_cmpeq_ps(va, zero);
+    const __m128 has_quadratic = _mm_andnot_ps(is_linear, _mm_cmpge_ps(det, zero));
+    const __m128 has_linear = _mm_and_ps(is_linear, _mm_cmpneq_ps(vb, zero));
+
+    const auto select = [](__m128 mask, __m128 x, __m128 y) { return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, y)); };
+    const __m128 nan = _mm_set1_ps(std::numeric_limits<f32>::quiet_NaN());
+    _mm_storeu_ps(x0, select(has_quadratic, _mm_min_ps(r0, r1), select(has_linear, linear, nan)));
+    _mm_storeu_ps(x1, select(has_quadratic, _mm_max_ps(r0, r1), select(has_linear, linear, nan)));
+    return _mm_movemask_ps(_mm_or_ps(has_quadratic, has_linear));
+}
+
+NAMESPACE_END(Equation)
+#endif
+
+// 一组N个方程(射线包)，返回有实根的方程的位掩码，第i位对应第i个方程
+// 只有一个根(a为0)时x0 == x1，没有实根时填NaN；定义USE_SIMD时f32每4个一组用SSE计算
+template <std::floating_point T, usize N>
+std::uint32_t solve_quadratic(const std::array<T, N>& a, const std::array<T, N>& b, const std::array<T, N>& c,
+                              std::array<T, N>& x0, std::array<T, N>& x1)
+{
+    static_assert(N <= 32);
+#ifdef USE_SIMD
+    if constexpr(std::is_same_v<T, f32> && N % 4 == 0)
+    {
+        std::uint32_t mask = 0;
+        for(usize i = 0; i < N; i += 4)
+            mask |= static_cast<std::uint32_t>(Equation::sse_quadratic(&a[i], &b[i], &c[i], &x0[i], &x1[i])) << i;
+        return mask;
+    }
+#endif
+    std::array<std::uint8_t, N> count;
+    solve_quadratic<T>(a, b, c, x0, x1, count);
+    std::uint32_t mask = 0;
+    for(usize i = 0; i < N; i++)
+        mask |= static_cast<std::uint32_t>(count[i] != 0) << i;
+    return mask;
+}
+
+// 三次/四次方程的批量版本逐个调用标量版本：三角函数和立方根的分支没有对应的SSE指令
+template <std::floating_point T>
+void solve_cubic(std::span<const T> a, std::span<const T> b, std::span<const T> c, std::span<const T> d,
+                 std::span<Roots<T, 3>> out)
+{
+    assert(b.size() == a.size() && c.size() == a.size() && d.size() == a.size() && out.size() == a.size());
+    for(usize i = 0; i < a.size(); i++)
+        out[i] = solve_cubic(a[i], b[i], c[i], d[i]);
+}
+
+template <std::floating_point T>
+void solve_quartic(std::span<const T> a, std::span<const T> b, std::span<const T> c, std::span<const T> d,
+                   std::span<const T> e, std::span<Roots<T, 4>> out)
+{
+    assert(b.size() == a.size() && c.size() == a.size() && d.size() == a.size());
+    assert(e.size() == a.size() && out.size() == a.size());
+    for(usize i = 0; i < a.size(); i++)
+        out[i] = solve_quartic(a[i], b[i], c[i], d[i], e[i]);
+}
+
+// 旧接口，保持原来的行为不变：返回(c / q, q / a)，两个根不排序；a为0时第二个值是无穷大或NaN
+// 新代码请使用solve_quadratic
 template <arithmetic T>
 std::optional<std::tuple<T, T>> quadratic(T a, T b, T c)
 {
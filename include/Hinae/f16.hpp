@@ -0,0 +1,173 @@
+#pragma once
+
+#if defined(USE_SIMD) && defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+#include <compare>
+#include <bit>
+#include <span>
+
+#include "basic.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+// IEEE 754 binary16，round to nearest even
+constexpr std::uint16_t f32_to_f16_bits(f32 value)
+{
+    const std::uint32_t x = std::bit_cast<std::uint32_t>(value);
+    const std::uint32_t sign = (x >> 16) & 0x8000;
+    const std::uint32_t abs = x & 0x7fffffff;
+
+    // inf和nan，nan保留高位尾数并强制为quiet nan
+    if(abs >= 0x7f800000)
+        return static_cast<std::uint16_t>(sign | 0x7c00 | (abs > 0x7f800000 ? 0x200 | ((abs >> 13) & 0x3ff) : 0));
+    // 大于等于65520会舍入到inf
+    if(abs >= 0x477ff000)
+        return static_cast<std::uint16_t>(sign | 0x7c00);
+    // 半精度的非规格化数
+    if(abs < 0x38800000)
+    {
+        if(abs <= 0x33000000) return static_cast<std::uint16_t>(sign);
+        const std::uint32_t shift = 126 - (abs >> 23);
+        const std::uint32_t m = (abs & 0x7fffff) | 0x800000;
+        const std::uint32_t rem = m & ((1u << shift) - 1);
+        const std::uint32_t half = 1u << (shift - 1);
+        std::uint32_t q = m >> shift;
+        if(rem > half || (rem == half && (q & 1))) q++;
+        return static_cast<std::uint16_t>(sign | q);
+    }
+
+    const std::uint32_t h = abs - 0x38000000;
+    return static_cast<std::uint16_t>(sign | ((h + 0xfff + ((h >> 13) & 1)) >> 13));
+}
+
+constexpr f32 f16_bits_to_f32(std::uint16_t value)
+{
+    const std::uint32_t sign = static_cast<std::uint32_t>(value & 0x8000) << 16;
+    std::uint32_t e = (value >> 10) & 0x1f;
+    std::uint32_t m = value & 0x3ff;
+
+    if(e == 0x1f)
+        return std::bit_cast<f32>(sign | 0x7f800000 | (m << 13));
+    if(e == 0)
+    {
+        if(m == 0) return std::bit_cast<f32>(sign);
+        e = 1;
+        while(!(m & 0x400))
+        {
+            m <<= 1;
+            e--;
+        }
+        m &= 0x3ff;
+    }
+    return std::bit_cast<f32>(sign | ((e + 112) << 23) | (m << 13));
+}
+
+struct f16
+{
+    std::uint16_t bits;
+
+    constexpr f16() = default;
+
+    template <typename U> requires std::is_arithmetic_v<U>
+    constexpr f16(U value) : bits(f32_to_f16_bits(static_cast<f32>(value))) {}
+
+    static constexpr f16 from_bits(std::uint16_t bits)
+    {
+        f16 ret;
+        ret.bits = bits;
+        return ret;
+    }
+
+    template <typename U> requires std::is_arithmetic_v<U>
+    constexpr explicit operator U () const { return static_cast<U>(f16_bits_to_f32(bits)); }
+
+    constexpr f16 operator - () const { return from_bits(bits ^ 0x8000); }
+
+    friend constexpr f16 operator + (f16 lhs, f16 rhs) { return static_cast<f32>(lhs) + static_cast<f32>(rhs); }
+    friend constexpr f16 operator - (f16 lhs, f16 rhs) { return static_cast<f32>(lhs) - static_cast<f32>(rhs); }
+    friend constexpr f16 operator * (f16 lhs, f16 rhs) { return static_cast<f32>(lhs) * static_cast<f32>(rhs); }
+    friend constexpr f16 operator / (f16 lhs, f16 rhs) { return static_cast<f32>(lhs) / static_cast<f32>(rhs); }
+
+    constexpr f16& operator += (f16 rhs) { return *this = *this + rhs; }
+    constexpr f16& operator -= (f16 rhs) { return *this = *this - rhs; }
+    constexpr f16& operator *= (f16 rhs) { return *this = *this * rhs; }
+    constexpr f16& operator /= (f16 rhs) { return *this = *this / rhs; }
+
+    friend constexpr bool operator == (f16 lhs, f16 rhs)
+    {
+        return static_cast<f32>(lhs) == static_cast<f32>(rhs);
+    }
+
+    friend constexpr std::partial_ordering operator <=> (f16 lhs, f16 rhs)
+    {
+        return static_cast<f32>(lhs) <=> static_cast<f32>(rhs);
+    }
+};
+
+static_assert(sizeof(f16) == 2);
+
+inline std::ostream& operator << (std::ostream& os, f16 x)
+{
+    return os << static_cast<f32>(x);
+}
+
+inline void to_f16(std::span<const f32> from, std::span<f16> to)
+{
+    assert(from.size() == to.size());
+    usize i = 0;
+#if defined(USE_SIMD) && defined(__F16C__)
+    for(; i + 8 <= from.size(); i += 8)
+    {
+        const __m128i h = _mm256_cvtps_ph(_mm256_loadu_ps(&from[i]), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&to[i]), h);
+    }
+#endif
+    for(; i < from.size(); i++)
+        to[i] = from[i];
+}
+
+inline void to_f32(std::span<const f16> from, std::span<f32> to)
+{
+    assert(from.size() == to.size());
+    usize i = 0;
+#if defined(USE_SIMD) && defined(__F16C__)
+    for(; i + 8 <= from.size(); i += 8)
+    {
+        const __m128i h = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&from[i]));
+        _mm256_storeu_ps(&to[i], _mm256_cvtph_ps(h));
+    }
+#endif
+    for(; i < from.size(); i++)
+        to[i] = static_cast<f32>(from[i]);
+}
+
+// Vector3<f16>/Point3<f16>等几何体的批量转换，按分量展开成一维数组处理
+template <template <storage> typename T>
+void to_f16(std::span<const T<f32>> from, std::span<T<f16>> to)
+{
+    constexpr usize n = sizeof(T<f32>) / sizeof(f32);
+    static_assert(sizeof(T<f16>) == n * sizeof(f16));
+    assert(from.size() == to.size());
+    to_f16
+    (
+        std::span<const f32>{reinterpret_cast<const f32*>(from.data()), from.size() * n},
+        std::span<f16>{reinterpret_cast<f16*>(to.data()), to.size() * n}
+    );
+}
+
+template <template <storage> typename T>
+void to_f32(std::span<const T<f16>> from, std::span<T<f32>> to)
+{
+    constexpr usize n = sizeof(T<f32>) / sizeof(f32);
+    static_assert(sizeof(T<f16>) == n * sizeof(f16));
+    assert(from.size() == to.size());
+    to_f32
+    (
+        std::span<const f16>{reinterpret_cast<const f16*>(from.data()), from.size() * n},
+        std::span<f32>{reinterpret_cast<f32*>(to.data()), to.size() * n}
+    );
+}
+
+NAMESPACE_END(Hinae)
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <vector>
+
+#include "physics.hpp"
+#include "f16.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+template <typename S>
+concept fresnel_storage = std::same_as<S, f32> || std::same_as<S, f16>;
+
+enum class Interpolation
+{
+    Linear,
+    Cubic,
+};
+
+// 每种材质预先按cos_theta均匀采样一次，之后用插值代替解析计算
+// 电介质只存进入介质的一侧，从内部射出时按互易性换算成透射角再查表，避开全反射临界角处的尖点
+template <fresnel_storage S = f32>
+struct FresnelTable
+{
+private:
+    // 两端各多存一个外插的点，三次插值读取相邻4个点时不需要边界判断
+    std::vector<S> values;
+    f32 scale = 0;
+    usize n = 0;
+
+    f32 eta = 1, k = 0;
+    bool is_dielectric = false;
+
+    f32 load(usize i) const { return static_cast<f32>(values[i]); }
+
+    FresnelTable(f32 eta, f32 k, bool is_dielectric, usize size)
+        : values(size + 2), scale(static_cast<f32>(size - 1)), n(size), eta(eta), k(k), is_dielectric(is_dielectric)
+    {
+        assert(size >= 4);
+        std::vector<f64> v(size);
+        for(usize i = 0; i < size; i++)
+            v[i] = reference(static_cast<f64>(i) / static_cast<f64>(size - 1));
+        for(usize i = 0; i < size; i++)
+            values[i + 1] = static_cast<S>(static_cast<f32>(v[i]));
+        values[0] = static_cast<S>(static_cast<f32>(2 * v[0] - v[1]));
+        values[size + 1] = static_cast<S>(static_cast<f32>(2 * v[size - 1] - v[size - 2]));
+    }
+
+    // 表中存的是cos_theta∈[0, 1]一侧的值
+    f64 reference(f64 cos_theta) const
+    {
+        return is_dielectric ? Fresnel::dielectric<f64>(cos_theta, eta)
+                             : Fresnel::conductor<f64>(cos_theta, eta, k);
+    }
+
+    template <Interpolation I>
+    f32 interpolate(f32 x) const
+    {
+        const f32 t = clamp(ZERO<f32>, x * scale, scale);
+        const usize i = min(static_cast<usize>(t), n - 2);
+        const f32 f = t - static_cast<f32>(i);
+        const f32 p1 = load(i + 1), p2 = load(i + 2);
+        if constexpr(I == Interpolation::Linear)
+        {
+            return p1 + f * (p2 - p1);
+        }
+        else
+        {
+            // Catmull-Rom
+            const f32 p0 = load(i), p3 = load(i + 3);
+            const f32 a = -p0 + 3 * p1 - 3 * p2 + p3;
+            const f32 b = 2 * p0 - 5 * p1 + 4 * p2 - p3;
+            const f32 c = p2 - p0;
+            return clamp(ZERO<f32>, p1 + f * (c + f * (b + f * a)) / 2, ONE<f32>);
+        }
+    }
+
+public:
+    FresnelTable() = default;
+
+    // eta是相对折射率
+    static FresnelTable dielectric(f32 eta, usize size = 256)
+    {
+        return FresnelTable(eta, 0, true, size);
+    }
+
+    static FresnelTable conductor(f32 eta, f32 k, usize size = 256)
+    {
+        return FresnelTable(eta, k, false, size);
+    }
+
+    usize size() const { return n; }
+
+    usize bytes() const { return values.size() * sizeof(S); }
+
+    template <Interpolation I = Interpolation::Linear>
+    f32 eval(f32 cos_theta_i) const
+    {
+        const f32 c = clamp(-ONE<f32>, cos_theta_i, ONE<f32>);
+        const bool exiting = is_dielectric && c < ZERO<f32>;
+        const f32 sin2_t = (ONE<f32> - c * c) * eta * eta;
+        const f32 x = exiting ? sqrt(max(ZERO<f32>, ONE<f32> - sin2_t)) : max(c, ZERO<f32>);
+        const f32 value = interpolate<I>(x);
+        return exiting && sin2_t >= ONE<f32> ? ONE<f32> : value;
+    }
+
+    template <Interpolation I = Interpolation::Linear>
+    void eval(std::span<const f32> cos_theta_i, std::span<f32> out) const
+    {
+        assert(out.size() == cos_theta_i.size());
+        for(usize i = 0; i < out.size(); i++)
+            out[i] = eval<I>(cos_theta_i[i]);
+    }
+
+    // 在[-1, 1](导体是[0, 1])上均匀取点(包括两端，至少2个)，和解析结果比较的最大绝对误差
+    template <Interpolation I = Interpolation::Linear>
+    f32 max_error(usize samples = 4096) const
+    {
+        assert(samples >= 2);
+        const f64 lo = is_dielectric ? -1.0 : 0.0;
+        const f64 intervals = static_cast<f64>(max<usize>(samples - 1, 1));
+        f64 ret = 0;
+        for(usize i = 0; i < samples; i++)
+        {
+            const f64 c = lo + (1.0 - lo) * static_cast<f64>(i) / intervals;
+            const f64 expect = is_dielectric ? Fresnel::dielectric<f64>(c, eta) : Fresnel::conductor<f64>(c, eta, k);
+            ret = max(ret, std::abs(expect - static_cast<f64>(eval<I>(static_cast<f32>(c)))));
+        }
+        return static_cast<f32>(ret);
+    }
+};
+
+NAMESPACE_END(Hinae)
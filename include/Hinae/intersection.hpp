@@ -0,0 +1,343 @@
+#pragma once
+
+#include <array>
+#include <optional>
+
+#include "Ray3.hpp"
+#include "SoA.hpp"
+#include "equation.hpp"
+#include "stats.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+template <std::floating_point T>
+struct Sphere
+{
+    Point3<T> center;
+    T radius;
+};
+
+// normal是单位向量
+template <std::floating_point T>
+struct Disk
+{
+    Point3<T> center;
+    Vector3<T> normal;
+    T radius;
+};
+
+// 不带端盖的圆柱，轴从base出发沿单位向量axis延伸height
+template <std::floating_point T>
+struct Cylinder
+{
+    Point3<T> base;
+    Vector3<T> axis;
+    T radius, height;
+};
+
+// 法线都是朝外的几何法线，index是命中的图元在SoA中的下标
+template <std::floating_point T>
+struct PrimitiveHit
+{
+    T t;
+    Vector3<T> normal;
+    usize index = 0;
+};
+
+template <std::floating_point T>
+struct SphereSoA
+{
+    Point3SoA<const T> center;
+    std::span<const T> radius;
+
+    usize size() const { return radius.size(); }
+    Sphere<T> operator [] (usize i) const { return {center[i], radius[i]}; }
+};
+
+template <std::floating_point T>
+struct DiskSoA
+{
+    Point3SoA<const T> center;
+    Vector3SoA<const T> normal;
+    std::span<const T> radius;
+
+    usize size() const { return radius.size(); }
+    Disk<T> operator [] (usize i) const { return {center[i], normal[i], radius[i]}; }
+};
+
+template <std::floating_point T>
+struct CylinderSoA
+{
+    Point3SoA<const T> base;
+    Vector3SoA<const T> axis;
+    std::span<const T> radius, height;
+
+    usize size() const { return radius.size(); }
+    Cylinder<T> operator [] (usize i) const { return {base[i], axis[i], radius[i], height[i]}; }
+};
+
+NAMESPACE_BEGIN(Intersection)
+
+// 下面的函数返回(0, t_max)内最近的交点的t，没有交点时返回无穷大，都没有分支
+// 二次方程的判别式按Hearn-Baker的方法写成 a * (r^2 - |f - (b / a) * d|^2)，
+// 图元很小或者离光线原点很远时不会像 b^2 - ac 那样抵消掉全部有效位
+// 条件之间用&而不是&&连接，短路求值产生的分支会让循环无法向量化
+
+// t0 <= t1，写成两次选择加min，编译器可以把它变成掩码运算
+template <std::floating_point T>
+constexpr T nearest(T t0, T t1, bool valid0, bool valid1)
+{
+    return min(valid0 ? t0 : INFINITY_<T>, valid1 ? t1 : INFINITY_<T>);
+}
+
+template <std::floating_point T>
+constexpr T sphere(const Point3<T>& o, const Vector3<T>& d, T t_max, const Point3<T>& center, T radius)
+{
+    const Vector3<T> f = o - center;
+    const T a = dot(d, d), b = dot(f, d), c = dot(f, f) - radius * radius;
+    const Vector3<T> l = f - d * (b / a);
+    const T det = a * (radius * radius - dot(l, l));
+    const auto [t0, t1] = Equation::sorted_roots(a, b, c, det);
+    const bool hit = det >= 0;
+    return nearest(t0, t1, hit & (t0 > 0) & (t0 < t_max), hit & (t1 > 0) & (t1 < t_max));
+}
+
+template <std::floating_point T>
+constexpr T disk(const Point3<T>& o, const Vector3<T>& d, T t_max, const Point3<T>& center, const Vector3<T>& normal, T radius)
+{
+    // 光线平行于圆盘时t是无穷大或NaN，比较结果都是false
+    const T t = dot(center - o, normal) / dot(d, normal);
+    const Vector3<T> p = (o - center) + d * t;
+    return (t > 0) & (t < t_max) & (dot(p, p) <= radius * radius) ? t : INFINITY_<T>;
+}
+
+template <std::floating_point T>
+constexpr T cylinder(const Point3<T>& o, const Vector3<T>& d, T t_max, const Point3<T>& base, const Vector3<T>& axis, T radius, T height)
+{
+    // 投影到垂直于轴的平面上，变成二维的圆求交
+    const Vector3<T> f = o - base;
+    const T fa = dot(f, axis), da = dot(d, axis);
+    const Vector3<T> fp = f - axis * fa, dp = d - axis * da;
+    const T a = dot(dp, dp), b = dot(fp, dp), c = dot(fp, fp) - radius * radius;
+    const Vector3<T> l = fp - dp * (b / a);
+    const T det = a * (radius * radius - dot(l, l));
+    const auto [t0, t1] = Equation::sorted_roots(a, b, c, det);
+
+    // 光线平行于轴时a为0，det是NaN
+    const bool hit = det >= 0;
+    const T h0 = fa + da * t0, h1 = fa + da * t1;
+    return nearest(t0, t1, hit & (t0 > 0) & (t0 < t_max) & (h0 >= 0) & (h0 <= height),
+                           hit & (t1 > 0) & (t1 < t_max) & (h1 >= 0) & (h1 <= height));
+}
+
+// Möller-Trumbore，不剔除背面；退化三角形的det为0，u/v是无穷大或NaN，比较结果都是false
+template <std::floating_point T>
+constexpr T triangle(const Point3<T>& o, const Vector3<T>& d, T t_max, const Point3<T>& p0, const Point3<T>& p1, const Point3<T>& p2)
+{
+    const Vector3<T> e1 = p1 - p0, e2 = p2 - p0;
+    const Vector3<T> p = cross(d, e2);
+    const T inv_det = ONE<T> / dot(e1, p);
+    const Vector3<T> s = o - p0;
+    const Vector3<T> q = cross(s, e1);
+    const T u = dot(s, p) * inv_det;
+    const T v = dot(d, q) * inv_det;
+    const T t = dot(e2, q) * inv_det;
+    return (u >= 0) & (v >= 0) & (u + v <= 1) & (t > 0) & (t < t_max) ? t : INFINITY_<T>;
+}
+
+template <std::floating_point T>
+constexpr Vector3<T> normal(const Sphere<T>& s, const Point3<T>& p) { return (p - s.center) / s.radius; }
+
+template <std::floating_point T>
+constexpr Vector3<T> normal(const Disk<T>& d, const Point3<T>&) { return d.normal; }
+
+template <std::floating_point T>
+constexpr Vector3<T> normal(const Cylinder<T>& c, const Point3<T>& p)
+{
+    const Vector3<T> f = p - c.base;
+    return (f - c.axis * dot(f, c.axis)) / c.radius;
+}
+
+// 每N个图元一组求交，组内没有分支，组与组之间用当前最近的t裁剪
+// 最后只对最近的图元计算一次法线
+template <usize N, std::floating_point T, typename SoA, typename F>
+std::optional<PrimitiveHit<T>> closest(const Ray3<T>& ray, T t_max, const SoA& primitives, F&& kernel)
+{
+    T best = t_max;
+    usize index = primitives.size();
+    const usize n = primitives.size();
+    Stats::count<Stat::PrimitiveTests>(n);
+
+    usize i = 0;
+    for(; i + N <= n; i += N)
+    {
+        std::array<T, N> t;
+        for(usize j = 0; j < N; j++)
+            t[j] = kernel(i + j, best);
+
+        T group = t[0];
+        usize lane = 0;
+        for(usize j = 1; j < N; j++)
+        {
+            lane = t[j] < group ? j : lane;
+            group = min(group, t[j]);
+        }
+        if(group < best)
+        {
+            best = group;
+            index = i + lane;
+        }
+    }
+    for(; i < n; i++)
+    {
+        const T t = kernel(i, best);
+        if(t < best)
+        {
+            best = t;
+            index = i;
+        }
+    }
+
+    if(index == n) return std::nullopt;
+    const auto primitive = primitives[index];
+    return PrimitiveHit<T>{best, Intersection::normal(primitive, ray.at(best)), index};
+}
+
+// 一组光线和同一个图元求交，命中更近的交点时更新t_max和normal
+// 每N条光线先拷到栈上的数组里再计算，编译器不需要检查输入输出是否重叠，组内的循环可以直接向量化
+template <usize N, std::floating_point T, typename Primitive, typename F>
+usize batch(Point3SoA<const T> origin, Vector3SoA<const T> direction, const Primitive primitive,
+            std::span<T> t_max, Vector3SoA<T> normal, F&& kernel)
+{
+    assert(direction.size() == origin.size() && t_max.size() == origin.size() && normal.size() == origin.size());
+    Stats::batch<Stat::PrimitiveTests>(origin.size());
+    usize ret = 0;
+    for(usize i = 0; i < origin.size(); i += N)
+    {
+        const usize m = min(N, origin.size() - i);
+        std::array<T, N> ox, oy, oz, dx, dy, dz, t, nx, ny, nz, updated;
+        for(usize j = 0; j < m; j++)
+        {
+            ox[j] = origin.x[i + j];    oy[j] = origin.y[i + j];    oz[j] = origin.z[i + j];
+            dx[j] = direction.x[i + j]; dy[j] = direction.y[i + j]; dz[j] = direction.z[i + j];
+            t[j] = t_max[i + j];
+            nx[j] = normal.x[i + j];    ny[j] = normal.y[i + j];    nz[j] = normal.z[i + j];
+        }
+
+        for(usize j = 0; j < m; j++)
+        {
+            const Point3<T> o{ox[j], oy[j], oz[j]};
+            const Vector3<T> d{dx[j], dy[j], dz[j]};
+            const T t_hit = kernel(primitive, o, d, t[j]);
+            const bool hit = t_hit < t[j];
+            const Vector3<T> n = Intersection::normal(primitive, o + d * (hit ? t_hit : ZERO<T>));
+            t[j] = hit ? t_hit : t[j];
+            nx[j] = hit ? n.x : nx[j];
+            ny[j] = hit ? n.y : ny[j];
+            nz[j] = hit ? n.z : nz[j];
+            updated[j] = hit ? ONE<T> : ZERO<T>;
+        }
+
+        for(usize j = 0; j < m; j++)
+        {
+            t_max[i + j] = t[j];
+            normal.x[i + j] = nx[j]; normal.y[i + j] = ny[j]; normal.z[i + j] = nz[j];
+            ret += updated[j] != 0;
+        }
+    }
+    return ret;
+}
+
+NAMESPACE_END(Intersection)
+
+// 单条光线
+
+template <std::floating_point T>
+constexpr std::optional<PrimitiveHit<T>> intersect(const Ray3<T>& ray, T t_max, const Sphere<T>& s)
+{
+    Stats::count<Stat::PrimitiveTests>();
+    const T t = Intersection::sphere(ray.origin, ray.direction, t_max, s.center, s.radius);
+    if(t == INFINITY_<T>) return std::nullopt;
+    return PrimitiveHit<T>{t, Intersection::normal(s, ray.at(t))};
+}
+
+template <std::floating_point T>
+constexpr std::optional<PrimitiveHit<T>> intersect(const Ray3<T>& ray, T t_max, const Disk<T>& d)
+{
+    Stats::count<Stat::PrimitiveTests>();
+    const T t = Intersection::disk(ray.origin, ray.direction, t_max, d.center, d.normal, d.radius);
+    if(t == INFINITY_<T>) return std::nullopt;
+    return PrimitiveHit<T>{t, d.normal};
+}
+
+template <std::floating_point T>
+constexpr std::optional<PrimitiveHit<T>> intersect(const Ray3<T>& ray, T t_max, const Cylinder<T>& c)
+{
+    Stats::count<Stat::PrimitiveTests>();
+    const T t = Intersection::cylinder(ray.origin, ray.direction, t_max, c.base, c.axis, c.radius, c.height);
+    if(t == INFINITY_<T>) return std::nullopt;
+    return PrimitiveHit<T>{t, Intersection::normal(c, ray.at(t))};
+}
+
+// 一条光线和一组SoA图元求交，每N个图元一组，返回最近的交点
+
+template <usize N = 16, std::floating_point T>
+std::optional<PrimitiveHit<T>> intersect(const Ray3<T>& ray, T t_max, const SphereSoA<T>& s)
+{
+    return Intersection::closest<N>(ray, t_max, s, [&](usize i, T t)
+    {
+        return Intersection::sphere(ray.origin, ray.direction, t, s.center[i], s.radius[i]);
+    });
+}
+
+template <usize N = 16, std::floating_point T>
+std::optional<PrimitiveHit<T>> intersect(const Ray3<T>& ray, T t_max, const DiskSoA<T>& d)
+{
+    return Intersection::closest<N>(ray, t_max, d, [&](usize i, T t)
+    {
+        return Intersection::disk(ray.origin, ray.direction, t, d.center[i], d.normal[i], d.radius[i]);
+    });
+}
+
+template <usize N = 16, std::floating_point T>
+std::optional<PrimitiveHit<T>> intersect(const Ray3<T>& ray, T t_max, const CylinderSoA<T>& c)
+{
+    return Intersection::closest<N>(ray, t_max, c, [&](usize i, T t)
+    {
+        return Intersection::cylinder(ray.origin, ray.direction, t, c.base[i], c.axis[i], c.radius[i], c.height[i]);
+    });
+}
+
+// 一组SoA光线和同一个图元求交，每N条光线一组，t_max既是输入也是输出，返回命中的光线数
+
+template <usize N = 16, std::floating_point T>
+usize intersect(Point3SoA<const T> origin, Vector3SoA<const T> direction, const Sphere<T>& s,
+                std::span<T> t_max, Vector3SoA<T> normal)
+{
+    return Intersection::batch<N>(origin, direction, s, t_max, normal, [](const Sphere<T>& s, const Point3<T>& o, const Vector3<T>& d, T t)
+    {
+        return Intersection::sphere(o, d, t, s.center, s.radius);
+    });
+}
+
+template <usize N = 16, std::floating_point T>
+usize intersect(Point3SoA<const T> origin, Vector3SoA<const T> direction, const Disk<T>& disk,
+                std::span<T> t_max, Vector3SoA<T> normal)
+{
+    return Intersection::batch<N>(origin, direction, disk, t_max, normal, [](const Disk<T>& disk, const Point3<T>& o, const Vector3<T>& d, T t)
+    {
+        return Intersection::disk(o, d, t, disk.center, disk.normal, disk.radius);
+    });
+}
+
+template <usize N = 16, std::floating_point T>
+usize intersect(Point3SoA<const T> origin, Vector3SoA<const T> direction, const Cylinder<T>& c,
+                std::span<T> t_max, Vector3SoA<T> normal)
+{
+    return Intersection::batch<N>(origin, direction, c, t_max, normal, [](const Cylinder<T>& c, const Point3<T>& o, const Vector3<T>& d, T t)
+    {
+        return Intersection::cylinder(o, d, t, c.base, c.axis, c.radius, c.height);
+    });
+}
+
+NAMESPACE_END(Hinae)
@@ -0,0 +1,291 @@
+#pragma once
+
+#include <vector>
+
+#include "rng.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+constexpr std::uint32_t reverse_bits(std::uint32_t x)
+{
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ff) << 8) | ((x & 0xff00ff00) >> 8);
+    x = ((x & 0x0f0f0f0f) << 4) | ((x & 0xf0f0f0f0) >> 4);
+    x = ((x & 0x33333333) << 2) | ((x & 0xcccccccc) >> 2);
+    x = ((x & 0x55555555) << 1) | ((x & 0xaaaaaaaa) >> 1);
+    return x;
+}
+
+constexpr std::uint32_t hash_combine(std::uint32_t seed, std::uint32_t v)
+{
+    return seed ^ (v + (seed << 6) + (seed >> 2));
+}
+
+// Burley 2020, "Practical Hash-based Owen Scrambling"
+constexpr std::uint32_t laine_karras_permutation(std::uint32_t x, std::uint32_t seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+constexpr std::uint32_t nested_uniform_scramble(std::uint32_t x, std::uint32_t seed)
+{
+    return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+}
+
+NAMESPACE_BEGIN(Sobol)
+
+// Joe and Kuo 2008, new-joe-kuo-6.21201的前20个维度(第一维是van der Corput)
+struct Direction
+{
+    std::uint32_t s, a;
+    std::uint32_t m[8];
+};
+
+inline constexpr Direction DIRECTIONS[]
+{
+    {1, 0,  {1}},
+    {2, 1,  {1, 3}},
+    {3, 1,  {1, 3, 1}},
+    {3, 2,  {1, 1, 1}},
+    {4, 1,  {1, 1, 3, 3}},
+    {4, 4,  {1, 3, 5, 13}},
+    {5, 2,  {1, 1, 5, 5, 17}},
+    {5, 4,  {1, 1, 5, 5, 5}},
+    {5, 7,  {1, 1, 7, 11, 19}},
+    {5, 11, {1, 1, 5, 1, 1}},
+    {5, 13, {1, 1, 1, 3, 11}},
+    {5, 14, {1, 3, 5, 5, 31}},
+    {6, 1,  {1, 3, 3, 9, 7, 49}},
+    {6, 13, {1, 1, 1, 15, 21, 21}},
+    {6, 16, {1, 3, 1, 13, 27, 49}},
+    {6, 19, {1, 1, 1, 15, 7, 5}},
+    {6, 22, {1, 3, 1, 15, 13, 25}},
+    {6, 25, {1, 1, 5, 5, 19, 61}},
+    {7, 1,  {1, 3, 7, 11, 23, 15, 103}},
+    {7, 4,  {1, 3, 7, 13, 13, 15, 69}}
+};
+
+inline constexpr usize DIMENSIONS = std::size(DIRECTIONS) + 1;
+
+using Matrix = std::array<std::uint32_t, 32>;
+
+constexpr std::array<Matrix, DIMENSIONS> make_matrices()
+{
+    std::array<Matrix, DIMENSIONS> ret{};
+    for(usize k = 0; k < 32; k++)
+        ret[0][k] = 1u << (31 - k);
+
+    for(usize d = 1; d < DIMENSIONS; d++)
+    {
+        const auto& [s, a, m] = DIRECTIONS[d - 1];
+        auto& v = ret[d];
+        for(usize k = 0; k < 32; k++)
+        {
+            if(k < s)
+            {
+                v[k] = m[k] << (31 - k);
+                continue;
+            }
+            std::uint32_t x = v[k - s] ^ (v[k - s] >> s);
+            for(usize j = 1; j < s; j++)
+            {
+                if((a >> (s - 1 - j)) & 1)
+                    x ^= v[k - j];
+            }
+            v[k] = x;
+        }
+    }
+    return ret;
+}
+
+inline constexpr std::array<Matrix, DIMENSIONS> MATRICES = make_matrices();
+
+NAMESPACE_END(Sobol)
+
+// 生成矩阵和样本序号的二进制位相乘，用掩码代替分支
+constexpr std::uint32_t sobol_bits(std::uint32_t index, usize dim)
+{
+    assert(dim < Sobol::DIMENSIONS);
+    const auto& v = Sobol::MATRICES[dim];
+    std::uint32_t x = 0;
+    for(usize k = 0; k < 32; k++)
+        x ^= v[k] & (0u - ((index >> k) & 1));
+    return x;
+}
+
+template <std::floating_point T>
+constexpr T to_unit(std::uint32_t x)
+{
+    if constexpr(std::is_same_v<T, f32>)
+        return bits_to_unit_f32(x);
+    else
+        return static_cast<T>(x) * static_cast<T>(0x1p-32);
+}
+
+// 先打乱样本顺序，再对每个维度做独立的Owen scrambling
+constexpr std::uint32_t owen_scrambled_sobol_bits(std::uint32_t index, usize dim, std::uint32_t seed)
+{
+    const std::uint32_t shuffled = nested_uniform_scramble(index, seed);
+    return nested_uniform_scramble(sobol_bits(shuffled, dim), hash_combine(seed, static_cast<std::uint32_t>(dim)));
+}
+
+struct SobolSampler
+{
+    // seed为0时不做scrambling，得到原始的Sobol序列
+    std::uint32_t seed = 0;
+
+    constexpr std::uint32_t bits(std::uint32_t index, usize dim) const
+    {
+        return seed == 0 ? sobol_bits(index, dim) : owen_scrambled_sobol_bits(index, dim, seed);
+    }
+
+    template <std::floating_point T>
+    constexpr T get(std::uint32_t index, usize dim) const { return to_unit<T>(bits(index, dim)); }
+
+    template <std::floating_point T>
+    constexpr Point2<T> get_2d(std::uint32_t index, usize dim) const
+    {
+        return {get<T>(index, dim), get<T>(index, dim + 1)};
+    }
+
+    template <std::floating_point T>
+    void fill(std::uint32_t first_index, usize dim, std::span<T> out) const
+    {
+        assert(dim < Sobol::DIMENSIONS);
+        const auto& v = Sobol::MATRICES[dim];
+        const std::uint32_t dim_seed = hash_combine(seed, static_cast<std::uint32_t>(dim));
+        for(usize i = 0; i < out.size(); i++)
+        {
+            std::uint32_t index = first_index + static_cast<std::uint32_t>(i);
+            if(seed != 0) index = nested_uniform_scramble(index, seed);
+            std::uint32_t x = 0;
+            for(usize k = 0; k < 32; k++)
+                x ^= v[k] & (0u - ((index >> k) & 1));
+            if(seed != 0) x = nested_uniform_scramble(x, dim_seed);
+            out[i] = to_unit<T>(x);
+        }
+    }
+
+    template <std::floating_point T>
+    void fill(std::uint32_t first_index, usize dim, Point2SoA<T> out) const
+    {
+        fill(first_index, dim, out.x);
+        fill(first_index, dim + 1, out.y);
+    }
+};
+
+NAMESPACE_BEGIN(Halton)
+
+inline constexpr usize DIMENSIONS = 64;
+
+constexpr std::array<std::uint32_t, DIMENSIONS> make_primes()
+{
+    std::array<std::uint32_t, DIMENSIONS> ret{};
+    usize n = 0;
+    for(std::uint32_t x = 2; n < DIMENSIONS; x++)
+    {
+        bool prime = true;
+        for(usize i = 0; i < n && ret[i] * ret[i] <= x; i++)
+        {
+            if(x % ret[i] == 0)
+            {
+                prime = false;
+                break;
+            }
+        }
+        if(prime) ret[n++] = x;
+    }
+    return ret;
+}
+
+inline constexpr std::array<std::uint32_t, DIMENSIONS> PRIMES = make_primes();
+
+NAMESPACE_END(Halton)
+
+// 每个维度一张数字置换表(Faure and Lemieux 2009的随机置换版本)，减轻高维的相关性
+struct HaltonSampler
+{
+private:
+    std::vector<std::uint16_t> permutations;
+    std::array<usize, Halton::DIMENSIONS> offsets;
+
+public:
+    // seed为0时使用恒等置换，得到原始的Halton序列
+    HaltonSampler(std::uint64_t seed = 0)
+    {
+        usize size = 0;
+        for(usize d = 0; d < Halton::DIMENSIONS; d++)
+        {
+            offsets[d] = size;
+            size += Halton::PRIMES[d];
+        }
+        permutations.resize(size);
+
+        PCG32 rng{seed, 0x68616c746f6e};
+        for(usize d = 0; d < Halton::DIMENSIONS; d++)
+        {
+            const std::uint32_t base = Halton::PRIMES[d];
+            std::uint16_t* perm = &permutations[offsets[d]];
+            for(std::uint32_t i = 0; i < base; i++)
+                perm[i] = static_cast<std::uint16_t>(i);
+            if(seed == 0) continue;
+            for(std::uint32_t i = base - 1; i > 0; i--)
+                std::swap(perm[i], perm[rng.bounded(i + 1)]);
+        }
+    }
+
+    std::span<const std::uint16_t> permutation(usize dim) const
+    {
+        assert(dim < Halton::DIMENSIONS);
+        return {&permutations[offsets[dim]], Halton::PRIMES[dim]};
+    }
+
+    // 末尾无限个0经过置换后不再是0，用等比数列求和补上
+    template <std::floating_point T>
+    T get(std::uint64_t index, usize dim) const
+    {
+        assert(dim < Halton::DIMENSIONS);
+        const std::uint32_t base = Halton::PRIMES[dim];
+        const std::uint16_t* perm = &permutations[offsets[dim]];
+        const f64 inv_base = 1.0 / base;
+        f64 inv_base_n = 1;
+        std::uint64_t reversed = 0;
+        while(index)
+        {
+            const std::uint64_t next = index / base;
+            const std::uint64_t digit = index - next * base;
+            reversed = reversed * base + perm[digit];
+            inv_base_n *= inv_base;
+            index = next;
+        }
+        const f64 value = inv_base_n * (static_cast<f64>(reversed) + inv_base * perm[0] / (1 - inv_base));
+        return min(static_cast<T>(value), ONE<T> - std::numeric_limits<T>::epsilon() / 2);
+    }
+
+    template <std::floating_point T>
+    Point2<T> get_2d(std::uint64_t index, usize dim) const
+    {
+        return {get<T>(index, dim), get<T>(index, dim + 1)};
+    }
+
+    template <std::floating_point T>
+    void fill(std::uint64_t first_index, usize dim, std::span<T> out) const
+    {
+        for(usize i = 0; i < out.size(); i++)
+            out[i] = get<T>(first_index + i, dim);
+    }
+
+    template <std::floating_point T>
+    void fill(std::uint64_t first_index, usize dim, Point2SoA<T> out) const
+    {
+        fill(first_index, dim, out.x);
+        fill(first_index, dim + 1, out.y);
+    }
+};
+
+NAMESPACE_END(Hinae)
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <span>
+#include <atomic>
+#include <string>
+#include <cstddef>
+#include <optional>
+#include <filesystem>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "basic_type.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+// 只读的内存映射文件，映射的生命周期跟随对象，只能移动不能拷贝
+struct MappedFile
+{
+private:
+    const std::byte* ptr = nullptr;
+    usize length = 0;
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+
+    void release()
+    {
+#ifdef _WIN32
+        if(ptr) UnmapViewOfFile(ptr);
+        if(mapping) CloseHandle(mapping);
+        if(file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+        mapping = nullptr;
+#else
+        if(ptr) munmap(const_cast<std::byte*>(ptr), length);
+#endif
+        ptr = nullptr;
+        length = 0;
+    }
+
+public:
+    MappedFile() = default;
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator = (const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept { *this = std::move(other); }
+
+    MappedFile& operator = (MappedFile&& other) noexcept
+    {
+        if(this != &other)
+        {
+            release();
+            std::swap(ptr, other.ptr);
+            std::swap(length, other.length);
+#ifdef _WIN32
+            std::swap(file, other.file);
+            std::swap(mapping, other.mapping);
+#endif
+        }
+        return *this;
+    }
+
+    ~MappedFile() { release(); }
+
+    // 文件不存在或者映射失败时返回空
+    static std::optional<MappedFile> open(const std::filesystem::path& path)
+    {
+        MappedFile ret;
+#ifdef _WIN32
+        ret.file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                               OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if(ret.file == INVALID_HANDLE_VALUE) return {};
+        LARGE_INTEGER size;
+        if(!GetFileSizeEx(ret.file, &size)) return {};
+        ret.length = static_cast<usize>(size.QuadPart);
+        if(ret.length == 0) return ret;
+        ret.mapping = CreateFileMappingW(ret.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if(!ret.mapping) return {};
+        ret.ptr = static_cast<const std::byte*>(MapViewOfFile(ret.mapping, FILE_MAP_READ, 0, 0, 0));
+        if(!ret.ptr) return {};
+#else
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if(fd < 0) return {};
+        struct stat st;
+        if(fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return {};
+        }
+        const usize size = static_cast<usize>(st.st_size);
+        if(size == 0)
+        {
+            ::close(fd);
+            return ret;
+        }
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if(p == MAP_FAILED) return {};
+        ret.ptr = static_cast<const std::byte*>(p);
+        ret.length = size;
+#endif
+        return ret;
+    }
+
+    const std::byte* data() const { return ptr; }
+    usize size() const { return length; }
+
+    std::span<const std::byte> bytes() const { return {ptr, length}; }
+};
+
+// 写缓存文件时先写到同目录下的临时文件再rename，名字带上进程号和进程内的序号，
+// 多个进程或线程同时写同一个文件时不会互相覆盖临时文件
+inline std::filesystem::path temporary_path(const std::filesystem::path& path)
+{
+    static std::atomic<u64> counter = 0;
+#ifdef _WIN32
+    const u64 pid = GetCurrentProcessId();
+#else
+    const u64 pid = static_cast<u64>(getpid());
+#endif
+    std::filesystem::path ret = path;
+    ret += ".tmp." + std::to_string(pid) + "." + std::to_string(counter.fetch_add(1, std::memory_order_relaxed));
+    return ret;
+}
+
+NAMESPACE_END(Hinae)
@@ -0,0 +1,278 @@
+#pragma once
+
+#include "Trigonometric.hpp"
+#include "sampling.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+// 所有方向都在局部坐标系下(z轴是宏观法线)
+// 各向异性的tan2_theta * (cos2_phi / ax^2 + sin2_phi / ay^2)展开成直角坐标，不需要三角函数和分支
+// 所以求值函数都可以直接用在SoA批量数据上
+
+NAMESPACE_BEGIN(Microfacet)
+
+// 斜率空间下的tan2_theta，分母取最小正数，掠射方向得到很大的值而不是NaN
+template <std::floating_point T>
+constexpr T stretched_tan2(const Vector3<T>& w, T alpha_x, T alpha_y)
+{
+    const T x = w.x * alpha_x, y = w.y * alpha_y;
+    return (x * x + y * y) / max(Local::cos2_theta(w), MIN_NUMBER<T>);
+}
+
+template <typename F, std::floating_point T>
+void batch(Vector3SoA<const T> w, std::span<T> out, F&& f)
+{
+    assert(out.size() == w.size());
+    const T* x = w.x.data();
+    const T* y = w.y.data();
+    const T* z = w.z.data();
+    for(usize i = 0; i < out.size(); i++)
+        out[i] = f(Vector3<T>{x[i], y[i], z[i]});
+}
+
+template <typename F, std::floating_point T>
+void batch(Vector3SoA<const T> w0, Vector3SoA<const T> w1, std::span<T> out, F&& f)
+{
+    assert(out.size() == w0.size() && out.size() == w1.size());
+    const T* x0 = w0.x.data();
+    const T* y0 = w0.y.data();
+    const T* z0 = w0.z.data();
+    const T* x1 = w1.x.data();
+    const T* y1 = w1.y.data();
+    const T* z1 = w1.z.data();
+    for(usize i = 0; i < out.size(); i++)
+        out[i] = f(Vector3<T>{x0[i], y0[i], z0[i]}, Vector3<T>{x1[i], y1[i], z1[i]});
+}
+
+// Giles 2010的近似，用于Beckmann的可见法线采样
+template <std::floating_point T>
+T erf_inv(T x)
+{
+    x = clamp(static_cast<T>(-0.99999), x, static_cast<T>(0.99999));
+    T w = -std::log((ONE<T> - x) * (ONE<T> + x));
+    T p;
+    if(w < 5)
+    {
+        w = w - static_cast<T>(2.5);
+        p = static_cast<T>(2.81022636e-08);
+        p = static_cast<T>(3.43273939e-07) + p * w;
+        p = static_cast<T>(-3.5233877e-06) + p * w;
+        p = static_cast<T>(-4.39150654e-06) + p * w;
+        p = static_cast<T>(0.00021858087) + p * w;
+        p = static_cast<T>(-0.00125372503) + p * w;
+        p = static_cast<T>(-0.00417768164) + p * w;
+        p = static_cast<T>(0.246640727) + p * w;
+        p = static_cast<T>(1.50140941) + p * w;
+    }
+    else
+    {
+        w = std::sqrt(w) - 3;
+        p = static_cast<T>(-0.000200214257);
+        p = static_cast<T>(0.000100950558) + p * w;
+        p = static_cast<T>(0.00134934322) + p * w;
+        p = static_cast<T>(-0.00367342844) + p * w;
+        p = static_cast<T>(0.00573950773) + p * w;
+        p = static_cast<T>(-0.0076224613) + p * w;
+        p = static_cast<T>(0.00943887047) + p * w;
+        p = static_cast<T>(1.00167406) + p * w;
+        p = static_cast<T>(2.83297682) + p * w;
+    }
+    return p * x;
+}
+
+NAMESPACE_END(Microfacet)
+
+// Trowbridge-Reitz(GGX)分布
+template <std::floating_point T>
+struct GGX
+{
+    T alpha_x, alpha_y;
+
+    constexpr GGX(T alpha) : alpha_x(alpha), alpha_y(alpha) {}
+    constexpr GGX(T alpha_x, T alpha_y) : alpha_x(alpha_x), alpha_y(alpha_y) {}
+
+    static constexpr T roughness_to_alpha(T roughness) { return sqrt(roughness); }
+
+    constexpr T D(const Vector3<T>& wm) const { return Sampling::ggx_d(wm, alpha_x, alpha_y); }
+
+    constexpr T lambda(const Vector3<T>& w) const
+    {
+        return (sqrt(ONE<T> + Microfacet::stretched_tan2(w, alpha_x, alpha_y)) - ONE<T>) / 2;
+    }
+
+    constexpr T G1(const Vector3<T>& w) const { return ONE<T> / (ONE<T> + lambda(w)); }
+
+    // height-correlated形式
+    constexpr T G(const Vector3<T>& wo, const Vector3<T>& wi) const
+    {
+        return ONE<T> / (ONE<T> + lambda(wo) + lambda(wi));
+    }
+
+    // 从wo看到的法线分布，同时也是sample_wm的pdf
+    constexpr T D(const Vector3<T>& wo, const Vector3<T>& wm) const
+    {
+        return ggx_vndf_pdf(wo, wm, alpha_x, alpha_y);
+    }
+
+    constexpr T pdf(const Vector3<T>& wo, const Vector3<T>& wm) const { return D(wo, wm); }
+
+    constexpr std::tuple<Vector3<T>, T> sample_wm(const Vector3<T>& wo, const Point2<T>& u) const
+    {
+        return sample_ggx_vndf(wo, alpha_x, alpha_y, u);
+    }
+
+    void D(Vector3SoA<const T> wm, std::span<T> out) const
+    {
+        Microfacet::batch(wm, out, [this](const Vector3<T>& m) { return D(m); });
+    }
+
+    void G1(Vector3SoA<const T> w, std::span<T> out) const
+    {
+        Microfacet::batch(w, out, [this](const Vector3<T>& v) { return G1(v); });
+    }
+
+    void G(Vector3SoA<const T> wo, Vector3SoA<const T> wi, std::span<T> out) const
+    {
+        Microfacet::batch(wo, wi, out, [this](const Vector3<T>& o, const Vector3<T>& i) { return G(o, i); });
+    }
+
+    void pdf(Vector3SoA<const T> wo, Vector3SoA<const T> wm, std::span<T> out) const
+    {
+        Microfacet::batch(wo, wm, out, [this](const Vector3<T>& o, const Vector3<T>& m) { return pdf(o, m); });
+    }
+
+    void sample_wm(Vector3SoA<const T> wo, std::span<const Point2<T>> u, Vector3SoA<T> wm, std::span<T> pdf) const
+    {
+        sample_ggx_vndf(wo, alpha_x, alpha_y, u, wm, pdf);
+    }
+};
+
+// Beckmann分布，Lambda使用Walter et al. 2007的有理近似
+template <std::floating_point T>
+struct Beckmann
+{
+    T alpha_x, alpha_y;
+
+    constexpr Beckmann(T alpha) : alpha_x(alpha), alpha_y(alpha) {}
+    constexpr Beckmann(T alpha_x, T alpha_y) : alpha_x(alpha_x), alpha_y(alpha_y) {}
+
+    static constexpr T roughness_to_alpha(T roughness) { return sqrt(roughness); }
+
+    T D(const Vector3<T>& wm) const
+    {
+        const T x = wm.x / alpha_x, y = wm.y / alpha_y;
+        const T cos2 = Local::cos2_theta(wm);
+        const T cos4 = max(cos2 * cos2, MIN_NUMBER<T>);
+        return std::exp(-(x * x + y * y) / max(cos2, MIN_NUMBER<T>)) / (PI<T> * alpha_x * alpha_y * cos4);
+    }
+
+    constexpr T lambda(const Vector3<T>& w) const
+    {
+        const T a = min(ONE<T> / sqrt(Microfacet::stretched_tan2(w, alpha_x, alpha_y)), static_cast<T>(1.6));
+        const T value = (ONE<T> - static_cast<T>(1.259) * a + static_cast<T>(0.396) * a * a)
+                      / (static_cast<T>(3.535) * a + static_cast<T>(2.181) * a * a);
+        return a >= static_cast<T>(1.6) ? ZERO<T> : value;
+    }
+
+    constexpr T G1(const Vector3<T>& w) const { return ONE<T> / (ONE<T> + lambda(w)); }
+
+    constexpr T G(const Vector3<T>& wo, const Vector3<T>& wi) const
+    {
+        return ONE<T> / (ONE<T> + lambda(wo) + lambda(wi));
+    }
+
+    T D(const Vector3<T>& wo, const Vector3<T>& wm) const
+    {
+        const T cos_om = wo.z < ZERO<T> ? -dot(wo, wm) : dot(wo, wm);
+        return G1(wo) / Local::abs_cos_theta(wo) * D(wm) * max(ZERO<T>, cos_om);
+    }
+
+    T pdf(const Vector3<T>& wo, const Vector3<T>& wm) const { return D(wo, wm); }
+
+    // Heitz and d'Eon 2014，拉伸到alpha = 1后在斜率空间里采样，再变换回来
+    // 斜率的反演需要迭代，所以这里有分支，求值函数依然是无分支的
+    std::tuple<Vector3<T>, T> sample_wm(const Vector3<T>& wo, const Point2<T>& u) const
+    {
+        const Vector3<T> w = (wo.z < ZERO<T> ? -wo : wo);
+        const Vector3<T> ws = Vector3<T>{alpha_x * w.x, alpha_y * w.y, w.z}.normalized();
+
+        const auto [slope_x, slope_y] = sample11(Local::cos_theta(ws), u);
+        const T sin_theta = Local::sin_theta(ws);
+        const T cos_phi = sin_theta > ZERO<T> ? clamp(-ONE<T>, ws.x / sin_theta, ONE<T>) : ONE<T>;
+        const T sin_phi = sin_theta > ZERO<T> ? clamp(-ONE<T>, ws.y / sin_theta, ONE<T>) : ZERO<T>;
+        const T sx = alpha_x * (cos_phi * slope_x - sin_phi * slope_y);
+        const T sy = alpha_y * (sin_phi * slope_x + cos_phi * slope_y);
+        const Vector3<T> wm = Vector3<T>{-sx, -sy, ONE<T>}.normalized();
+        return {wm, pdf(wo, wm)};
+    }
+
+    void D(Vector3SoA<const T> wm, std::span<T> out) const
+    {
+        Microfacet::batch(wm, out, [this](const Vector3<T>& m) { return D(m); });
+    }
+
+    void G1(Vector3SoA<const T> w, std::span<T> out) const
+    {
+        Microfacet::batch(w, out, [this](const Vector3<T>& v) { return G1(v); });
+    }
+
+    void G(Vector3SoA<const T> wo, Vector3SoA<const T> wi, std::span<T> out) const
+    {
+        Microfacet::batch(wo, wi, out, [this](const Vector3<T>& o, const Vector3<T>& i) { return G(o, i); });
+    }
+
+    void pdf(Vector3SoA<const T> wo, Vector3SoA<const T> wm, std::span<T> out) const
+    {
+        Microfacet::batch(wo, wm, out, [this](const Vector3<T>& o, const Vector3<T>& m) { return pdf(o, m); });
+    }
+
+    void sample_wm(Vector3SoA<const T> wo, std::span<const Point2<T>> u, Vector3SoA<T> wm, std::span<T> pdf) const
+    {
+        assert(wo.size() == u.size() && wm.size() == u.size() && pdf.size() == u.size());
+        for(usize i = 0; i < u.size(); i++)
+        {
+            const auto [m, p] = sample_wm(wo[i], u[i]);
+            wm.set(i, m);
+            pdf[i] = p;
+        }
+    }
+
+private:
+    // alpha = 1时可见斜率的采样，pbrt-v3 BeckmannSample11
+    static std::tuple<T, T> sample11(T cos_theta_i, const Point2<T>& u)
+    {
+        if(cos_theta_i > static_cast<T>(0.9999))
+        {
+            const T r = std::sqrt(-std::log(ONE<T> - u.x));
+            const T phi = 2 * PI<T> * u.y;
+            return {r * std::cos(phi), r * std::sin(phi)};
+        }
+
+        const T sin_theta_i = cos_to_sin(cos_theta_i);
+        const T tan_theta_i = sin_theta_i / cos_theta_i;
+        const T cot_theta_i = ONE<T> / tan_theta_i;
+
+        T a = -ONE<T>, c = std::erf(cot_theta_i);
+        const T sample_x = max(u.x, static_cast<T>(1e-6));
+        const T theta_i = std::acos(cos_theta_i);
+        const T fit = 1 + theta_i * (static_cast<T>(-0.876) + theta_i * (static_cast<T>(0.4265) - static_cast<T>(0.0594) * theta_i));
+        T b = c - (1 + c) * std::pow(1 - sample_x, fit);
+
+        const T inv_sqrt_pi = ONE<T> / std::sqrt(PI<T>);
+        const T normalization = 1 / (1 + c + inv_sqrt_pi * tan_theta_i * std::exp(-cot_theta_i * cot_theta_i));
+        for(usize it = 0; it < 10; it++)
+        {
+            if(!(b >= a && b <= c)) b = (a + c) / 2;
+            const T inv_erf = Microfacet::erf_inv(b);
+            const T value = normalization * (1 + b + inv_sqrt_pi * tan_theta_i * std::exp(-inv_erf * inv_erf)) - sample_x;
+            const T derivative = normalization * (1 - inv_erf * tan_theta_i);
+            if(std::abs(value) < static_cast<T>(1e-5)) break;
+            if(value > 0) c = b;
+            else          a = b;
+            b -= value / derivative;
+        }
+        return {Microfacet::erf_inv(b), Microfacet::erf_inv(2 * max(u.y, static_cast<T>(1e-6)) - 1)};
+    }
+};
+
+NAMESPACE_END(Hinae)
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Vector3.hpp"
+#include "SoA.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+// 单位向量的八面体映射编码
+// Cigolle et al. 2014, "A Survey of Efficient Representations for Independent Unit Vectors"
+// std::uint32_t每个分量16位，std::uint16_t每个分量8位
+template <typename U>
+concept octahedral_code = std::same_as<U, std::uint32_t> || std::same_as<U, std::uint16_t>;
+
+NAMESPACE_BEGIN(Octahedral)
+
+template <std::floating_point T>
+constexpr T sign_not_zero(T x) { return x >= ZERO<T> ? ONE<T> : -ONE<T>; }
+
+template <octahedral_code U>
+inline constexpr std::uint32_t BITS = sizeof(U) * 4;
+
+template <octahedral_code U>
+inline constexpr std::uint32_t MAX_CODE = (1u << BITS<U>) - 1;
+
+// 投影到八面体后展开到[-1, 1]^2
+template <std::floating_point T>
+constexpr std::tuple<T, T> project(T x, T y, T z)
+{
+    const T inv = ONE<T> / (fabs(x) + fabs(y) + fabs(z));
+    const T u = x * inv, v = y * inv;
+    const T fold_u = (ONE<T> - fabs(v)) * sign_not_zero(u);
+    const T fold_v = (ONE<T> - fabs(u)) * sign_not_zero(v);
+    return {z < ZERO<T> ? fold_u : u, z < ZERO<T> ? fold_v : v};
+}
+
+template <std::floating_point T>
+constexpr Vector3<T> unproject(T u, T v)
+{
+    const T z = ONE<T> - fabs(u) - fabs(v);
+    const T t = max(-z, ZERO<T>);
+    return Vector3<T>{u + (u >= ZERO<T> ? -t : t), v + (v >= ZERO<T> ? -t : t), z}.normalized();
+}
+
+template <octahedral_code U, std::floating_point T>
+constexpr std::uint32_t quantize(T x)
+{
+    const T unorm = clamp(ZERO<T>, x * static_cast<T>(0.5) + static_cast<T>(0.5), ONE<T>);
+    return static_cast<std::uint32_t>(unorm * MAX_CODE<U> + static_cast<T>(0.5));
+}
+
+template <octahedral_code U, std::floating_point T>
+constexpr T dequantize(std::uint32_t q)
+{
+    return static_cast<T>(q) * (static_cast<T>(2) / MAX_CODE<U>) - ONE<T>;
+}
+
+template <octahedral_code U>
+constexpr U pack(std::uint32_t u, std::uint32_t v)
+{
+    return static_cast<U>(u | (v << BITS<U>));
+}
+
+NAMESPACE_END(Octahedral)
+
+// precise为true时在四个相邻的量化点中选择解码误差最小的一个，编码更慢但误差约减半
+template <octahedral_code U, bool precise = false, std::floating_point T>
+constexpr U octahedral_encode(const Vector3<T>& n)
+{
+    using namespace Octahedral;
+    const auto [u, v] = project(n.x, n.y, n.z);
+    if constexpr(!precise)
+    {
+        return pack<U>(quantize<U>(u), quantize<U>(v));
+    }
+    else
+    {
+        const T scale = static_cast<T>(MAX_CODE<U>) / 2;
+        const auto base_u = static_cast<std::uint32_t>(clamp(ZERO<T>, (u + ONE<T>) * scale, static_cast<T>(MAX_CODE<U>)));
+        const auto base_v = static_cast<std::uint32_t>(clamp(ZERO<T>, (v + ONE<T>) * scale, static_cast<T>(MAX_CODE<U>)));
+        U best = pack<U>(base_u, base_v);
+        T best_cos = -INFINITY_<T>;
+        for(std::uint32_t i = 0; i < 4; i++)
+        {
+            const std::uint32_t qu = min(base_u + (i & 1), MAX_CODE<U>);
+            const std::uint32_t qv = min(base_v + (i >> 1), MAX_CODE<U>);
+            const T cos = dot(n, unproject(dequantize<U, T>(qu), dequantize<U, T>(qv)));
+            if(cos > best_cos)
+            {
+                best_cos = cos;
+                best = pack<U>(qu, qv);
+            }
+        }
+        return best;
+    }
+}
+
+template <std::floating_point T, octahedral_code U>
+constexpr Vector3<T> octahedral_decode(U code)
+{
+    using namespace Octahedral;
+    const std::uint32_t u = code & MAX_CODE<U>;
+    const std::uint32_t v = (code >> BITS<U>) & MAX_CODE<U>;
+    return unproject(dequantize<U, T>(u), dequantize<U, T>(v));
+}
+
+template <octahedral_code U, std::floating_point T>
+void octahedral_encode(Vector3SoA<const T> n, std::span<U> codes)
+{
+    assert(codes.size() == n.size());
+    using namespace Octahedral;
+    const T* nx = n.x.data();
+    const T* ny = n.y.data();
+    const T* nz = n.z.data();
+    for(usize i = 0; i < n.size(); i++)
+    {
+        const auto [u, v] = project(nx[i], ny[i], nz[i]);
+        codes[i] = pack<U>(quantize<U>(u), quantize<U>(v));
+    }
+}
+
+template <std::floating_point T, octahedral_code U>
+void octahedral_decode(std::span<const U> codes, Vector3SoA<T> n)
+{
+    assert(codes.size() == n.size());
+    using namespace Octahedral;
+    T* nx = n.x.data();
+    T* ny = n.y.data();
+    T* nz = n.z.data();
+    for(usize i = 0; i < n.size(); i++)
+    {
+        const T u = dequantize<U, T>(codes[i] & MAX_CODE<U>);
+        const T v = dequantize<U, T>((codes[i] >> BITS<U>) & MAX_CODE<U>);
+        const T z = ONE<T> - fabs(u) - fabs(v);
+        const T t = max(-z, ZERO<T>);
+        const T x = u + (u >= ZERO<T> ? -t : t);
+        const T y = v + (v >= ZERO<T> ? -t : t);
+        const T inv_norm = ONE<T> / sqrt(x * x + y * y + z * z);
+        nx[i] = x * inv_norm;
+        ny[i] = y * inv_norm;
+        nz[i] = z * inv_norm;
+    }
+}
+
+NAMESPACE_END(Hinae)
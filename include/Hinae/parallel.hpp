@@ -0,0 +1,369 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "basic_type.hpp"
+
+// 工作窃取的fork-join线程池，只依赖标准库
+// 每个工作线程有自己的双端队列，自己从尾部取(最近拆出来的、缓存还热的任务)，其他线程从头部偷(最早拆出来的、最大的任务)
+// 等待子任务的线程不会阻塞，而是继续执行队列里的任务，所以任务里可以再嵌套并行
+
+NAMESPACE_BEGIN(Hinae)
+
+class ThreadPool
+{
+private:
+    // 任务对象放在发起者的栈上，发起者一定会等它完成后才返回
+    struct Job
+    {
+        void (*invoke)(Job*);
+        std::exception_ptr error;
+        std::atomic<bool> done = false;
+
+        void run()
+        {
+            try
+            {
+                invoke(this);
+            }
+            catch(...)
+            {
+                error = std::current_exception();
+            }
+            // 这是执行者最后一次访问任务对象，之后发起者随时可能销毁它
+            done.store(true, std::memory_order_release);
+        }
+    };
+
+    template <typename F>
+    struct JobOf : Job
+    {
+        F& f;
+
+        explicit JobOf(F& f) : Job{[](Job* self) { static_cast<JobOf*>(self)->f(); }, {}}, f(f) {}
+    };
+
+    struct alignas(CACHE_LINE) Queue
+    {
+        std::mutex mutex;
+        std::deque<Job*> jobs;
+
+        void push(Job* job)
+        {
+            std::lock_guard lock(mutex);
+            jobs.push_back(job);
+        }
+
+        Job* pop()
+        {
+            std::lock_guard lock(mutex);
+            if(jobs.empty()) return nullptr;
+            Job* ret = jobs.back();
+            jobs.pop_back();
+            return ret;
+        }
+
+        Job* steal()
+        {
+            std::lock_guard lock(mutex);
+            if(jobs.empty()) return nullptr;
+            Job* ret = jobs.front();
+            jobs.pop_front();
+            return ret;
+        }
+
+        // 任务还没被偷走时从队列中取回，由发起者自己执行
+        bool retract(Job* job)
+        {
+            std::lock_guard lock(mutex);
+            const auto it = std::find(jobs.rbegin(), jobs.rend(), job);
+            if(it == jobs.rend()) return false;
+            jobs.erase(std::next(it).base());
+            return true;
+        }
+
+        bool empty()
+        {
+            std::lock_guard lock(mutex);
+            return jobs.empty();
+        }
+    };
+
+    // 最后一个队列给不属于这个线程池的线程使用
+    // 工作线程启动时workers还在构造，线程数单独保存
+    const usize threads;
+    std::unique_ptr<Queue[]> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleep_mutex;
+    std::condition_variable wake;
+    std::atomic<usize> sleeping = 0;
+    u64 epoch = 0;
+    bool stop = false;
+
+    struct Current
+    {
+        const ThreadPool* pool = nullptr;
+        usize index = 0;
+    };
+
+    static Current& current()
+    {
+        thread_local Current current;
+        return current;
+    }
+
+    // 当前线程在这个线程池中的队列
+    usize queue_index() const
+    {
+        const Current& c = current();
+        return c.pool == this ? c.index : threads;
+    }
+
+    bool has_work()
+    {
+        for(usize i = 0; i <= threads; i++)
+            if(!queues[i].empty()) return true;
+        return false;
+    }
+
+    void push(Job* job)
+    {
+        queues[queue_index()].push(job);
+        if(sleeping.load() > 0)
+        {
+            {
+                std::lock_guard lock(sleep_mutex);
+                epoch++;
+            }
+            wake.notify_one();
+        }
+    }
+
+    // 先取自己队列尾部的任务，没有再依次从其他队列头部偷
+    bool run_one()
+    {
+        const usize self = queue_index();
+        const usize n = threads + 1;
+        Job* job = queues[self].pop();
+        for(usize i = 1; job == nullptr && i < n; i++)
+            job = queues[(self + i) % n].steal();
+        if(job == nullptr) return false;
+        job->run();
+        return true;
+    }
+
+    void wait(Job& job)
+    {
+        for(usize idle = 0; !job.done.load(std::memory_order_acquire);)
+        {
+            if(run_one()) idle = 0;
+            else if(++idle > 64) std::this_thread::yield();
+        }
+    }
+
+    void worker_loop(usize index)
+    {
+        current() = {this, index};
+        for(usize idle = 0;;)
+        {
+            if(run_one())
+            {
+                idle = 0;
+                continue;
+            }
+            if(++idle < 256)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // 先登记为休眠再检查队列，push在入队之后读取sleeping，两边至少有一方能看到对方
+            std::unique_lock lock(sleep_mutex);
+            if(stop) return;
+            sleeping.fetch_add(1);
+            const u64 seen = epoch;
+            if(!has_work())
+                wake.wait(lock, [&] { return stop || epoch != seen; });
+            sleeping.fetch_sub(1);
+            idle = 0;
+        }
+    }
+
+    template <typename F>
+    void for_range(usize begin, usize end, usize grain, F& f)
+    {
+        if(end - begin <= grain)
+        {
+            if constexpr(std::invocable<F&, usize, usize>)
+                f(begin, end);
+            else
+                for(usize i = begin; i < end; i++) f(i);
+            return;
+        }
+        const usize mid = begin + (end - begin) / 2;
+        join([&] { for_range(begin, mid, grain, f); }, [&] { for_range(mid, end, grain, f); });
+    }
+
+    // 拆分方式只取决于区间和粒度，合并顺序固定，浮点归约的结果与调度无关
+    template <typename T, typename Map, typename Reduce>
+    T reduce_range(usize begin, usize end, usize grain, const T& identity, Map& map, Reduce& reduce)
+    {
+        if(end - begin <= grain)
+        {
+            if constexpr(std::invocable<Map&, usize, usize>)
+                return map(begin, end);
+            else
+            {
+                T ret = identity;
+                for(usize i = begin; i < end; i++) ret = reduce(ret, map(i));
+                return ret;
+            }
+        }
+        const usize mid = begin + (end - begin) / 2;
+        T left = identity, right = identity;
+        join([&] { left = reduce_range(begin, mid, grain, identity, map, reduce); },
+             [&] { right = reduce_range(mid, end, grain, identity, map, reduce); });
+        return reduce(left, right);
+    }
+
+public:
+    // threads是工作线程数，调用parallel_for的线程也会参与计算；为0时全部在调用线程上串行执行
+    explicit ThreadPool(usize threads) : threads(threads), queues(std::make_unique<Queue[]>(threads + 1))
+    {
+        workers.reserve(threads);
+        for(usize i = 0; i < threads; i++)
+            workers.emplace_back([this, i] { worker_loop(i); });
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard lock(sleep_mutex);
+            stop = true;
+        }
+        wake.notify_all();
+        for(auto& t : workers) t.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator = (const ThreadPool&) = delete;
+
+    // 全局线程池，工作线程数为硬件线程数减一
+    static ThreadPool& global()
+    {
+        static ThreadPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+    usize size() const { return threads; }
+
+    // 并行执行a和b，都完成后返回；a或b抛出的异常在这里重新抛出
+    template <typename A, typename B>
+    void join(A&& a, B&& b)
+    {
+        if(threads == 0)
+        {
+            a();
+            b();
+            return;
+        }
+
+        JobOf<B> job(b);
+        push(&job);
+        std::exception_ptr error;
+        try
+        {
+            a();
+        }
+        catch(...)
+        {
+            error = std::current_exception();
+        }
+
+        if(queues[queue_index()].retract(&job))
+            job.run();
+        else
+            wait(job);
+
+        if(error) std::rethrow_exception(error);
+        if(job.error) std::rethrow_exception(job.error);
+    }
+
+    // f(i)或者f(begin, end)，每段至多grain个元素
+    template <typename F>
+    void parallel_for(usize begin, usize end, usize grain, F&& f)
+    {
+        if(begin >= end) return;
+        for_range(begin, end, std::max<usize>(1, grain), f);
+    }
+
+    // 默认每个线程大约分到8段，给窃取留出平衡负载的余地
+    template <typename F>
+    void parallel_for(usize begin, usize end, F&& f)
+    {
+        parallel_for(begin, end, default_grain(end - begin), std::forward<F>(f));
+    }
+
+    // map(i)或者map(begin, end)给出一段的结果，reduce需要满足结合律，identity是它的单位元
+    template <typename T, typename Map, typename Reduce>
+    T parallel_reduce(usize begin, usize end, usize grain, T identity, Map&& map, Reduce&& reduce)
+    {
+        if(begin >= end) return identity;
+        return reduce_range(begin, end, std::max<usize>(1, grain), identity, map, reduce);
+    }
+
+    template <typename T, typename Map, typename Reduce>
+    T parallel_reduce(usize begin, usize end, T identity, Map&& map, Reduce&& reduce)
+    {
+        return parallel_reduce(begin, end, default_grain(end - begin), std::move(identity), std::forward<Map>(map), std::forward<Reduce>(reduce));
+    }
+
+    usize default_grain(usize n) const
+    {
+        return std::max<usize>(1, n / (8 * (threads + 1)));
+    }
+};
+
+// 使用全局线程池
+
+template <typename A, typename B>
+void parallel_invoke(A&& a, B&& b)
+{
+    ThreadPool::global().join(std::forward<A>(a), std::forward<B>(b));
+}
+
+template <typename F>
+void parallel_for(usize begin, usize end, usize grain, F&& f)
+{
+    ThreadPool::global().parallel_for(begin, end, grain, std::forward<F>(f));
+}
+
+template <typename F>
+void parallel_for(usize begin, usize end, F&& f)
+{
+    ThreadPool::global().parallel_for(begin, end, std::forward<F>(f));
+}
+
+template <typename T, typename Map, typename Reduce>
+T parallel_reduce(usize begin, usize end, usize grain, T identity, Map&& map, Reduce&& reduce)
+{
+    return ThreadPool::global().parallel_reduce(begin, end, grain, std::move(identity), std::forward<Map>(map), std::forward<Reduce>(reduce));
+}
+
+template <typename T, typename Map, typename Reduce>
+T parallel_reduce(usize begin, usize end, T identity, Map&& map, Reduce&& reduce)
+{
+    return ThreadPool::global().parallel_reduce(begin, end, std::move(identity), std::forward<Map>(map), std::forward<Reduce>(reduce));
+}
+
+NAMESPACE_END(Hinae)
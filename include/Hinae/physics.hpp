@@ -1,7 +1,13 @@
 #pragma once
 
+#ifdef USE_SIMD
+#include <immintrin.h>
+#endif
+
 #include <optional>
 #include <complex>
+#include <array>
+#include <span>
 
 #include "Trigonometric.hpp"
 
@@ -82,6 +88,135 @@ constexpr T conductor(T cos_theta_i, std::complex<T> eta_i, std::complex<T> eta_
     return (std::norm(r_parl) + std::norm(r_perp)) / 2;
 }
 
+// 以下是没有分支和复数运算的版本，可以一次计算多个波长或多个着色点
+// eta是透射侧与入射侧折射率之比，k是透射侧消光系数除以入射侧折射率(入射侧是电介质)
+
+// cos_theta_i < 0时视为从内部射出，全反射返回1
+template <std::floating_point T>
+constexpr T dielectric(T cos_theta_i, T eta)
+{
+    cos_theta_i = clamp(-ONE<T>, cos_theta_i, ONE<T>);
+    const bool entering = cos_theta_i > ZERO<T>;
+    const T e = entering ? eta : ONE<T> / eta;
+    const T cos_i = fabs(cos_theta_i);
+
+    const T sin2_t = (ONE<T> - cos_i * cos_i) / (e * e);
+    const T cos_t = sqrt(max(ZERO<T>, ONE<T> - sin2_t));
+
+    // 掠射且全反射时分子分母同时为0，分母取最小正数避免产生NaN
+    const T r_parl = (e * cos_i - cos_t) / max(e * cos_i + cos_t, MIN_NUMBER<T>);
+    const T r_perp = (cos_i - e * cos_t) / max(cos_i + e * cos_t, MIN_NUMBER<T>);
+    return sin2_t >= ONE<T> ? ONE<T> : (r_parl * r_parl + r_perp * r_perp) / 2;
+}
+
+// pbrt-v3 FrConductor，把复数除法和开方展开成实数运算
+template <std::floating_point T>
+constexpr T conductor(T cos_theta_i, T eta, T k)
+{
+    const T cos_i = clamp(ZERO<T>, cos_theta_i, ONE<T>);
+    const T cos2 = cos_i * cos_i;
+    const T sin2 = ONE<T> - cos2;
+    const T eta2 = eta * eta;
+    const T k2 = k * k;
+
+    const T t0 = eta2 - k2 - sin2;
+    const T a2_plus_b2 = sqrt(t0 * t0 + 4 * eta2 * k2);
+    const T t1 = a2_plus_b2 + cos2;
+    const T a = sqrt(max(ZERO<T>, (a2_plus_b2 + t0) / 2));
+    const T t2 = 2 * cos_i * a;
+    const T rs = (t1 - t2) / (t1 + t2);
+
+    const T t3 = cos2 * a2_plus_b2 + sin2 * sin2;
+    const T t4 = t2 * sin2;
+    const T rp = rs * (t3 - t4) / (t3 + t4);
+    return (rp + rs) / 2;
+}
+
+#ifdef USE_SIMD
+// 4个f32同时计算，公式与标量版本相同
+inline __m128 sse_conductor(__m128 cos_i, __m128 eta, __m128 k)
+{
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    cos_i = _mm_min_ps(_mm_max_ps(cos_i, zero), one);
+
+    const __m128 cos2 = _mm_mul_ps(cos_i, cos_i);
+    const __m128 sin2 = _mm_sub_ps(one, cos2);
+    const __m128 eta2 = _mm_mul_ps(eta, eta);
+    const __m128 k2 = _mm_mul_ps(k, k);
+
+    const __m128 t0 = _mm_sub_ps(_mm_sub_ps(eta2, k2), sin2);
+    const __m128 a2_plus_b2 = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(t0, t0), _mm_mul_ps(_mm_set1_ps(4.0f), _mm_mul_ps(eta2, k2))));
+    const __m128 t1 = _mm_add_ps(a2_plus_b2, cos2);
+    const __m128 a = _mm_sqrt_ps(_mm_max_ps(zero, _mm_mul_ps(_mm_add_ps(a2_plus_b2, t0), half)));
+    const __m128 t2 = _mm_mul_ps(_mm_add_ps(cos_i, cos_i), a);
+    const __m128 rs = _mm_div_ps(_mm_sub_ps(t1, t2), _mm_add_ps(t1, t2));
+
+    const __m128 t3 = _mm_add_ps(_mm_mul_ps(cos2, a2_plus_b2), _mm_mul_ps(sin2, sin2));
+    const __m128 t4 = _mm_mul_ps(t2, sin2);
+    const __m128 rp = _mm_div_ps(_mm_mul_ps(rs, _mm_sub_ps(t3, t4)), _mm_add_ps(t3, t4));
+    return _mm_mul_ps(_mm_add_ps(rp, rs), half);
+}
+#endif
+
+// 同一个角度下的N个波长
+template <std::floating_point T, usize N>
+constexpr std::array<T, N> dielectric(T cos_theta_i, const std::array<T, N>& eta)
+{
+    std::array<T, N> ret;
+    for(usize i = 0; i < N; i++)
+        ret[i] = dielectric(cos_theta_i, eta[i]);
+    return ret;
+}
+
+template <std::floating_point T, usize N>
+constexpr std::array<T, N> conductor(T cos_theta_i, const std::array<T, N>& eta, const std::array<T, N>& k)
+{
+    std::array<T, N> ret;
+#ifdef USE_SIMD
+    if constexpr(std::is_same_v<T, f32> && N % 4 == 0)
+    {
+        if(!std::is_constant_evaluated())
+        {
+            const __m128 c = _mm_set1_ps(cos_theta_i);
+            for(usize i = 0; i < N; i += 4)
+                _mm_storeu_ps(&ret[i], sse_conductor(c, _mm_loadu_ps(&eta[i]), _mm_loadu_ps(&k[i])));
+            return ret;
+        }
+    }
+#endif
+    for(usize i = 0; i < N; i++)
+        ret[i] = conductor(cos_theta_i, eta[i], k[i]);
+    return ret;
+}
+
+// 同一种材质下的N个着色点
+template <std::floating_point T>
+void dielectric(std::span<const T> cos_theta_i, T eta, std::span<T> out)
+{
+    assert(out.size() == cos_theta_i.size());
+    for(usize i = 0; i < out.size(); i++)
+        out[i] = dielectric(cos_theta_i[i], eta);
+}
+
+template <std::floating_point T>
+void conductor(std::span<const T> cos_theta_i, T eta, T k, std::span<T> out)
+{
+    assert(out.size() == cos_theta_i.size());
+    usize i = 0;
+#ifdef USE_SIMD
+    if constexpr(std::is_same_v<T, f32>)
+    {
+        const __m128 e = _mm_set1_ps(eta), kk = _mm_set1_ps(k);
+        for(; i + 4 <= out.size(); i += 4)
+            _mm_storeu_ps(&out[i], sse_conductor(_mm_loadu_ps(&cos_theta_i[i]), e, kk));
+    }
+#endif
+    for(; i < out.size(); i++)
+        out[i] = conductor(cos_theta_i[i], eta, k);
+}
+
 NAMESPACE_END(Fresnel)
 
 NAMESPACE_END(Hinae)
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <span>
+
+#include "Bounds3.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+template <typename I>
+concept quantized_integer = std::same_as<I, std::uint16_t> || std::same_as<I, std::uint32_t>;
+
+// 把场景包围盒划分成 MAX_Q^3 的整数网格
+// 点取最近的格点，包围盒向外取整，保证反量化后的包围盒一定包含原包围盒
+template <std::floating_point T, quantized_integer I>
+struct Quantizer3
+{
+    // f32的尾数只有24位，量化到32位整数时格点数受浮点精度限制
+    static constexpr I MAX_Q = std::numeric_limits<T>::digits >= std::numeric_limits<I>::digits
+                             ? MAX_NUMBER<I>
+                             : static_cast<I>((std::uint64_t{1} << std::numeric_limits<T>::digits) - 1);
+    static constexpr T MAX_CODE = static_cast<T>(MAX_Q);
+
+    Point3<T> origin;
+    Vector3<T> scale;
+    Vector3<T> inv_scale;
+
+    constexpr Quantizer3() = default;
+
+    constexpr Quantizer3(const Bounds3<T>& scene)
+        : origin(scene.p_min), scale(ZERO<T>), inv_scale(ZERO<T>)
+    {
+        const Vector3<T> extent = scene.diagonal();
+        for(usize i = 0; i < 3; i++)
+        {
+            if(extent[i] > ZERO<T>)
+            {
+                scale[i] = extent[i] / MAX_CODE;
+                inv_scale[i] = MAX_CODE / extent[i];
+            }
+        }
+    }
+
+    constexpr T dequantize(I q, usize axis) const
+    {
+        return origin[axis] + static_cast<T>(q) * scale[axis];
+    }
+
+    constexpr Point3<T> dequantize(const Point3<I>& q) const
+    {
+        return {dequantize(q.x, 0), dequantize(q.y, 1), dequantize(q.z, 2)};
+    }
+
+    constexpr Bounds3<T> dequantize(const Bounds3<I>& b) const
+    {
+        return {dequantize(b.p_min), dequantize(b.p_max)};
+    }
+
+    // 不能直接加0.5再截断：f32的24位格点在MAX_CODE + 0.5处会舍入到MAX_CODE + 1
+    // t和截断的结果相差不到1，相减是精确的
+    constexpr I quantize_nearest(T v, usize axis) const
+    {
+        const T t = clamp(ZERO<T>, (v - origin[axis]) * inv_scale[axis], MAX_CODE);
+        const I q = static_cast<I>(t);
+        return t - static_cast<T>(q) >= static_cast<T>(0.5) && q < MAX_Q ? q + 1 : q;
+    }
+
+    // 反量化在不同调用处可能被编译成FMA，结果相差1ulp，校正时留出这部分余量
+    constexpr T slack(T v, usize axis) const
+    {
+        return (fabs(origin[axis]) + fabs(v)) * std::numeric_limits<T>::epsilon();
+    }
+
+    // 余量对应的格数，至少一格
+    constexpr I slack_cells(T v, usize axis) const
+    {
+        return static_cast<I>(min(slack(v, axis) * inv_scale[axis], MAX_CODE - ONE<T>)) + 1;
+    }
+
+    // 截断后直接向外移动余量对应的格数，再用反量化结果检查
+    // 格点比浮点数的精度还细时(远离原点的小场景)，相邻的上千个格点反量化后是同一个值，所以校正也按余量的格数整段移动，最多一两次
+    // 退化的轴上所有格点反量化后都是同一个值，直接取0
+    constexpr I quantize_floor(T v, usize axis) const
+    {
+        if(is_zero(scale[axis])) return 0;
+        const T t = clamp(ZERO<T>, (v - origin[axis]) * inv_scale[axis], MAX_CODE);
+        const T target = v - slack(v, axis);
+        const I d = slack_cells(v, axis);
+        I q = static_cast<I>(t);
+        do
+            q = q > d ? q - d : 0;
+        while(q > 0 && dequantize(q, axis) > target);
+        return q;
+    }
+
+    constexpr I quantize_ceil(T v, usize axis) const
+    {
+        if(is_zero(scale[axis])) return 0;
+        const T t = clamp(ZERO<T>, (v - origin[axis]) * inv_scale[axis], MAX_CODE);
+        const T target = v + slack(v, axis);
+        const I d = slack_cells(v, axis);
+        I q = static_cast<I>(t);
+        if(static_cast<T>(q) < t) q++;
+        do
+            q = q < MAX_Q - d ? q + d : MAX_Q;
+        while(q < MAX_Q && dequantize(q, axis) < target);
+        return q;
+    }
+
+    constexpr Point3<I> quantize(const Point3<T>& p) const
+    {
+        return {quantize_nearest(p.x, 0), quantize_nearest(p.y, 1), quantize_nearest(p.z, 2)};
+    }
+
+    constexpr Bounds3<I> quantize(const Bounds3<T>& b) const
+    {
+        Bounds3<I> ret;
+        ret.p_min = {quantize_floor(b.p_min.x, 0), quantize_floor(b.p_min.y, 1), quantize_floor(b.p_min.z, 2)};
+        ret.p_max = {quantize_ceil(b.p_max.x, 0), quantize_ceil(b.p_max.y, 1), quantize_ceil(b.p_max.z, 2)};
+        return ret;
+    }
+
+    void quantize(std::span<const Point3<T>> from, std::span<Point3<I>> to) const
+    {
+        assert(from.size() == to.size());
+        for(usize i = 0; i < from.size(); i++)
+            to[i] = quantize(from[i]);
+    }
+
+    void quantize(std::span<const Bounds3<T>> from, std::span<Bounds3<I>> to) const
+    {
+        assert(from.size() == to.size());
+        for(usize i = 0; i < from.size(); i++)
+            to[i] = quantize(from[i]);
+    }
+
+    void dequantize(std::span<const Point3<I>> from, std::span<Point3<T>> to) const
+    {
+        assert(from.size() == to.size());
+        for(usize i = 0; i < from.size(); i++)
+            to[i] = dequantize(from[i]);
+    }
+
+    void dequantize(std::span<const Bounds3<I>> from, std::span<Bounds3<T>> to) const
+    {
+        assert(from.size() == to.size());
+        for(usize i = 0; i < from.size(); i++)
+            to[i] = dequantize(from[i]);
+    }
+};
+
+NAMESPACE_END(Hinae)
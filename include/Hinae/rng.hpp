@@ -1,13 +1,37 @@
 #pragma once
 
+#if defined(USE_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #include "basic_type.hpp"
+#include "SoA.hpp"
 
 #include <ctime>
 
+#include <cstdint>
 #include <random>
+#include <array>
 
 NAMESPACE_BEGIN(Hinae)
 
+// 把随机位转换到[0, 1)，只用高位的尾数宽度，保证不会取到1
+constexpr f32 bits_to_unit_f32(std::uint32_t x)
+{
+    return static_cast<f32>(x >> 8) * 0x1p-24f;
+}
+
+constexpr f64 bits_to_unit_f64(std::uint64_t x)
+{
+    return static_cast<f64>(x >> 11) * 0x1p-53;
+}
+
+// 跨平台可复现的输出类型：f32/f64和定长的std::uint32_t/std::uint64_t
+// u32等fast类型在不同平台上位宽不同(Linux x86_64上u32是64位，MSVC上是32位)，输出的位数和消耗的次数都会不同
+template <typename T>
+concept portable_random = std::same_as<T, f32> || std::same_as<T, f64>
+                       || std::same_as<T, std::uint32_t> || std::same_as<T, std::uint64_t>;
+
 template <arithmetic T>
 using LCG = Linear_congruential_generator<T, 16807u, 0u, MAX_NUMBER<u32>>;
 
@@ -57,4 +81,391 @@ public:
     }
 };
 
+// O'Neill 2014, "PCG: A Family of Simple Fast Space-Efficient Statistically Good Algorithms for Random Number Generation"
+// 不同stream的序列互不重叠，advance可以在O(log n)内跳到任意位置，适合给每个线程/像素分配独立的序列
+struct PCG32
+{
+private:
+    static constexpr std::uint64_t MULTIPLIER = 0x5851f42d4c957f2dull;
+    static constexpr std::uint64_t DEFAULT_STATE = 0x853c49e6748fea9bull;
+    static constexpr std::uint64_t DEFAULT_STREAM = 0xda3e39cb94b95bdbull;
+
+    std::uint64_t state;
+    std::uint64_t inc;
+
+    constexpr void step() { state = state * MULTIPLIER + inc; }
+
+public:
+    constexpr PCG32() : state(DEFAULT_STATE), inc(DEFAULT_STREAM) {}
+
+    constexpr PCG32(std::uint64_t seed, std::uint64_t stream = 1) { set_sequence(seed, stream); }
+
+    constexpr void set_sequence(std::uint64_t seed, std::uint64_t stream)
+    {
+        state = 0;
+        inc = (stream << 1) | 1;
+        step();
+        state += seed;
+        step();
+    }
+
+    constexpr std::uint32_t next()
+    {
+        const std::uint64_t old = state;
+        step();
+        const auto xorshifted = static_cast<std::uint32_t>(((old >> 18) ^ old) >> 27);
+        const auto rot = static_cast<std::uint32_t>(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((~rot + 1) & 31));
+    }
+
+    // 浮点数在[0, 1)，整数取满位宽
+    template <arithmetic T>
+    constexpr T get()
+    {
+        static_assert(portable_random<T>, "use f32, f64, std::uint32_t or std::uint64_t");
+        if constexpr(std::is_same_v<T, f32>)
+            return bits_to_unit_f32(next());
+        else if constexpr(std::is_same_v<T, f64> || std::is_same_v<T, std::uint64_t>)
+        {
+            // 同一个表达式里两次调用next()的求值顺序是未指定的，先取高位再取低位
+            const std::uint64_t hi = next();
+            const std::uint64_t lo = next();
+            if constexpr(std::is_same_v<T, f64>)
+                return bits_to_unit_f64((hi << 32) | lo);
+            else
+                return static_cast<T>((hi << 32) | lo);
+        }
+        else
+            return static_cast<T>(next());
+    }
+
+    // Lemire 2019, "Fast Random Integer Generation in an Interval"，结果在[0, bound)，bound不能为0
+    constexpr std::uint32_t bounded(std::uint32_t bound)
+    {
+        assert(bound > 0);
+        std::uint64_t m = static_cast<std::uint64_t>(next()) * bound;
+        auto low = static_cast<std::uint32_t>(m);
+        if(low < bound)
+        {
+            const std::uint32_t threshold = (~bound + 1) % bound;
+            while(low < threshold)
+            {
+                m = static_cast<std::uint64_t>(next()) * bound;
+                low = static_cast<std::uint32_t>(m);
+            }
+        }
+        return static_cast<std::uint32_t>(m >> 32);
+    }
+
+    // Brown 1994, "Random Number Generation with Arbitrary Stride"
+    // delta为负数时利用周期2^64回退
+    constexpr void advance(std::int64_t delta)
+    {
+        std::uint64_t cur_mult = MULTIPLIER, cur_plus = inc;
+        std::uint64_t acc_mult = 1, acc_plus = 0;
+        for(auto n = static_cast<std::uint64_t>(delta); n > 0; n >>= 1)
+        {
+            if(n & 1)
+            {
+                acc_mult *= cur_mult;
+                acc_plus = acc_plus * cur_mult + cur_plus;
+            }
+            cur_plus = (cur_mult + 1) * cur_plus;
+            cur_mult *= cur_mult;
+        }
+        state = acc_mult * state + acc_plus;
+    }
+
+    constexpr bool operator == (const PCG32&) const = default;
+};
+
+constexpr std::uint64_t splitmix64(std::uint64_t& x)
+{
+    std::uint64_t z = (x += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Blackman and Vigna 2018, "Scrambled Linear Pseudorandom Number Generators"
+// 8条lane各自是一个xoshiro128+，lane之间相隔2^64步，每次产生8个32位随机数
+struct Xoshiro128x8
+{
+    static constexpr usize LANES = 8;
+
+private:
+    alignas(32) std::uint32_t s[4][LANES];
+
+    static constexpr std::uint32_t rotl(std::uint32_t x, int k)
+    {
+        return (x << k) | (x >> (32 - k));
+    }
+
+    static constexpr void step(std::uint32_t (&lane)[4])
+    {
+        const std::uint32_t t = lane[1] << 9;
+        lane[2] ^= lane[0];
+        lane[3] ^= lane[1];
+        lane[1] ^= lane[2];
+        lane[0] ^= lane[3];
+        lane[2] ^= t;
+        lane[3] = rotl(lane[3], 11);
+    }
+
+    // 相当于调用2^64次step
+    static constexpr void jump(std::uint32_t (&lane)[4])
+    {
+        constexpr std::uint32_t JUMP[]{0x8764000b, 0xf542d2d3, 0x6fa035c3, 0x77f2db5b};
+        std::uint32_t r[4]{};
+        for(auto j : JUMP)
+        {
+            for(int b = 0; b < 32; b++)
+            {
+                if(j & (1u << b))
+                {
+                    for(int k = 0; k < 4; k++) r[k] ^= lane[k];
+                }
+                step(lane);
+            }
+        }
+        for(int k = 0; k < 4; k++) lane[k] = r[k];
+    }
+
+public:
+    constexpr Xoshiro128x8(std::uint64_t seed = 0)
+    {
+        std::uint32_t lane[4];
+        const std::uint64_t a = splitmix64(seed), b = splitmix64(seed);
+        lane[0] = static_cast<std::uint32_t>(a);
+        lane[1] = static_cast<std::uint32_t>(a >> 32);
+        lane[2] = static_cast<std::uint32_t>(b);
+        lane[3] = static_cast<std::uint32_t>(b >> 32);
+        for(usize l = 0; l < LANES; l++)
+        {
+            for(usize k = 0; k < 4; k++) s[k][l] = lane[k];
+            jump(lane);
+        }
+    }
+
+    constexpr std::array<std::uint32_t, 4> state(usize lane) const
+    {
+        assert(lane < LANES);
+        return {s[0][lane], s[1][lane], s[2][lane], s[3][lane]};
+    }
+
+    constexpr std::array<std::uint32_t, LANES> next()
+    {
+        std::array<std::uint32_t, LANES> ret;
+#if defined(USE_SIMD) && defined(__AVX2__)
+        if(!std::is_constant_evaluated())
+        {
+            __m256i s0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[0]));
+            __m256i s1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[1]));
+            __m256i s2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[2]));
+            __m256i s3 = _mm256_load_si256(reinterpret_cast<const __m256i*>(s[3]));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(ret.data()), _mm256_add_epi32(s0, s3));
+            const __m256i t = _mm256_slli_epi32(s1, 9);
+            s2 = _mm256_xor_si256(s2, s0);
+            s3 = _mm256_xor_si256(s3, s1);
+            s1 = _mm256_xor_si256(s1, s2);
+            s0 = _mm256_xor_si256(s0, s3);
+            s2 = _mm256_xor_si256(s2, t);
+            s3 = _mm256_or_si256(_mm256_slli_epi32(s3, 11), _mm256_srli_epi32(s3, 21));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(s[0]), s0);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(s[1]), s1);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(s[2]), s2);
+            _mm256_store_si256(reinterpret_cast<__m256i*>(s[3]), s3);
+            return ret;
+        }
+#endif
+        for(usize l = 0; l < LANES; l++)
+        {
+            ret[l] = s[0][l] + s[3][l];
+            const std::uint32_t t = s[1][l] << 9;
+            s[2][l] ^= s[0][l];
+            s[3][l] ^= s[1][l];
+            s[1][l] ^= s[2][l];
+            s[0][l] ^= s[3][l];
+            s[2][l] ^= t;
+            s[3][l] = rotl(s[3][l], 11);
+        }
+        return ret;
+    }
+
+    template <std::floating_point T>
+    constexpr std::array<T, LANES> next()
+    {
+        std::array<T, LANES> ret;
+        const auto a = next();
+        if constexpr(std::is_same_v<T, f32>)
+        {
+            for(usize l = 0; l < LANES; l++)
+                ret[l] = bits_to_unit_f32(a[l]);
+        }
+        else
+        {
+            const auto b = next();
+            for(usize l = 0; l < LANES; l++)
+                ret[l] = bits_to_unit_f64((static_cast<std::uint64_t>(a[l]) << 32) | b[l]);
+        }
+        return ret;
+    }
+
+    // 每次填满8个，末尾不足8个的部分丢弃多余的输出
+    template <typename T> requires std::same_as<T, std::uint32_t> || std::floating_point<T>
+    constexpr void fill(std::span<T> out)
+    {
+        for(usize i = 0; i < out.size(); i += LANES)
+        {
+            std::array<T, LANES> block;
+            if constexpr(std::floating_point<T>)
+                block = next<T>();
+            else
+                block = next();
+            const usize n = min(LANES, out.size() - i);
+            for(usize l = 0; l < n; l++)
+                out[i + l] = block[l];
+        }
+    }
+
+    template <std::floating_point T>
+    constexpr void fill(Point2SoA<T> out)
+    {
+        fill(out.x);
+        fill(out.y);
+    }
+
+    template <std::floating_point T>
+    constexpr void fill(Point3SoA<T> out)
+    {
+        fill(out.x);
+        fill(out.y);
+        fill(out.z);
+    }
+
+    template <std::floating_point T>
+    constexpr void fill(Vector3SoA<T> out)
+    {
+        fill(out.x);
+        fill(out.y);
+        fill(out.z);
+    }
+};
+
+// 128位无符号整数，只实现PCG64需要的加法和乘法
+struct U128
+{
+    std::uint64_t hi, lo;
+
+    constexpr U128 operator + (const U128& rhs) const
+    {
+        const std::uint64_t l = lo + rhs.lo;
+        return {hi + rhs.hi + (l < lo), l};
+    }
+
+    constexpr U128 operator * (const U128& rhs) const
+    {
+        U128 ret = mul64(lo, rhs.lo);
+        ret.hi += hi * rhs.lo + lo * rhs.hi;
+        return ret;
+    }
+
+    constexpr U128 operator << (u32 n) const
+    {
+        if(n == 0) return *this;
+        if(n >= 64) return {lo << (n - 64), 0};
+        return {(hi << n) | (lo >> (64 - n)), lo << n};
+    }
+
+    constexpr U128 operator | (const U128& rhs) const { return {hi | rhs.hi, lo | rhs.lo}; }
+
+    constexpr bool operator == (const U128&) const = default;
+
+    static constexpr U128 mul64(std::uint64_t a, std::uint64_t b)
+    {
+#ifdef __SIZEOF_INT128__
+        const unsigned __int128 p = static_cast<unsigned __int128>(a) * b;
+        return {static_cast<std::uint64_t>(p >> 64), static_cast<std::uint64_t>(p)};
+#else
+        const std::uint64_t a_lo = a & 0xffffffff, a_hi = a >> 32;
+        const std::uint64_t b_lo = b & 0xffffffff, b_hi = b >> 32;
+        const std::uint64_t p0 = a_lo * b_lo, p1 = a_lo * b_hi;
+        const std::uint64_t p2 = a_hi * b_lo, p3 = a_hi * b_hi;
+        const std::uint64_t mid = (p0 >> 32) + (p1 & 0xffffffff) + (p2 & 0xffffffff);
+        return {p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32), (mid << 32) | (p0 & 0xffffffff)};
+#endif
+    }
+};
+
+// pcg64 (XSL RR 128/64)，周期2^128，每次输出64位
+struct PCG64
+{
+private:
+    static constexpr U128 MULTIPLIER{0x2360ed051fc65da4ull, 0x4385df649fccf645ull};
+    static constexpr U128 DEFAULT_STATE{0x979c9a98d8462005ull, 0x7d3e9cb6cfe0549bull};
+    static constexpr U128 DEFAULT_STREAM{0x5851f42d4c957f2dull, 0x14057b7ef767814full};
+
+    U128 state;
+    U128 inc;
+
+    constexpr void step() { state = state * MULTIPLIER + inc; }
+
+public:
+    constexpr PCG64() : state(DEFAULT_STATE), inc(DEFAULT_STREAM) {}
+
+    constexpr PCG64(std::uint64_t seed, std::uint64_t stream = 1) { set_sequence(seed, stream); }
+
+    constexpr void set_sequence(std::uint64_t seed, std::uint64_t stream)
+    {
+        state = {0, 0};
+        inc = (U128{0, stream} << 1) | U128{0, 1};
+        step();
+        state = state + U128{0, seed};
+        step();
+    }
+
+    constexpr std::uint64_t next()
+    {
+        step();
+        const std::uint64_t x = state.hi ^ state.lo;
+        const auto rot = static_cast<u32>(state.hi >> 58);
+        return (x >> rot) | (x << ((~rot + 1) & 63));
+    }
+
+    template <arithmetic T>
+    constexpr T get()
+    {
+        static_assert(portable_random<T>, "use f32, f64, std::uint32_t or std::uint64_t");
+        if constexpr(std::is_same_v<T, f32>)
+            return bits_to_unit_f32(static_cast<std::uint32_t>(next() >> 32));
+        else if constexpr(std::is_same_v<T, f64>)
+            return bits_to_unit_f64(next());
+        else if constexpr(std::is_same_v<T, std::uint32_t>)
+            return static_cast<std::uint32_t>(next());
+        else
+            return next();
+    }
+
+    constexpr void advance(std::int64_t delta)
+    {
+        // 把有符号的步数扩展到128位，负数对应模2^128回退
+        const U128 steps{delta < 0 ? ~0ull : 0ull, static_cast<std::uint64_t>(delta)};
+        U128 cur_mult = MULTIPLIER, cur_plus = inc;
+        U128 acc_mult{0, 1}, acc_plus{0, 0};
+        for(U128 n = steps; n.hi != 0 || n.lo != 0; n = {n.hi >> 1, (n.lo >> 1) | (n.hi << 63)})
+        {
+            if(n.lo & 1)
+            {
+                acc_mult = acc_mult * cur_mult;
+                acc_plus = acc_plus * cur_mult + cur_plus;
+            }
+            cur_plus = (cur_mult + U128{0, 1}) * cur_plus;
+            cur_mult = cur_mult * cur_mult;
+        }
+        state = acc_mult * state + acc_plus;
+    }
+
+    constexpr bool operator == (const PCG64&) const = default;
+};
+
 NAMESPACE_END(Hinae)
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <vector>
+#include <fstream>
+#include <cstring>
+
+#include "Point2.hpp"
+#include "mapped_file.hpp"
+#include "low_discrepancy.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+enum class SamplePattern : std::uint32_t
+{
+    PMJ02 = 0,
+    BlueNoise = 1,
+};
+
+// Christensen et al. 2018, "Progressive Multi-Jittered Sample Sequences"
+// pmj02序列的每个2的幂前缀都在所有基本区间上分层，和Owen scrambling的二维Sobol是同一类(0, 2)序列
+// 这里直接用后者构造，生成n个点只需要O(n)
+inline std::vector<Point2f> generate_pmj02(usize n, std::uint32_t seed)
+{
+    assert(n <= MAX_NUMBER<std::uint32_t>);
+    const std::uint32_t scramble = seed == 0 ? 1 : seed;
+    std::vector<Point2f> ret(n);
+    for(usize i = 0; i < n; i++)
+    {
+        const auto index = static_cast<std::uint32_t>(i);
+        ret[i] = {to_unit<f32>(owen_scrambled_sobol_bits(index, 0, scramble)),
+                  to_unit<f32>(owen_scrambled_sobol_bits(index, 1, scramble))};
+    }
+    return ret;
+}
+
+// Mitchell 1991的best candidate，在环面上度量距离，任意前缀都是蓝噪声分布
+// 每个新点从若干个随机候选里选离已有点最远的一个，最近点查询用均匀网格加速
+inline std::vector<Point2f> generate_blue_noise(usize n, std::uint64_t seed, usize max_candidates = 64)
+{
+    std::vector<Point2f> ret;
+    ret.reserve(n);
+    if(n == 0) return ret;
+
+    const usize res = max<usize>(1, static_cast<usize>(std::sqrt(static_cast<f64>(n) / 2)));
+    const f32 cell = 1.0f / static_cast<f32>(res);
+    std::vector<std::vector<std::uint32_t>> grid(res * res);
+    const auto cell_of = [&](f32 v) { return min(static_cast<usize>(v * static_cast<f32>(res)), res - 1); };
+
+    const auto toroidal_distance2 = [](const Point2f& a, const Point2f& b)
+    {
+        const f32 dx = min(std::abs(a.x - b.x), 1 - std::abs(a.x - b.x));
+        const f32 dy = min(std::abs(a.y - b.y), 1 - std::abs(a.y - b.y));
+        return dx * dx + dy * dy;
+    };
+
+    // 按切比雪夫距离一圈一圈向外搜索，当前圈不可能更近时停止
+    const auto nearest2 = [&](const Point2f& p)
+    {
+        const usize cx = cell_of(p.x), cy = cell_of(p.y);
+        f32 best = INFINITY_<f32>;
+        for(usize r = 0; r <= res / 2; r++)
+        {
+            if(r > 0 && pow2(static_cast<f32>(r - 1) * cell) >= best) break;
+            const isize lo = -static_cast<isize>(r), hi = static_cast<isize>(r);
+            for(isize dy = lo; dy <= hi; dy++)
+            {
+                for(isize dx = lo; dx <= hi; dx++)
+                {
+                    if(std::max(std::abs(dx), std::abs(dy)) != hi) continue;
+                    const usize gx = static_cast<usize>((static_cast<isize>(cx + res) + dx) % static_cast<isize>(res));
+                    const usize gy = static_cast<usize>((static_cast<isize>(cy + res) + dy) % static_cast<isize>(res));
+                    for(std::uint32_t i : grid[gy * res + gx])
+                        best = min(best, toroidal_distance2(p, ret[i]));
+                }
+            }
+        }
+        return best;
+    };
+
+    PCG32 rng{seed, 0x626c7565};
+    for(usize i = 0; i < n; i++)
+    {
+        Point2f best_point{rng.get<f32>(), rng.get<f32>()};
+        f32 best_distance = i == 0 ? ZERO<f32> : nearest2(best_point);
+        const usize candidates = min(i + 1, max_candidates);
+        for(usize c = 1; c < candidates; c++)
+        {
+            const Point2f p{rng.get<f32>(), rng.get<f32>()};
+            const f32 d = nearest2(p);
+            if(d > best_distance)
+            {
+                best_distance = d;
+                best_point = p;
+            }
+        }
+        grid[cell_of(best_point.y) * res + cell_of(best_point.x)].push_back(static_cast<std::uint32_t>(i));
+        ret.push_back(best_point);
+    }
+    return ret;
+}
+
+inline std::vector<Point2f> generate_sample_pattern(SamplePattern pattern, usize n, std::uint64_t seed)
+{
+    switch(pattern)
+    {
+    case SamplePattern::PMJ02:     return generate_pmj02(n, static_cast<std::uint32_t>(seed ^ (seed >> 32)));
+    case SamplePattern::BlueNoise: return generate_blue_noise(n, seed);
+    }
+    return {};
+}
+
+// 磁盘格式：固定大小的头部后面紧跟count个Point2f，按写入机器的字节序存储
+// 魔数同时是字节序标记：字节序不同的机器读到的魔数是反的，文件被当作无效的缓存重新生成
+// 头部和点数组都按8字节对齐，映射之后直接当作std::span<const Point2f>使用
+struct SampleTableHeader
+{
+    static constexpr std::uint32_t MAGIC = 0x504d5348; // "HSMP"
+    static constexpr std::uint32_t VERSION = 1;
+
+    std::uint32_t magic = MAGIC;
+    std::uint32_t version = VERSION;
+    SamplePattern pattern;
+    std::uint32_t count;
+    std::uint64_t seed;
+};
+
+static_assert(sizeof(Point2f) == 2 * sizeof(f32) && alignof(Point2f) == alignof(f32));
+static_assert(sizeof(SampleTableHeader) == 24 && sizeof(SampleTableHeader) % alignof(Point2f) == 0);
+
+// 先写临时文件再重命名，其他进程不会映射到写了一半的文件
+inline bool write_sample_table(const std::filesystem::path& path, SamplePattern pattern, std::uint64_t seed, std::span<const Point2f> points)
+{
+    if(points.size() > MAX_NUMBER<std::uint32_t>) return false;
+    const SampleTableHeader header{.pattern = pattern, .count = static_cast<std::uint32_t>(points.size()), .seed = seed};
+
+    const std::filesystem::path tmp = temporary_path(path);
+    {
+        std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+        if(!out) return false;
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(points.data()), static_cast<std::streamsize>(points.size_bytes()));
+        // 缓冲区在close时才写完，写满磁盘之类的错误到这里才能看到
+        out.close();
+        if(!out)
+        {
+            std::error_code ec;
+            std::filesystem::remove(tmp, ec);
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if(!ec) return true;
+    std::filesystem::remove(tmp, ec);
+    return false;
+}
+
+// 映射文件中的采样表，points()不拷贝数据；文件不可用时退回到内存中的表
+struct SampleTable
+{
+private:
+    SampleTableHeader header_{};
+    MappedFile file;
+    std::vector<Point2f> owned;
+    std::span<const Point2f> view;
+
+public:
+    SampleTable() = default;
+
+    SampleTable(SampleTableHeader header, std::vector<Point2f> points)
+        : header_(header), owned(std::move(points)), view(owned) {}
+
+    SampleTable(const SampleTable&) = delete;
+    SampleTable& operator = (const SampleTable&) = delete;
+
+    // vector和MappedFile移动时都不改变数据地址，view可以直接跟着移动
+    SampleTable(SampleTable&&) noexcept = default;
+    SampleTable& operator = (SampleTable&&) noexcept = default;
+
+    // 魔数(包括字节序)、版本或者文件大小不对时返回空
+    static std::optional<SampleTable> open(const std::filesystem::path& path)
+    {
+        auto mapped = MappedFile::open(path);
+        if(!mapped || mapped->size() < sizeof(SampleTableHeader)) return {};
+
+        SampleTableHeader header;
+        std::memcpy(&header, mapped->data(), sizeof(header));
+        if(header.magic != SampleTableHeader::MAGIC || header.version != SampleTableHeader::VERSION) return {};
+        if(mapped->size() != sizeof(SampleTableHeader) + static_cast<usize>(header.count) * sizeof(Point2f)) return {};
+
+        SampleTable ret;
+        ret.header_ = header;
+        ret.view = {reinterpret_cast<const Point2f*>(mapped->data() + sizeof(SampleTableHeader)), header.count};
+        ret.file = std::move(*mapped);
+        return ret;
+    }
+
+    // 缓存文件存在且参数一致时直接映射，否则生成后写入缓存再映射
+    static SampleTable load_or_generate(const std::filesystem::path& path, SamplePattern pattern, usize count, std::uint64_t seed)
+    {
+        if(auto table = open(path))
+        {
+            const auto& h = table->header();
+            if(h.pattern == pattern && h.count == count && h.seed == seed)
+                return std::move(*table);
+        }
+
+        auto points = generate_sample_pattern(pattern, count, seed);
+        if(write_sample_table(path, pattern, seed, points))
+        {
+            if(auto table = open(path))
+                return std::move(*table);
+        }
+        return {SampleTableHeader{.pattern = pattern, .count = static_cast<std::uint32_t>(count), .seed = seed}, std::move(points)};
+    }
+
+    const SampleTableHeader& header() const { return header_; }
+
+    bool is_mapped() const { return file.data() != nullptr; }
+
+    std::span<const Point2f> points() const { return view; }
+
+    usize size() const { return view.size(); }
+
+    const Point2f& operator [] (usize i) const { return view[i]; }
+};
+
+NAMESPACE_END(Hinae)
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <span>
+
+#include "Point2.hpp"
+#include "Trigonometric.hpp"
+#include "coordinate_system.hpp"
+#include "stats.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+// 所有方向都在局部坐标系下(z轴朝上)，需要时用local_to_world转到世界坐标
+// 标量版本和批量版本使用同一套无分支的公式，但编译器可能对两者做不同的FMA合并和向量化，
+// 结果只保证在几个ulp内一致，不保证逐位相同
+
+NAMESPACE_BEGIN(Sampling)
+
+// [-pi/4, pi/4]内的sin和cos，多项式展开没有分支，可以被编译器向量化
+template <std::floating_point T>
+constexpr std::tuple<T, T> sincos_quarter_pi(T x)
+{
+    const T x2 = x * x;
+    if constexpr(std::is_same_v<T, f32>)
+    {
+        const T s = x * (1 + x2 * (-1 / T(6) + x2 * (1 / T(120) + x2 * (-1 / T(5040) + x2 * (1 / T(362880))))));
+        const T c = 1 + x2 * (-1 / T(2) + x2 * (1 / T(24) + x2 * (-1 / T(720) + x2 * (1 / T(40320)))));
+        return {s, c};
+    }
+    else
+    {
+        T s = 1 / T(1307674368000), c = -1 / T(87178291200);
+        s = -1 / T(6227020800) + x2 * s;
+        c = 1 / T(479001600)   + x2 * c;
+        s = 1 / T(39916800)    + x2 * s;
+        c = -1 / T(3628800)    + x2 * c;
+        s = -1 / T(362880)     + x2 * s;
+        c = 1 / T(40320)       + x2 * c;
+        s = 1 / T(5040)        + x2 * s;
+        c = -1 / T(720)        + x2 * c;
+        s = -1 / T(120)        + x2 * s;
+        c = 1 / T(24)          + x2 * c;
+        s = 1 / T(6)           + x2 * s;
+        c = -1 / T(2)          + x2 * c;
+        s = x - x * x2 * s;
+        c = 1                  + x2 * c;
+        return {s, c};
+    }
+}
+
+// 局部坐标系下的各向异性GGX，写成直角坐标形式避免三角函数和分支
+template <std::floating_point T>
+constexpr T ggx_d(const Vector3<T>& wm, T alpha_x, T alpha_y)
+{
+    const T x = wm.x / alpha_x, y = wm.y / alpha_y;
+    const T t = x * x + y * y + wm.z * wm.z;
+    return ONE<T> / (PI<T> * alpha_x * alpha_y * t * t);
+}
+
+template <std::floating_point T>
+constexpr T ggx_g1(const Vector3<T>& w, T alpha_x, T alpha_y)
+{
+    const T x = w.x * alpha_x, y = w.y * alpha_y;
+    const T lambda = (sqrt(ONE<T> + (x * x + y * y) / (w.z * w.z)) - ONE<T>) / 2;
+    return ONE<T> / (ONE<T> + lambda);
+}
+
+NAMESPACE_END(Sampling)
+
+// Shirley and Chiu 1997，保持面积比例的正方形到圆盘映射
+template <std::floating_point T>
+constexpr std::tuple<Point2<T>, T> sample_concentric_disk(const Point2<T>& u)
+{
+    const T ox = 2 * u.x - ONE<T>;
+    const T oy = 2 * u.y - ONE<T>;
+    const bool x_major = fabs(ox) > fabs(oy);
+    const T r = x_major ? ox : oy;
+    const T safe_r = is_zero(r) ? ONE<T> : r;
+    const auto [s, c] = Sampling::sincos_quarter_pi(PI_OVER_4<T> * (x_major ? oy : ox) / safe_r);
+    return {{r * (x_major ? c : s), r * (x_major ? s : c)}, INV_PI<T>};
+}
+
+// 圆盘上的点抬升到球冠上仍然保持面积比例，Clarberg 2008
+// h = 1 - cos_theta_max，h = 1时是半球
+template <std::floating_point T>
+constexpr Vector3<T> concentric_to_cap(const Point2<T>& d, T h)
+{
+    const T r2 = d.x * d.x + d.y * d.y;
+    const T s = sqrt(max(ZERO<T>, h * (2 - r2 * h)));
+    return {d.x * s, d.y * s, ONE<T> - r2 * h};
+}
+
+template <std::floating_point T>
+constexpr T uniform_hemisphere_pdf() { return INV_2PI<T>; }
+
+template <std::floating_point T>
+constexpr T uniform_sphere_pdf() { return INV_4PI<T>; }
+
+template <std::floating_point T>
+constexpr T cosine_hemisphere_pdf(T cos_theta) { return cos_theta * INV_PI<T>; }
+
+template <std::floating_point T>
+constexpr T uniform_cone_pdf(T cos_theta_max) { return INV_2PI<T> / (ONE<T> - cos_theta_max); }
+
+template <std::floating_point T>
+constexpr std::tuple<Vector3<T>, T> sample_uniform_hemisphere(const Point2<T>& u)
+{
+    const auto [d, _] = sample_concentric_disk(u);
+    return {concentric_to_cap(d, ONE<T>), uniform_hemisphere_pdf<T>()};
+}
+
+// u.x的前半段映射到上半球，后半段映射到下半球
+template <std::floating_point T>
+constexpr std::tuple<Vector3<T>, T> sample_uniform_sphere(const Point2<T>& u)
+{
+    const bool upper = u.x < static_cast<T>(0.5);
+    const T ux = upper ? 2 * u.x : 2 * u.x - ONE<T>;
+    const auto [d, _] = sample_concentric_disk(Point2<T>{ux, u.y});
+    const Vector3<T> w = concentric_to_cap(d, ONE<T>);
+    return {{w.x, w.y, upper ? w.z : -w.z}, uniform_sphere_pdf<T>()};
+}
+
+// Malley方法，圆盘上均匀采样再投影到半球
+template <std::floating_point T>
+constexpr std::tuple<Vector3<T>, T> sample_cosine_hemisphere(const Point2<T>& u)
+{
+    const auto [d, _] = sample_concentric_disk(u);
+    const T z = sqrt(max(ZERO<T>, ONE<T> - d.x * d.x - d.y * d.y));
+    return {{d.x, d.y, z}, cosine_hemisphere_pdf(z)};
+}
+
+template <std::floating_point T>
+constexpr std::tuple<Vector3<T>, T> sample_uniform_cone(const Point2<T>& u, T cos_theta_max)
+{
+    const auto [d, _] = sample_concentric_disk(u);
+    return {concentric_to_cap(d, ONE<T> - cos_theta_max), uniform_cone_pdf(cos_theta_max)};
+}
+
+// Heitz 2019, "A Low-Distortion Map Between Triangle and Square"
+// 返回重心坐标，在重心坐标三角形上是均匀分布
+template <std::floating_point T>
+constexpr Point3<T> sample_uniform_triangle(const Point2<T>& u)
+{
+    const bool lower = u.x < u.y;
+    const T b0 = lower ? u.x / 2 : u.x - u.y / 2;
+    const T b1 = lower ? u.y - u.x / 2 : u.y / 2;
+    return {b0, b1, ONE<T> - b0 - b1};
+}
+
+// 返回三角形上的点和对面积的pdf
+template <std::floating_point T>
+constexpr std::tuple<Point3<T>, T>
+sample_uniform_triangle(const Point3<T>& p0, const Point3<T>& p1, const Point3<T>& p2, const Point2<T>& u)
+{
+    const auto [b0, b1, b2] = sample_uniform_triangle(u);
+    const Vector3<T> e1 = p1 - p0, e2 = p2 - p0;
+    const Point3<T> p = p0 + e1 * b1 + e2 * b2;
+    return {p, 2 / cross(e1, e2).norm()};
+}
+
+// 可见法线分布的pdf: D_wo(wm) = G1(wo) * max(0, wo·wm) * D(wm) / wo.z
+// wo在下半球时按翻转到上半球的方向计算，背向wo的微表面pdf为0
+template <std::floating_point T>
+constexpr T ggx_vndf_pdf(const Vector3<T>& wo, const Vector3<T>& wm, T alpha_x, T alpha_y)
+{
+    const T cos_o = fabs(wo.z);
+    const T cos_om = wo.z < ZERO<T> ? -dot(wo, wm) : dot(wo, wm);
+    return Sampling::ggx_g1(wo, alpha_x, alpha_y) * max(ZERO<T>, cos_om)
+         * Sampling::ggx_d(wm, alpha_x, alpha_y) / cos_o;
+}
+
+// Heitz 2018, "Sampling the GGX Distribution of Visible Normals"
+// 用同心圆盘映射代替极坐标，整个过程没有三角函数和分支
+template <std::floating_point T>
+constexpr std::tuple<Vector3<T>, T>
+sample_ggx_vndf(const Vector3<T>& wo, T alpha_x, T alpha_y, const Point2<T>& u)
+{
+    const T flip = wo.z < ZERO<T> ? -ONE<T> : ONE<T>;
+    const Vector3<T> vh = Vector3<T>{alpha_x * wo.x * flip, alpha_y * wo.y * flip, wo.z * flip}.normalized();
+
+    const T len2 = vh.x * vh.x + vh.y * vh.y;
+    const T inv_len = len2 > ZERO<T> ? ONE<T> / sqrt(len2) : ZERO<T>;
+    const Vector3<T> t1 = len2 > ZERO<T> ? Vector3<T>{-vh.y * inv_len, vh.x * inv_len, ZERO<T>}
+                                         : Vector3<T>{ONE<T>, ZERO<T>, ZERO<T>};
+    const Vector3<T> t2 = cross(vh, t1);
+
+    const auto [d, _] = sample_concentric_disk(u);
+    const T s = (ONE<T> + vh.z) / 2;
+    const T p1 = d.x;
+    const T p2 = (ONE<T> - s) * sqrt(max(ZERO<T>, ONE<T> - p1 * p1)) + s * d.y;
+    const T pz = sqrt(max(ZERO<T>, ONE<T> - p1 * p1 - p2 * p2));
+
+    const Vector3<T> nh = t1 * p1 + t2 * p2 + vh * pz;
+    const Vector3<T> wm = Vector3<T>{alpha_x * nh.x, alpha_y * nh.y, max(ZERO<T>, nh.z)}.normalized();
+    return {wm, ggx_vndf_pdf(wo, wm, alpha_x, alpha_y)};
+}
+
+// 批量版本，输入是随机数数组，输出写到SoA和pdf数组
+// 循环体内只有选择没有分支，可以被编译器向量化
+
+template <std::floating_point T>
+void sample_concentric_disk(std::span<const Point2<T>> u, Point2SoA<T> out, std::span<T> pdf)
+{
+    assert(out.size() == u.size() && pdf.size() == u.size());
+    Stats::batch<Stat::SampledPoints>(u.size());
+    T* x = out.x.data();
+    T* y = out.y.data();
+    for(usize i = 0; i < u.size(); i++)
+    {
+        const auto [d, p] = sample_concentric_disk(u[i]);
+        x[i] = d.x;
+        y[i] = d.y;
+        pdf[i] = p;
+    }
+}
+
+NAMESPACE_BEGIN(Sampling)
+
+template <std::floating_point T, typename F>
+void batch(std::span<const Point2<T>> u, Vector3SoA<T> out, std::span<T> pdf, F&& sample)
+{
+    assert(out.size() == u.size() && pdf.size() == u.size());
+    Stats::batch<Stat::SampledPoints>(u.size());
+    T* x = out.x.data();
+    T* y = out.y.data();
+    T* z = out.z.data();
+    for(usize i = 0; i < u.size(); i++)
+    {
+        const auto [w, p] = sample(u[i]);
+        x[i] = w.x;
+        y[i] = w.y;
+        z[i] = w.z;
+        pdf[i] = p;
+    }
+}
+
+NAMESPACE_END(Sampling)
+
+template <std::floating_point T>
+void sample_uniform_hemisphere(std::span<const Point2<T>> u, Vector3SoA<T> out, std::span<T> pdf)
+{
+    Sampling::batch(u, out, pdf, [](const Point2<T>& v) { return sample_uniform_hemisphere(v); });
+}
+
+template <std::floating_point T>
+void sample_uniform_sphere(std::span<const Point2<T>> u, Vector3SoA<T> out, std::span<T> pdf)
+{
+    Sampling::batch(u, out, pdf, [](const Point2<T>& v) { return sample_uniform_sphere(v); });
+}
+
+template <std::floating_point T>
+void sample_cosine_hemisphere(std::span<const Point2<T>> u, Vector3SoA<T> out, std::span<T> pdf)
+{
+    Sampling::batch(u, out, pdf, [](const Point2<T>& v) { return sample_cosine_hemisphere(v); });
+}
+
+template <std::floating_point T>
+void sample_uniform_cone(std::span<const Point2<T>> u, T cos_theta_max, Vector3SoA<T> out, std::span<T> pdf)
+{
+    Sampling::batch(u, out, pdf, [=](const Point2<T>& v) { return sample_uniform_cone(v, cos_theta_max); });
+}
+
+template <std::floating_point T>
+void sample_uniform_triangle(
+    const Point3<T>& p0, const Point3<T>& p1, const Point3<T>& p2,
+    std::span<const Point2<T>> u, Point3SoA<T> out, std::span<T> pdf)
+{
+    assert(out.size() == u.size() && pdf.size() == u.size());
+    Stats::batch<Stat::SampledPoints>(u.size());
+    T* x = out.x.data();
+    T* y = out.y.data();
+    T* z = out.z.data();
+    for(usize i = 0; i < u.size(); i++)
+    {
+        const auto [p, area_pdf] = sample_uniform_triangle(p0, p1, p2, u[i]);
+        x[i] = p.x;
+        y[i] = p.y;
+        z[i] = p.z;
+        pdf[i] = area_pdf;
+    }
+}
+
+// wo是每个着色点各自的出射方向
+template <std::floating_point T>
+void sample_ggx_vndf(
+    Vector3SoA<const T> wo, T alpha_x, T alpha_y,
+    std::span<const Point2<T>> u, Vector3SoA<T> out, std::span<T> pdf)
+{
+    assert(wo.size() == u.size() && out.size() == u.size() && pdf.size() == u.size());
+    Stats::batch<Stat::SampledPoints>(u.size());
+    const T* ox = wo.x.data();
+    const T* oy = wo.y.data();
+    const T* oz = wo.z.data();
+    T* x = out.x.data();
+    T* y = out.y.data();
+    T* z = out.z.data();
+    for(usize i = 0; i < u.size(); i++)
+    {
+        const auto [wm, p] = sample_ggx_vndf(Vector3<T>{ox[i], oy[i], oz[i]}, alpha_x, alpha_y, u[i]);
+        x[i] = wm.x;
+        y[i] = wm.y;
+        z[i] = wm.z;
+        pdf[i] = p;
+    }
+}
+
+NAMESPACE_END(Hinae)
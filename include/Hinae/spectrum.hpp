@@ -0,0 +1,401 @@
+#pragma once
+
+#ifdef USE_SIMD
+#include <immintrin.h>
+#endif
+
+#include <array>
+
+#include "Vector3.hpp"
+#include "physics.hpp"
+
+NAMESPACE_BEGIN(Hinae)
+
+inline constexpr f32 LAMBDA_MIN = 360;
+inline constexpr f32 LAMBDA_MAX = 830;
+
+template <usize N>
+concept spectrum_width = N == 4 || N == 8 || N == 16;
+
+// N个波长上的采样值，配合SampledWavelengths做hero wavelength光谱渲染
+// 定义USE_SIMD时f32的逐元素运算每4个一组用SSE计算
+template <std::floating_point T, usize N>
+    requires spectrum_width<N>
+struct SampledSpectrum
+{
+    std::array<T, N> values{};
+
+    enum class Op { Add, Sub, Mul, Div, Min, Max };
+
+private:
+    template <Op op>
+    static constexpr T apply(T a, T b)
+    {
+        if constexpr(op == Op::Add)      return a + b;
+        else if constexpr(op == Op::Sub) return a - b;
+        else if constexpr(op == Op::Mul) return a * b;
+        else if constexpr(op == Op::Div) return a / b;
+        else if constexpr(op == Op::Min) return min(a, b);
+        else                             return max(a, b);
+    }
+
+#ifdef USE_SIMD
+    template <Op op>
+    static __m128 apply(__m128 a, __m128 b)
+    {
+        if constexpr(op == Op::Add)      return _mm_add_ps(a, b);
+        else if constexpr(op == Op::Sub) return _mm_sub_ps(a, b);
+        else if constexpr(op == Op::Mul) return _mm_mul_ps(a, b);
+        else if constexpr(op == Op::Div) return _mm_div_ps(a, b);
+        else if constexpr(op == Op::Min) return _mm_min_ps(a, b);
+        else                             return _mm_max_ps(a, b);
+    }
+#endif
+
+public:
+    // 逐分量的二元运算
+    template <Op op>
+    static constexpr SampledSpectrum zip(const SampledSpectrum& a, const SampledSpectrum& b)
+    {
+        SampledSpectrum ret;
+#ifdef USE_SIMD
+        if constexpr(std::is_same_v<T, f32>)
+        {
+            if(!std::is_constant_evaluated())
+            {
+                for(usize i = 0; i < N; i += 4)
+                    _mm_storeu_ps(&ret[i], apply<op>(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+                return ret;
+            }
+        }
+#endif
+        for(usize i = 0; i < N; i++)
+            ret[i] = apply<op>(a[i], b[i]);
+        return ret;
+    }
+
+    constexpr SampledSpectrum() = default;
+    constexpr explicit SampledSpectrum(T c) { values.fill(c); }
+    constexpr explicit SampledSpectrum(const std::array<T, N>& values) : values(values) {}
+
+    static constexpr usize size() { return N; }
+
+    constexpr T& operator [] (usize i) { return values[i]; }
+    constexpr const T& operator [] (usize i) const { return values[i]; }
+
+    constexpr SampledSpectrum operator + (const SampledSpectrum& rhs) const { return zip<Op::Add>(*this, rhs); }
+    constexpr SampledSpectrum operator - (const SampledSpectrum& rhs) const { return zip<Op::Sub>(*this, rhs); }
+    constexpr SampledSpectrum operator * (const SampledSpectrum& rhs) const { return zip<Op::Mul>(*this, rhs); }
+    constexpr SampledSpectrum operator / (const SampledSpectrum& rhs) const { return zip<Op::Div>(*this, rhs); }
+
+    constexpr SampledSpectrum operator + (T rhs) const { return *this + SampledSpectrum(rhs); }
+    constexpr SampledSpectrum operator - (T rhs) const { return *this - SampledSpectrum(rhs); }
+    constexpr SampledSpectrum operator * (T rhs) const { return *this * SampledSpectrum(rhs); }
+    constexpr SampledSpectrum operator / (T rhs) const { return *this * SampledSpectrum(ONE<T> / rhs); }
+
+    constexpr SampledSpectrum operator - () const { return SampledSpectrum() - *this; }
+
+    constexpr void operator += (const SampledSpectrum& rhs) { *this = *this + rhs; }
+    constexpr void operator -= (const SampledSpectrum& rhs) { *this = *this - rhs; }
+    constexpr void operator *= (const SampledSpectrum& rhs) { *this = *this * rhs; }
+    constexpr void operator /= (const SampledSpectrum& rhs) { *this = *this / rhs; }
+    constexpr void operator *= (T rhs) { *this = *this * rhs; }
+    constexpr void operator /= (T rhs) { *this = *this / rhs; }
+
+    constexpr bool operator == (const SampledSpectrum& rhs) const { return values == rhs.values; }
+
+    // 有任何一个分量不为0
+    constexpr explicit operator bool () const
+    {
+        bool ret = false;
+        for(usize i = 0; i < N; i++) ret |= !is_zero(values[i]);
+        return ret;
+    }
+
+    constexpr T min_value() const
+    {
+        T ret = values[0];
+        for(usize i = 1; i < N; i++) ret = min(ret, values[i]);
+        return ret;
+    }
+
+    constexpr T max_value() const
+    {
+        T ret = values[0];
+        for(usize i = 1; i < N; i++) ret = max(ret, values[i]);
+        return ret;
+    }
+
+    constexpr T average() const
+    {
+        T ret = 0;
+        for(usize i = 0; i < N; i++) ret += values[i];
+        return ret / N;
+    }
+};
+
+template <std::floating_point T, usize N>
+constexpr SampledSpectrum<T, N> operator * (T lhs, const SampledSpectrum<T, N>& rhs) { return rhs * lhs; }
+
+template <std::floating_point T, usize N>
+constexpr SampledSpectrum<T, N> min(const SampledSpectrum<T, N>& a, const SampledSpectrum<T, N>& b)
+{
+    return SampledSpectrum<T, N>::template zip<SampledSpectrum<T, N>::Op::Min>(a, b);
+}
+
+template <std::floating_point T, usize N>
+constexpr SampledSpectrum<T, N> max(const SampledSpectrum<T, N>& a, const SampledSpectrum<T, N>& b)
+{
+    return SampledSpectrum<T, N>::template zip<SampledSpectrum<T, N>::Op::Max>(a, b);
+}
+
+template <std::floating_point T, usize N>
+constexpr SampledSpectrum<T, N> clamp(T low, const SampledSpectrum<T, N>& s, T high)
+{
+    return min(max(s, SampledSpectrum<T, N>(low)), SampledSpectrum<T, N>(high));
+}
+
+// 分母为0的分量结果为0，用于除以pdf
+template <std::floating_point T, usize N>
+constexpr SampledSpectrum<T, N> safe_div(const SampledSpectrum<T, N>& a, const SampledSpectrum<T, N>& b)
+{
+    SampledSpectrum<T, N> ret;
+    for(usize i = 0; i < N; i++)
+        ret[i] = is_zero(b[i]) ? ZERO<T> : a[i] / b[i];
+    return ret;
+}
+
+template <std::floating_point T, usize N>
+constexpr SampledSpectrum<T, N> sqrt(const SampledSpectrum<T, N>& s)
+{
+    SampledSpectrum<T, N> ret;
+#ifdef USE_SIMD
+    if constexpr(std::is_same_v<T, f32>)
+    {
+        if(!std::is_constant_evaluated())
+        {
+            for(usize i = 0; i < N; i += 4)
+                _mm_storeu_ps(&ret[i], _mm_sqrt_ps(_mm_loadu_ps(&s[i])));
+            return ret;
+        }
+    }
+#endif
+    for(usize i = 0; i < N; i++)
+        ret[i] = sqrt(s[i]);
+    return ret;
+}
+
+// SSE没有exp指令，逐分量调用标量版本
+template <std::floating_point T, usize N>
+constexpr SampledSpectrum<T, N> exp(const SampledSpectrum<T, N>& s)
+{
+    SampledSpectrum<T, N> ret;
+    for(usize i = 0; i < N; i++)
+        ret[i] = exp(s[i]);
+    return ret;
+}
+
+template <std::floating_point T, usize N>
+std::ostream& operator << (std::ostream& os, const SampledSpectrum<T, N>& s)
+{
+    os << '[';
+    for(usize i = 0; i < N; i++)
+        os << s[i] << (i + 1 == N ? "]" : ", ");
+    return os;
+}
+
+NAMESPACE_BEGIN(Spectrum)
+
+// Wyman et al. 2013, "Simple Analytic Approximations to the CIE XYZ Color Matching Functions"
+// 多瓣分段高斯拟合，与CIE 1931 2°标准观察者的表格相差约1%，在编译期展开成1nm间隔的表
+template <std::floating_point T>
+constexpr T piecewise_gaussian(T x, T mu, T sigma_low, T sigma_high)
+{
+    const T t = (x - mu) / (x < mu ? sigma_low : sigma_high);
+    return exp(-t * t / 2);
+}
+
+template <std::floating_point T>
+constexpr T cie_x_fit(T lambda)
+{
+    return static_cast<T>(1.056) * piecewise_gaussian<T>(lambda, 599.8, 37.9, 31.0)
+         + static_cast<T>(0.362) * piecewise_gaussian<T>(lambda, 442.0, 16.0, 26.7)
+         - static_cast<T>(0.065) * piecewise_gaussian<T>(lambda, 501.1, 20.4, 26.2);
+}
+
+template <std::floating_point T>
+constexpr T cie_y_fit(T lambda)
+{
+    return static_cast<T>(0.821) * piecewise_gaussian<T>(lambda, 568.8, 46.9, 40.5)
+         + static_cast<T>(0.286) * piecewise_gaussian<T>(lambda, 530.9, 16.3, 31.1);
+}
+
+template <std::floating_point T>
+constexpr T cie_z_fit(T lambda)
+{
+    return static_cast<T>(1.217) * piecewise_gaussian<T>(lambda, 437.0, 11.8, 36.0)
+         + static_cast<T>(0.681) * piecewise_gaussian<T>(lambda, 459.0, 26.0, 13.8);
+}
+
+inline constexpr usize CIE_SAMPLES = static_cast<usize>(LAMBDA_MAX - LAMBDA_MIN) + 1;
+
+template <typename F>
+constexpr std::array<f32, CIE_SAMPLES> tabulate(F f)
+{
+    std::array<f32, CIE_SAMPLES> ret;
+    for(usize i = 0; i < CIE_SAMPLES; i++)
+        ret[i] = static_cast<f32>(f(static_cast<f64>(LAMBDA_MIN) + static_cast<f64>(i)));
+    return ret;
+}
+
+inline constexpr auto CIE_X = tabulate(cie_x_fit<f64>);
+inline constexpr auto CIE_Y = tabulate(cie_y_fit<f64>);
+inline constexpr auto CIE_Z = tabulate(cie_z_fit<f64>);
+
+// ∫Y(λ)dλ，用同一张表求和，常数光谱1的亮度正好是1
+inline constexpr f32 CIE_Y_INTEGRAL = []
+{
+    f64 sum = 0;
+    for(f32 y : CIE_Y) sum += y;
+    return static_cast<f32>(sum);
+}();
+
+// 按1nm的表线性插值，范围外为0
+template <std::floating_point T>
+constexpr T lookup(const std::array<f32, CIE_SAMPLES>& table, T lambda)
+{
+    const T x = lambda - static_cast<T>(LAMBDA_MIN);
+    if(!(x >= 0 && x <= static_cast<T>(CIE_SAMPLES - 1))) return ZERO<T>;
+    const usize i = min(static_cast<usize>(x), CIE_SAMPLES - 2);
+    const T t = x - static_cast<T>(i);
+    return lerp(static_cast<T>(table[i]), static_cast<T>(table[i + 1]), t);
+}
+
+// pbrt-v4 SampleVisibleWavelengths，pdf正比于可见光范围内的亮度响应
+template <std::floating_point T>
+constexpr T visible_wavelength_pdf(T lambda)
+{
+    if(lambda < static_cast<T>(LAMBDA_MIN) || lambda > static_cast<T>(LAMBDA_MAX)) return ZERO<T>;
+    const T e = exp(static_cast<T>(0.0072) * (lambda - 538));
+    const T cosh = (e + 1 / e) / 2;
+    return static_cast<T>(0.0039398042) / (cosh * cosh);
+}
+
+template <std::floating_point T>
+T sample_visible_wavelength(T u)
+{
+    return static_cast<T>(538) - static_cast<T>(138.888889) * std::atanh(static_cast<T>(0.85691062) - static_cast<T>(1.82750197) * u);
+}
+
+NAMESPACE_END(Spectrum)
+
+// 一条路径携带的N个波长和各自的pdf
+// 第一个是hero wavelength，其余的在波长范围内等间隔错开
+template <std::floating_point T, usize N>
+    requires spectrum_width<N>
+struct SampledWavelengths
+{
+    SampledSpectrum<T, N> lambda, pdf;
+
+    static constexpr SampledWavelengths sample_uniform(T u, T lambda_min = LAMBDA_MIN, T lambda_max = LAMBDA_MAX)
+    {
+        SampledWavelengths ret;
+        const T range = lambda_max - lambda_min;
+        ret.lambda[0] = lerp(lambda_min, lambda_max, u);
+        const T delta = range / N;
+        for(usize i = 1; i < N; i++)
+        {
+            const T l = ret.lambda[i - 1] + delta;
+            ret.lambda[i] = l > lambda_max ? l - range : l;
+        }
+        ret.pdf = SampledSpectrum<T, N>(ONE<T> / range);
+        return ret;
+    }
+
+    // 按亮度响应重要性采样，噪声比均匀采样小
+    static SampledWavelengths sample_visible(T u)
+    {
+        SampledWavelengths ret;
+        for(usize i = 0; i < N; i++)
+        {
+            T up = u + static_cast<T>(i) / N;
+            up = up > ONE<T> ? up - ONE<T> : up;
+            ret.lambda[i] = Spectrum::sample_visible_wavelength(up);
+            ret.pdf[i] = Spectrum::visible_wavelength_pdf(ret.lambda[i]);
+        }
+        return ret;
+    }
+
+    // 折射率随波长变化(色散)时只保留hero wavelength
+    constexpr void terminate_secondary()
+    {
+        if(secondary_terminated()) return;
+        for(usize i = 1; i < N; i++) pdf[i] = 0;
+        pdf[0] /= N;
+    }
+
+    constexpr bool secondary_terminated() const
+    {
+        bool ret = true;
+        for(usize i = 1; i < N; i++) ret &= is_zero(pdf[i]);
+        return ret;
+    }
+};
+
+// 蒙特卡洛估计∫S(λ)X(λ)dλ / ∫Y(λ)dλ，pdf为0的波长不参与
+template <std::floating_point T, usize N>
+constexpr Vector3<T> to_xyz(const SampledSpectrum<T, N>& s, const SampledWavelengths<T, N>& w)
+{
+    SampledSpectrum<T, N> x, y, z;
+    for(usize i = 0; i < N; i++)
+    {
+        x[i] = Spectrum::lookup(Spectrum::CIE_X, w.lambda[i]);
+        y[i] = Spectrum::lookup(Spectrum::CIE_Y, w.lambda[i]);
+        z[i] = Spectrum::lookup(Spectrum::CIE_Z, w.lambda[i]);
+    }
+    const SampledSpectrum<T, N> v = safe_div(s, w.pdf);
+    const T scale = ONE<T> / static_cast<T>(Spectrum::CIE_Y_INTEGRAL);
+    return Vector3<T>{(x * v).average(), (y * v).average(), (z * v).average()} * scale;
+}
+
+// 线性sRGB(D65)
+template <std::floating_point T>
+constexpr Vector3<T> xyz_to_rgb(const Vector3<T>& xyz)
+{
+    return {static_cast<T>( 3.2404542) * xyz.x + static_cast<T>(-1.5371385) * xyz.y + static_cast<T>(-0.4985314) * xyz.z,
+            static_cast<T>(-0.9692660) * xyz.x + static_cast<T>( 1.8760108) * xyz.y + static_cast<T>( 0.0415560) * xyz.z,
+            static_cast<T>( 0.0556434) * xyz.x + static_cast<T>(-0.2040259) * xyz.y + static_cast<T>( 1.0572252) * xyz.z};
+}
+
+template <std::floating_point T>
+constexpr Vector3<T> rgb_to_xyz(const Vector3<T>& rgb)
+{
+    return {static_cast<T>(0.4124564) * rgb.x + static_cast<T>(0.3575761) * rgb.y + static_cast<T>(0.1804375) * rgb.z,
+            static_cast<T>(0.2126729) * rgb.x + static_cast<T>(0.7151522) * rgb.y + static_cast<T>(0.0721750) * rgb.z,
+            static_cast<T>(0.0193339) * rgb.x + static_cast<T>(0.1191920) * rgb.y + static_cast<T>(0.9503041) * rgb.z};
+}
+
+template <std::floating_point T, usize N>
+constexpr Vector3<T> to_rgb(const SampledSpectrum<T, N>& s, const SampledWavelengths<T, N>& w)
+{
+    return xyz_to_rgb(to_xyz(s, w));
+}
+
+NAMESPACE_BEGIN(Fresnel)
+
+// 每个波长使用各自的折射率，导体在f32时走SSE
+template <std::floating_point T, usize N>
+constexpr SampledSpectrum<T, N> dielectric(T cos_theta_i, const SampledSpectrum<T, N>& eta)
+{
+    return SampledSpectrum<T, N>(dielectric(cos_theta_i, eta.values));
+}
+
+template <std::floating_point T, usize N>
+constexpr SampledSpectrum<T, N> conductor(T cos_theta_i, const SampledSpectrum<T, N>& eta, const SampledSpectrum<T, N>& k)
+{
+    return SampledSpectrum<T, N>(conductor(cos_theta_i, eta.values, k.values));
+}
+
+NAMESPACE_END(Fresnel)
+
+NAMESPACE_END(Hinae)
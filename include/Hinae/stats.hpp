@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <iostream>
+#include <type_traits>
+
+#ifdef USE_STATS
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+#include "basic_type.hpp"
+
+// 统计光线与包围盒/图元的求交次数、遍历的节点数和批量函数处理的元素数
+// 默认编译成空函数，定义USE_STATS后才计数
+// 每个线程写自己独占缓存行的槽位，计数不需要原子读改写，也不会和其他线程争抢同一缓存行
+
+NAMESPACE_BEGIN(Hinae)
+
+enum class Stat
+{
+    RayBoxTests,        // Bounds3::intersect
+    RayBoxHits,
+    Traversals,         // 加速结构的查询次数
+    NodeVisits,
+    PrimitiveTests,     // 光线与图元求交
+    TransformedBounds,  // 批量变换包围盒
+    SampledPoints,      // 批量采样
+    Count
+};
+
+// 按2的幂分桶：第0个桶是0，第k个桶是[2^(k-1), 2^k)，最后一个桶收集更大的值
+enum class Histogram
+{
+    NodesPerTraversal,
+    PrimitivesPerTraversal,
+    BatchSize,
+    Count
+};
+
+NAMESPACE_BEGIN(Stats)
+
+inline constexpr bool ENABLED =
+#ifdef USE_STATS
+    true;
+#else
+    false;
+#endif
+
+inline constexpr usize STAT_COUNT = static_cast<usize>(Stat::Count);
+inline constexpr usize HISTOGRAM_COUNT = static_cast<usize>(Histogram::Count);
+inline constexpr usize BUCKET_COUNT = 32;
+
+inline constexpr const char* STAT_NAMES[STAT_COUNT] =
+{
+    "ray_box_tests", "ray_box_hits", "traversals", "node_visits", "primitive_tests", "transformed_bounds", "sampled_points"
+};
+
+inline constexpr const char* HISTOGRAM_NAMES[HISTOGRAM_COUNT] =
+{
+    "nodes_per_traversal", "primitives_per_traversal", "batch_size"
+};
+
+constexpr usize bucket(std::uint64_t value)
+{
+    return std::min<usize>(std::bit_width(value), BUCKET_COUNT - 1);
+}
+
+// 第i个桶的下界
+constexpr std::uint64_t bucket_floor(usize i) { return i == 0 ? 0 : std::uint64_t(1) << (i - 1); }
+
+// 所有线程合计的结果
+struct Snapshot
+{
+    std::array<std::uint64_t, STAT_COUNT> counters{};
+    std::array<std::array<std::uint64_t, BUCKET_COUNT>, HISTOGRAM_COUNT> histograms{};
+
+    constexpr std::uint64_t operator [] (Stat s) const { return counters[static_cast<usize>(s)]; }
+    constexpr const auto& operator [] (Histogram h) const { return histograms[static_cast<usize>(h)]; }
+
+    // 直方图的样本总数
+    constexpr std::uint64_t total(Histogram h) const
+    {
+        std::uint64_t ret = 0;
+        for(std::uint64_t n : (*this)[h]) ret += n;
+        return ret;
+    }
+};
+
+#ifdef USE_STATS
+
+// 一个线程的全部计数，独占整数个缓存行
+// 只有所属线程会写，relaxed的load+store在x86/ARM上就是普通的读写，汇总时其他线程可以无数据竞争地读取
+struct alignas(CACHE_LINE) Slot
+{
+    std::array<std::atomic<std::uint64_t>, STAT_COUNT> counters{};
+    std::array<std::array<std::atomic<std::uint64_t>, BUCKET_COUNT>, HISTOGRAM_COUNT> histograms{};
+
+    static void bump(std::atomic<std::uint64_t>& c, std::uint64_t n)
+    {
+        c.store(c.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+};
+
+static_assert(sizeof(Slot) % CACHE_LINE == 0);
+
+// 槽位只增不减：线程退出时把槽位放回空闲列表，计数保留给之后的线程继续累加
+class Registry
+{
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Slot>> slots;
+    std::vector<Slot*> free;
+
+public:
+    static Registry& instance()
+    {
+        static Registry registry;
+        return registry;
+    }
+
+    Slot* acquire()
+    {
+        std::lock_guard lock(mutex);
+        if(!free.empty())
+        {
+            Slot* ret = free.back();
+            free.pop_back();
+            return ret;
+        }
+        return slots.emplace_back(std::make_unique<Slot>()).get();
+    }
+
+    void release(Slot* slot)
+    {
+        std::lock_guard lock(mutex);
+        free.push_back(slot);
+    }
+
+    template <typename F>
+    void for_each(F&& f)
+    {
+        std::lock_guard lock(mutex);
+        for(const auto& s : slots) f(*s);
+    }
+};
+
+struct LocalSlot
+{
+    Slot* slot = Registry::instance().acquire();
+    ~LocalSlot() { Registry::instance().release(slot); }
+};
+
+inline Slot& local()
+{
+    thread_local LocalSlot local;
+    return *local.slot;
+}
+
+#endif
+
+template <Stat S>
+constexpr void count([[maybe_unused]] std::uint64_t n = 1)
+{
+#ifdef USE_STATS
+    if(!std::is_constant_evaluated())
+        Slot::bump(local().counters[static_cast<usize>(S)], n);
+#endif
+}
+
+template <Histogram H>
+constexpr void record([[maybe_unused]] std::uint64_t value)
+{
+#ifdef USE_STATS
+    if(!std::is_constant_evaluated())
+        Slot::bump(local().histograms[static_cast<usize>(H)][bucket(value)], 1);
+#endif
+}
+
+// 批量函数的入口调用一次，同时记录批大小的分布
+template <Stat S>
+constexpr void batch(std::uint64_t n)
+{
+    count<S>(n);
+    record<Histogram::BatchSize>(n);
+}
+
+// 汇总所有线程(包括已经退出的线程)的计数，只在读取时遍历各线程的槽位
+inline Snapshot snapshot()
+{
+    Snapshot ret;
+#ifdef USE_STATS
+    Registry::instance().for_each([&](const Slot& s)
+    {
+        for(usize i = 0; i < STAT_COUNT; i++)
+            ret.counters[i] += s.counters[i].load(std::memory_order_relaxed);
+        for(usize h = 0; h < HISTOGRAM_COUNT; h++)
+            for(usize b = 0; b < BUCKET_COUNT; b++)
+                ret.histograms[h][b] += s.histograms[h][b].load(std::memory_order_relaxed);
+    });
+#endif
+    return ret;
+}
+
+// 清零所有计数，应该在没有线程计数时调用(例如两帧之间)
+inline void reset()
+{
+#ifdef USE_STATS
+    Registry::instance().for_each([](Slot& s)
+    {
+        for(auto& c : s.counters) c.store(0, std::memory_order_relaxed);
+        for(auto& h : s.histograms)
+            for(auto& c : h) c.store(0, std::memory_order_relaxed);
+    });
+#endif
+}
+
+// 每行一条记录：counter,名字,值 或 histogram,名字,桶下界,数量，空桶不输出
+inline void export_csv(std::ostream& os, const Snapshot& s)
+{
+    os << "kind,name,bucket,value\n";
+    for(usize i = 0; i < STAT_COUNT; i++)
+        os << "counter," << STAT_NAMES[i] << ",," << s.counters[i] << '\n';
+    for(usize h = 0; h < HISTOGRAM_COUNT; h++)
+        for(usize b = 0; b < BUCKET_COUNT; b++)
+            if(s.histograms[h][b] != 0)
+                os << "histogram," << HISTOGRAM_NAMES[h] << ',' << bucket_floor(b) << ',' << s.histograms[h][b] << '\n';
+}
+
+NAMESPACE_END(Stats)
+
+inline std::ostream& operator << (std::ostream& os, const Stats::Snapshot& s)
+{
+    for(usize i = 0; i < Stats::STAT_COUNT; i++)
+        os << Stats::STAT_NAMES[i] << ": " << s.counters[i] << '\n';
+    for(usize h = 0; h < Stats::HISTOGRAM_COUNT; h++)
+    {
+        const std::uint64_t total = s.total(static_cast<Histogram>(h));
+        if(total == 0) continue;
+        os << Stats::HISTOGRAM_NAMES[h] << ":\n";
+        for(usize b = 0; b < Stats::BUCKET_COUNT; b++)
+            if(s.histograms[h][b] != 0)
+                os << "  >= " << Stats::bucket_floor(b) << ": " << s.histograms[h][b] << '\n';
+    }
+    return os;
+}
+
+NAMESPACE_END(Hinae)
@@ -14,6 +14,34 @@
 #include <Hinae/Ray3.hpp>
 
 #include <Hinae/Trigonometric.hpp>
+#include <Hinae/physics.hpp>
+#include <Hinae/equation.hpp>
+#include <Hinae/intersection.hpp>
+#include <Hinae/fresnel_table.hpp>
+#include <Hinae/spectrum.hpp>
+#include <Hinae/rng.hpp>
+#include <Hinae/counter_rng.hpp>
+#include <Hinae/low_discrepancy.hpp>
+#include <Hinae/sampling.hpp>
+#include <Hinae/microfacet.hpp>
+#include <Hinae/distribution.hpp>
+#include <Hinae/sample_table.hpp>
+#include <Hinae/coordinate_system.hpp>
+#include <Hinae/octahedral.hpp>
+#include <Hinae/f16.hpp>
+#include <Hinae/quantize.hpp>
+#include <Hinae/stats.hpp>
+#include <Hinae/parallel.hpp>
+#include <Hinae/allocator.hpp>
+#include <Hinae/bvh.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <atomic>
+#include <numeric>
+#include <sstream>
+#include <thread>
+#include <vector>
 
 #include "tools.hpp"
 
@@ -40,7 +68,7 @@ static void base_test()
 	static_assert(is_even(1)  == false);
 	static_assert(is_even(-1) == false);
 
-	// 浮点数请用 std::abs
+	// 浮点数请用 Hinae::fabs
 	static_assert(Hinae::abs(1)  == 1);
 	static_assert(Hinae::abs(-1) == 1);
 
@@ -70,6 +98,10 @@ static void base_test()
 	static_assert(to_degree(PI<double>) == 180.0);
 	static_assert(to_radian(180.0)      == PI<double>);
 
+	static_assert(Hinae::fabs(-1.5) == 1.5);
+	static_assert(std::bit_cast<std::uint64_t>(Hinae::fabs(-0.0)) == 0);
+	EXPECT_EQ(0u, std::bit_cast<std::uint32_t>(Hinae::fabs(-0.0f)));
+
 	static_assert(pow2(2) == 4);
 	static_assert(pow4(2) == 16);
 	static_assert(pow5(2) == 32);
@@ -350,6 +382,55 @@ static void bounds3_test()
 	static_assert(overlaps(b2, b3) == true);
 }
 
+static void bounds3_transform_test()
+{
+	constexpr Bounds3d b{Point3d{-1, 0, 2}, Point3d{1, 3, 4}};
+
+	{
+		constexpr auto m = Transform<f64>::translate({1, 2, 3}) * Transform<f64>::scale(2, -1, 1);
+		static_assert(is_affine(m));
+		static_assert(m * b == Bounds3d{Point3d{-1, -1, 5}, Point3d{3, 2, 7}});
+		static_assert(Affine3<f64>{m} * b == m * b);
+		static_assert(Affine3<f64>{m}.matrix() == m);
+	}
+
+	{
+		constexpr auto m = Transform<f64>::perspective(90, 1, 1, 10);
+		static_assert(!is_affine(m));
+		constexpr Bounds3d front{Point3d{-1, -1, -4}, Point3d{1, 1, -2}};
+		constexpr auto p = m * front;
+		static_assert(Hinae::fabs(p.p_min.x + 0.5) < 1e-15 && Hinae::fabs(p.p_max.x - 0.5) < 1e-15);
+		static_assert(Hinae::fabs(p.p_min.y + 0.5) < 1e-15 && Hinae::fabs(p.p_max.y - 0.5) < 1e-15);
+		for(usize i = 0; i < 8; i++)
+		{
+			const Point3d corner{front[i & 1].x, front[(i >> 1) & 1].y, front[i >> 2].z};
+			EXPECT_TRUE(p.inside(m * corner));
+		}
+		// 跨过相机平面的包围盒投影后无界
+		constexpr auto crossing = m * Bounds3d{Point3d{-1, -1, -4}, Point3d{1, 1, 1}};
+		static_assert(crossing.p_min.x == -INFINITY_<f64> && crossing.p_max.z == INFINITY_<f64>);
+	}
+
+	{
+		const auto m = Transform<f32>::translate({1, -2, 0.5f})
+		             * Transform<f32>::rotate<Axis::Y>(30)
+		             * Transform<f32>::scale(1, 2, 3);
+		// 个数不是4的倍数，覆盖批量版本的尾部
+		std::vector<Bounds3f> boxes, result(103);
+		for(usize i = 0; i < result.size(); i++)
+			boxes.emplace_back(Point3f{-0.1f * i, 1, 2}, Point3f{0.5f * i, 2 - 0.1f * i, -3});
+		transform(m, std::span<const Bounds3f>{boxes}, std::span{result});
+		usize same = 0;
+		for(usize i = 0; i < result.size(); i++)
+		{
+			const auto expect = Affine3<f32>{m} * boxes[i];
+			if(expect.p_min == result[i].p_min && expect.p_max == result[i].p_max)
+				same++;
+		}
+		EXPECT_EQ(result.size(), same);
+	}
+}
+
 static void ray3_test()
 {
 	constexpr Ray3 ray{Point3{0, 0, 0}, Vector3{1, 2, 3}};
@@ -392,6 +473,53 @@ static void quaternion_test()
 	static_assert(q2 * q1 == Quaternion{-60, 20, 14, 32});
 }
 
+static void constexpr_math_test()
+{
+	static_assert(Hinae::sqrt(4.0)  == 2.0);
+	static_assert(Hinae::sqrt(0.0)  == 0.0);
+	static_assert(Hinae::sqrt(2.0)  == SQRT2<f64>);
+	static_assert(Hinae::sqrt(2.0f) == SQRT2<f32>);
+	static_assert(Hinae::fabs(Hinae::sqrt(1e-310) - 1e-155) < 1e-168);
+
+	static_assert(Hinae::sin(0.0) == 0.0);
+	static_assert(Hinae::cos(0.0) == 1.0);
+	static_assert(Hinae::fabs(Hinae::sin(PI_OVER_2<f64>) - 1.0) < 1e-15);
+	static_assert(Hinae::fabs(Hinae::cos(PI<f64>) + 1.0) < 1e-15);
+	static_assert(Hinae::fabs(Hinae::tan(PI_OVER_4<f64>) - 1.0) < 1e-15);
+	static_assert(Hinae::fabs(Hinae::sin(100.0) - (-0.50636564110975879)) < 1e-13);
+	// 商超出int64的大参数
+	static_assert(Hinae::fabs(Constexpr::reduce_radian(1e30L)) <= PI<long double>);
+	static_assert(Hinae::fabs(Constexpr::reduce_radian(-1e300L)) <= PI<long double>);
+	static_assert(Hinae::fabs(Hinae::sin(1e20)) <= 1.0);
+
+	for(f64 x = -10; x <= 10; x += 0.37)
+	{
+		EXPECT_NEAR(std::sin(x), Constexpr::sin(x), 1e-14);
+		EXPECT_NEAR(std::cos(x), Constexpr::cos(x), 1e-14);
+		EXPECT_NEAR(std::tan(x), Constexpr::tan(x), 1e-12 * std::max(1.0, std::abs(std::tan(x))));
+		EXPECT_NEAR(std::sqrt(std::abs(x) * 1e7), Constexpr::sqrt(std::abs(x) * 1e7), 1e-10);
+	}
+
+	{
+		constexpr auto m = Transform<f64>::rotate<Axis::Z>(90.0);
+		constexpr auto v = m * Vector3d{1, 0, 0};
+		static_assert(Hinae::fabs(v.x) < 1e-15 && Hinae::fabs(v.y - 1) < 1e-15);
+
+		constexpr auto p = Transform<f32>::perspective(90, 1, 0.1f, 100);
+		static_assert(Hinae::fabs(p[0][0] - 1) < 1e-6f);
+		static_assert(p * Matrix4f::identity() == p);
+
+		constexpr auto q = Quaterniond::rotate(PI_OVER_2<f64>, {0, 1, 0});
+		static_assert(Hinae::fabs(q.norm() - 1) < 1e-15);
+
+		static_assert(Vector3d{3, 4, 0}.norm() == 5);
+		static_assert(Hinae::fabs(Vector3d{3, 4, 0}.normalized().norm() - 1) < 1e-15);
+
+		constexpr auto frame = local_coordinate_system(Vector3d{0, 0, 1});
+		static_assert(std::get<0>(frame) == Vector3d{0, 1, -0});
+	}
+}
+
 static void trigonometric_test()
 {
 	static_assert(sin_to_cos2(1) == 0);
@@ -419,6 +547,1781 @@ static void trigonometric_test()
 		EXPECT_EQ(0, cos_to_sin(1));
 		EXPECT_EQ(value, cos_to_sin(0.5));
 	}
+
+	// LocalDirection与Local::中的函数结果一致
+	{
+		const auto same = [](const Vector3d& w)
+		{
+			const LocalDirection<f64> d{w};
+			const auto near = [](f64 a, f64 b) { return std::abs(a - b) <= 1e-15 * max(1.0, std::abs(a)); };
+			return near(Local::cos_theta(w), d.cos_theta()) && near(Local::cos2_theta(w), Local::cos2_theta(d))
+			    && near(Local::abs_cos_theta(w), d.abs_cos_theta()) && near(Local::sin_theta(w), d.sin_theta())
+			    && near(Local::sin2_theta(w), d.sin2_theta()) && near(Local::tan_theta(w), d.tan_theta())
+			    && near(Local::tan2_theta(w), d.tan2_theta()) && near(Local::cos_phi(w), Local::cos_phi(d))
+			    && near(Local::sin_phi(w), d.sin_phi()) && near(Local::cos2_phi(w), d.cos2_phi())
+			    && near(Local::sin2_phi(w), d.sin2_phi());
+		};
+		EXPECT_TRUE(same(Vector3d{0.3, -0.4, 0.5}.normalized()));
+		EXPECT_TRUE(same(Vector3d{-0.8, 0.1, -0.2}.normalized()));
+		EXPECT_TRUE(same(Vector3d{0, 0, 1}));
+
+		// 与std::abs一样，-0的绝对值是+0
+		static_assert(std::bit_cast<std::uint64_t>(Local::abs_cos_theta(Vector3d{1, 0, -0.0})) == 0);
+		static_assert(std::bit_cast<std::uint64_t>(LocalDirection<f64>{Vector3d{1, 0, -0.0}}.abs_cos_theta()) == 0);
+
+		constexpr LocalDirection<f64> d{Vector3d{0.6, 0, 0.8}};
+		static_assert(d.cos_phi() == 1 && d.sin_phi() == 0);
+
+		const std::vector<Vector3d> w{Vector3d{0, 1, 0}, Vector3d{0.6, 0, 0.8}};
+		std::vector<LocalDirection<f64>> out(w.size());
+		make_local_directions<f64>(w, out);
+		EXPECT_EQ(1.0, out[0].sin_phi());
+		EXPECT_NEAR(0.36, out[1].sin2_theta(), 1e-15);
+
+		std::vector<f64> x{0.0, 0.6}, y{1.0, 0.0}, z{0.0, 0.8};
+		make_local_directions(Vector3SoA<const f64>{Vector3SoA<f64>{x, y, z}}, std::span{out});
+		EXPECT_EQ(w[1], out[1].direction());
+	}
+}
+
+static void coordinate_system_test()
+{
+	const Vector3f normals[]
+	{
+		{0, 0, 1}, {0, 0, -1}, {1, 0, 0}, {0, -1, 0},
+		Vector3f{1, 2, 3}.normalized(), Vector3f{-3, 1, -0.001f}.normalized()
+	};
+
+	for(const auto& n : normals)
+	{
+		const auto [t, b] = branchless_coordinate_system(n);
+		EXPECT_NEAR(1.0f, t.norm(), 1e-6f);
+		EXPECT_NEAR(1.0f, b.norm(), 1e-6f);
+		EXPECT_NEAR(0.0f, dot(t, n), 1e-6f);
+		EXPECT_NEAR(0.0f, dot(b, n), 1e-6f);
+		EXPECT_NEAR(0.0f, dot(t, b), 1e-6f);
+		EXPECT_NEAR(0.0f, distance(as<Point3, f32>(cross(t, b)), as<Point3, f32>(n)), 1e-6f);
+	}
+
+	{
+		constexpr usize size = std::size(normals);
+		f32 data[9][size];
+		for(usize i = 0; i < size; i++)
+		{
+			data[0][i] = normals[i].x;
+			data[1][i] = normals[i].y;
+			data[2][i] = normals[i].z;
+		}
+		const Vector3SoA<const f32> n{data[0], data[1], data[2]};
+		const Vector3SoA<f32> t{data[3], data[4], data[5]};
+		const Vector3SoA<f32> b{data[6], data[7], data[8]};
+		branchless_coordinate_system(n, t, b);
+		for(usize i = 0; i < size; i++)
+		{
+			const auto [t1, b1] = branchless_coordinate_system(normals[i]);
+			EXPECT_EQ(t1, t[i]);
+			EXPECT_EQ(b1, b[i]);
+		}
+	}
+}
+
+static void f16_test()
+{
+	static_assert(sizeof(Vector3h) == 6);
+	// f16只用于存储，不参与arithmetic的模板
+	static_assert(storage<f16> && !arithmetic<f16>);
+	static_assert(f16{1.0f}.bits == 0x3c00);
+	static_assert(f16{-2.0f}.bits == 0xc000);
+	static_assert(f16{65504.0f}.bits == 0x7bff);
+	static_assert(f16{65520.0f}.bits == 0x7c00);
+	static_assert(f16{5.9604645e-8f}.bits == 0x0001);
+	static_assert(f16{2.9802322e-8f}.bits == 0x0000);
+	static_assert(f16{1.0f + 1.0f / 2048}.bits == 0x3c00);
+	static_assert(f16{1.0f + 3.0f / 2048}.bits == 0x3c02);
+	static_assert(static_cast<f32>(f16::from_bits(0x0001)) == 5.9604645e-8f);
+	static_assert(static_cast<f32>(f16::from_bits(0x3555)) == 0.333251953125f);
+	static_assert(static_cast<f32>(f16{INFINITY_<f32>}) == INFINITY_<f32>);
+	EXPECT_TRUE(std::isnan(static_cast<f32>(f16{std::numeric_limits<f32>::quiet_NaN()})));
+
+	// 所有有限半精度数往返转换都应该精确
+	usize exact = 0;
+	for(std::uint32_t i = 0; i < 0x10000; i++)
+	{
+		const auto h = f16::from_bits(static_cast<std::uint16_t>(i));
+		if((i & 0x7c00) != 0x7c00 && f16{static_cast<f32>(h)}.bits == h.bits) exact++;
+	}
+	EXPECT_EQ(usize{0x10000 - 2 * 0x400}, exact);
+
+	constexpr Vector3h v{1, 2, 3};
+	static_assert(v + Vector3h{1} == Vector3h{2, 3, 4});
+	static_assert(v * f16{0.5f} == Vector3h{0.5f, 1, 1.5f});
+	static_assert(Vector3f{v} == Vector3f{1, 2, 3});
+	static_assert(Point3f{Point3h{1, 2, 3}} == Point3f{1, 2, 3});
+
+	std::vector<Vector3f> src(37);
+	for(usize i = 0; i < src.size(); i++)
+		src[i] = Vector3f{0.1f * i, -1.0f / (i + 1), 1000.0f + i};
+	std::vector<Vector3h> half(src.size());
+	std::vector<Vector3f> dst(src.size());
+	to_f16<Vector3>(std::span<const Vector3f>{src}, std::span<Vector3h>{half});
+	to_f32<Vector3>(std::span<const Vector3h>{half}, std::span<Vector3f>{dst});
+	for(usize i = 0; i < src.size(); i++)
+	{
+		EXPECT_EQ(Vector3h{src[i]}, half[i]);
+		EXPECT_EQ(Vector3f{half[i]}, dst[i]);
+	}
+}
+
+static void octahedral_test()
+{
+	static_assert(octahedral_decode<f64>(octahedral_encode<std::uint32_t>(Vector3d{0, 0, 1})).z > 1 - 1e-9);
+
+	f32 max_error32 = 0, max_error16 = 0, max_error16_precise = 0;
+	std::vector<f32> xs, ys, zs;
+	for(f32 theta = 0; theta <= PI<f32>; theta += 0.05f)
+	{
+		for(f32 phi = 0; phi < 2 * PI<f32>; phi += 0.05f)
+		{
+			const Vector3f n{std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta)};
+			const auto angle = [&n](const Vector3f& v) { return (n - v).norm(); };
+			max_error32 = std::max(max_error32, angle(octahedral_decode<f32>(octahedral_encode<std::uint32_t>(n))));
+			max_error16 = std::max(max_error16, angle(octahedral_decode<f32>(octahedral_encode<std::uint16_t>(n))));
+			max_error16_precise = std::max(max_error16_precise,
+				angle(octahedral_decode<f32>(octahedral_encode<std::uint16_t, true>(n))));
+			xs.push_back(n.x);
+			ys.push_back(n.y);
+			zs.push_back(n.z);
+		}
+	}
+	EXPECT_TRUE(max_error32 < 1e-4f);
+	EXPECT_TRUE(max_error16 < 2e-2f);
+	EXPECT_TRUE(max_error16_precise <= max_error16);
+
+	std::vector<std::uint32_t> codes(xs.size());
+	octahedral_encode<std::uint32_t>(Vector3SoA<const f32>{xs, ys, zs}, std::span{codes});
+	std::vector<f32> dx(xs.size()), dy(xs.size()), dz(xs.size());
+	octahedral_decode<f32>(std::span<const std::uint32_t>{codes}, Vector3SoA<f32>{dx, dy, dz});
+	usize same = 0;
+	for(usize i = 0; i < xs.size(); i++)
+	{
+		const Vector3f n{xs[i], ys[i], zs[i]};
+		if(codes[i] == octahedral_encode<std::uint32_t>(n) && distance(Point3f{dx[i], dy[i], dz[i]},
+			as<Point3, f32>(octahedral_decode<f32>(codes[i]))) < 1e-6f) same++;
+	}
+	EXPECT_EQ(xs.size(), same);
+}
+
+static void quantize_test()
+{
+	constexpr Bounds3f scene{Point3f{-10, 0, 5}, Point3f{10, 1, 5}};
+	constexpr Quantizer3<f32, std::uint16_t> q16{scene};
+
+	static_assert(q16.quantize(Point3f{-10, 0, 5}) == Point3<std::uint16_t>{0, 0, 0});
+	static_assert(q16.quantize(Point3f{10, 1, 5})  == Point3<std::uint16_t>{65535, 65535, 0});
+	static_assert(q16.quantize(Point3f{100, -1, 7}) == Point3<std::uint16_t>{65535, 0, 0});
+	static_assert(Quantizer3<f32, std::uint32_t>::MAX_Q == (1u << 24) - 1);
+	static_assert(Quantizer3<f64, std::uint32_t>::MAX_Q == MAX_NUMBER<std::uint32_t>);
+
+	// 范围顶端的点不会超出MAX_Q
+	{
+		constexpr Quantizer3<f32, std::uint32_t> top{scene};
+		static_assert(top.quantize(Point3f{10, 1, 5}) == Point3<std::uint32_t>{top.MAX_Q, top.MAX_Q, 0});
+		static_assert(top.quantize(Point3f{100, 2, 5}) == Point3<std::uint32_t>{top.MAX_Q, top.MAX_Q, 0});
+		static_assert(top.quantize_nearest(9.999999f, 0) == top.MAX_Q);
+		constexpr Quantizer3<f64, std::uint32_t> top64{Bounds3d{Point3d{-10, 0, 5}, Point3d{10, 1, 5}}};
+		static_assert(top64.quantize(Point3d{10, 1, 5}) == Point3<std::uint32_t>{top64.MAX_Q, top64.MAX_Q, 0});
+	}
+
+	Quantizer3<f32, std::uint32_t> q32{scene};
+	usize conservative = 0, nearest = 0, count = 0;
+	RNG<f32> rng{7};
+	for(usize i = 0; i < 1000; i++, count++)
+	{
+		const Point3f p1{rng.get() * 20 - 10, rng.get(), 5};
+		const Point3f p2{rng.get() * 20 - 10, rng.get(), 5};
+		const Bounds3f b{p1, p2};
+		if(contains(q16.dequantize(q16.quantize(b)), b) && contains(q32.dequantize(q32.quantize(b)), b))
+			conservative++;
+		const auto d = q16.dequantize(q16.quantize(p1)) - p1;
+		if(std::abs(d.x) <= q16.scale.x / 2 * 1.001f && std::abs(d.y) <= q16.scale.y / 2 * 1.001f && d.z == 0)
+			nearest++;
+	}
+	EXPECT_EQ(count, conservative);
+	EXPECT_EQ(count, nearest);
+
+	{
+		const Bounds3f b1{Point3f{-5, 0.2f, 5}, Point3f{0, 0.4f, 5}};
+		const Bounds3f b2{Point3f{-1, 0.3f, 5}, Point3f{-0.5f, 0.35f, 5}};
+		const Bounds3f b3{Point3f{1, 0.3f, 5}, Point3f{2, 0.35f, 5}};
+		const auto qb1 = q16.quantize(b1), qb2 = q16.quantize(b2), qb3 = q16.quantize(b3);
+		EXPECT_TRUE(contains(qb1, qb2));
+		EXPECT_TRUE(overlaps(qb1, qb2));
+		EXPECT_TRUE(!overlaps(qb1, qb3));
+		EXPECT_TRUE(!contains(qb1, qb3));
+	}
+
+	{
+		const Bounds3f boxes[]{scene, Bounds3f{Point3f{0, 0.5f, 5}}, Bounds3f{Point3f{-3, 0, 5}, Point3f{3, 0.25f, 5}}};
+		Bounds3<std::uint16_t> quantized[3];
+		Bounds3f restored[3];
+		q16.quantize(std::span<const Bounds3f>{boxes}, std::span{quantized});
+		q16.dequantize(std::span<const Bounds3<std::uint16_t>>{quantized}, std::span{restored});
+		for(usize i = 0; i < 3; i++)
+		{
+			EXPECT_EQ(q16.quantize(boxes[i]), quantized[i]);
+			EXPECT_TRUE(contains(restored[i], boxes[i]));
+		}
+	}
+
+	// 远离原点的小场景：余量有上千格，向外取整的结果不超过两倍余量
+	{
+		const Quantizer3<f32, std::uint32_t> far{Bounds3f{Point3f{1000, 1000, 1000}, Point3f{1001, 1001, 1001}}};
+		const f32 margin = 2 * static_cast<f32>(far.slack_cells(1001, 0)) + 2;
+		EXPECT_TRUE(far.slack_cells(1001, 0) > 1000);
+		bool tight = true, contained = true;
+		for(usize i = 0; i < 200; i++)
+		{
+			const f32 lo = 1000 + rng.get() * 0.5f, hi = lo + rng.get() * 0.5f;
+			const Bounds3f b{Point3f{lo, lo, lo}, Point3f{hi, hi, hi}};
+			const auto qb = far.quantize(b);
+			contained = contained && contains(far.dequantize(qb), b);
+			tight = tight && static_cast<f32>(qb.p_min.x) >= (lo - 1000) * far.inv_scale.x - margin
+			              && static_cast<f32>(qb.p_max.x) <= (hi - 1000) * far.inv_scale.x + margin;
+		}
+		EXPECT_TRUE(contained);
+		EXPECT_TRUE(tight);
+	}
+}
+
+static void pcg_test()
+{
+	{
+		// pcg32-demo中seed = 42, stream = 54的输出
+		PCG32 rng{42, 54};
+		constexpr std::uint32_t expect[]{0xa15c02b7, 0x7b47f409, 0xba1d3330, 0x83d2f293, 0xbfa4784b, 0xcbed606e};
+		for(auto x : expect)
+			EXPECT_EQ(x, rng.next());
+
+		// 64位输出先取高32位，与编译器无关
+		PCG32 wide{42, 54};
+		EXPECT_EQ(0.6303102205231708, wide.get<f64>());
+		EXPECT_EQ(0xba1d333083d2f293ull, wide.get<std::uint64_t>());
+		static_assert(PCG32{42, 54}.get<f64>() == 0.6303102205231708);
+
+		// 整数只接受定长类型，32位一次、64位两次，与平台无关
+		PCG32 narrow{42, 54};
+		EXPECT_EQ(0xa15c02b7u, narrow.get<std::uint32_t>());
+		EXPECT_EQ(0x7b47f409u, narrow.get<std::uint32_t>());
+		static_assert(PCG64{1, 2}.get<std::uint32_t>() == static_cast<std::uint32_t>(PCG64{1, 2}.next()));
+	}
+
+	{
+		PCG32 a{1234, 7}, b{1234, 7}, c{1234, 8};
+		for(usize i = 0; i < 1000; i++) a.next();
+		b.advance(1000);
+		EXPECT_TRUE(a == b);
+		b.advance(-1000);
+		EXPECT_TRUE(b == PCG32(1234, 7));
+		EXPECT_TRUE(PCG32(1234, 7).next() != c.next());
+	}
+
+	{
+		PCG64 a{1234, 7}, b{1234, 7};
+		for(usize i = 0; i < 1000; i++) a.next();
+		b.advance(1000);
+		EXPECT_TRUE(a == b);
+		b.advance(-1000);
+		EXPECT_TRUE(b == PCG64(1234, 7));
+		EXPECT_TRUE(PCG64(1, 2).next() != PCG64(1, 3).next());
+	}
+
+	{
+		static_assert(bits_to_unit_f32(0xffffffff) < 1.0f);
+		static_assert(bits_to_unit_f64(0xffffffffffffffff) < 1.0);
+		PCG32 rng;
+		PCG64 rng64;
+		usize in_range = 0;
+		f64 sum = 0;
+		constexpr usize n = 10000;
+		for(usize i = 0; i < n; i++)
+		{
+			const f32 x = rng.get<f32>();
+			const f64 y = rng64.get<f64>();
+			const auto z = rng.bounded(10);
+			sum += x;
+			if(x >= 0 && x < 1 && y >= 0 && y < 1 && z < 10) in_range++;
+		}
+		EXPECT_EQ(n, in_range);
+		EXPECT_NEAR(0.5, sum / n, 0.02);
+	}
+}
+
+static void xoshiro_test()
+{
+	// 逐lane和标量的xoshiro128+对比
+	const auto scalar_next = [](std::array<std::uint32_t, 4>& s)
+	{
+		const std::uint32_t result = s[0] + s[3];
+		const std::uint32_t t = s[1] << 9;
+		s[2] ^= s[0];
+		s[3] ^= s[1];
+		s[1] ^= s[2];
+		s[0] ^= s[3];
+		s[2] ^= t;
+		s[3] = (s[3] << 11) | (s[3] >> 21);
+		return result;
+	};
+
+	Xoshiro128x8 rng{42};
+	std::array<std::array<std::uint32_t, 4>, Xoshiro128x8::LANES> lanes;
+	for(usize l = 0; l < lanes.size(); l++)
+		lanes[l] = rng.state(l);
+	EXPECT_TRUE(lanes[0] != lanes[1]);
+
+	usize same = 0;
+	for(usize i = 0; i < 100; i++)
+	{
+		const auto block = rng.next();
+		for(usize l = 0; l < lanes.size(); l++)
+			if(block[l] == scalar_next(lanes[l])) same++;
+	}
+	EXPECT_EQ(usize{100 * Xoshiro128x8::LANES}, same);
+
+	{
+		constexpr usize n = 1001;
+		std::vector<f32> x(n), y(n);
+		std::vector<f64> z(n);
+		Xoshiro128x8 a{7}, b{7};
+		a.fill(Point2SoA<f32>{x, y});
+		a.fill(std::span{z});
+
+		const auto first = b.next<f32>();
+		EXPECT_EQ(first[0], x[0]);
+		EXPECT_EQ(first[7], x[7]);
+
+		f64 sum_x = 0, sum_y = 0, sum_z = 0;
+		usize in_range = 0;
+		for(usize i = 0; i < n; i++)
+		{
+			sum_x += x[i];
+			sum_y += y[i];
+			sum_z += z[i];
+			if(x[i] >= 0 && x[i] < 1 && y[i] >= 0 && y[i] < 1 && z[i] >= 0 && z[i] < 1) in_range++;
+		}
+		EXPECT_EQ(n, in_range);
+		EXPECT_NEAR(0.5, sum_x / n, 0.05);
+		EXPECT_NEAR(0.5, sum_y / n, 0.05);
+		EXPECT_NEAR(0.5, sum_z / n, 0.05);
+	}
+}
+
+static void counter_rng_test()
+{
+	// Random123的known answer test
+	static_assert(Philox4x32::eval({0, 0, 0, 0}, {0, 0})
+		== Philox4x32::Counter{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8});
+	static_assert(Philox4x32::eval({0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff}, {0xffffffff, 0xffffffff})
+		== Philox4x32::Counter{0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd});
+	static_assert(Philox4x32::eval({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344}, {0xa4093822, 0x299f31d0})
+		== Philox4x32::Counter{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1});
+
+	constexpr CounterRNG rng{0x1234};
+	static_assert(rng.get<f32>(3, 4, 5) == rng.get<f32>(3, 4, 5));
+	static_assert(rng.get<f32>(3, 4, 5) != rng.get<f32>(3, 4, 6));
+	static_assert(rng.get<std::uint32_t>(3, 4, 5) != CounterRNG{0x1235}.get<std::uint32_t>(3, 4, 5));
+
+	constexpr usize n = 1000;
+	std::vector<f32> samples(n);
+	std::vector<f64> dims(n);
+	rng.fill_samples(7, 100, 2, std::span{samples});
+	rng.fill_dimensions(7, 100, 0, std::span{dims});
+	usize same = 0;
+	f64 sum = 0;
+	for(usize i = 0; i < n; i++)
+	{
+		if(samples[i] == rng.get<f32>(7, static_cast<std::uint32_t>(100 + i), 2)
+		&& dims[i] == rng.get<f64>(7, 100, static_cast<std::uint32_t>(i)))
+			same++;
+		sum += samples[i];
+	}
+	EXPECT_EQ(n, same);
+	EXPECT_NEAR(0.5, sum / n, 0.05);
+
+	// 一个块的4个字依次是连续的4个维度
+	static_assert(CounterRNG{0}.get4<std::uint32_t>(0, 0, 0) == std::array<std::uint32_t, 4>{0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8});
+	static_assert(CounterRNG{0}.get<std::uint64_t>(0, 0, 1) == 0xbc57ac4c9b00dbd8ull);
+	static_assert(CounterRNG::PER_BLOCK<std::uint32_t> == 4 && CounterRNG::PER_BLOCK<f32> == 4);
+	static_assert(CounterRNG::PER_BLOCK<std::uint64_t> == 2 && CounterRNG::PER_BLOCK<f64> == 2);
+
+	// 起点不对齐、长度不是块大小倍数的一段
+	{
+		std::vector<f32> f(13);
+		std::vector<std::uint64_t> u(7);
+		rng.fill_dimensions(7, 100, 3, std::span{f});
+		rng.fill_dimensions(7, 100, 1, std::span{u});
+		bool consistent = true;
+		for(usize i = 0; i < f.size(); i++)
+			consistent = consistent && f[i] == rng.get<f32>(7, 100, static_cast<std::uint32_t>(3 + i));
+		for(usize i = 0; i < u.size(); i++)
+			consistent = consistent && u[i] == rng.get<std::uint64_t>(7, 100, static_cast<std::uint32_t>(1 + i));
+		for(std::uint32_t d = 0; d < 8; d++)
+		{
+			const auto a = rng.get4<f32>(7, 100, d);
+			const auto b = rng.get4<f64>(7, 100, d);
+			for(std::uint32_t k = 0; k < 4; k++)
+				consistent = consistent && a[k] == rng.get<f32>(7, 100, d + k) && b[k] == rng.get<f64>(7, 100, d + k);
+		}
+		EXPECT_TRUE(consistent);
+	}
+}
+
+static void low_discrepancy_test()
+{
+	static_assert(reverse_bits(1) == 0x80000000);
+	static_assert(reverse_bits(0x12345678) == 0x1e6a2c48);
+
+	static_assert(sobol_bits(1, 0) == 0x80000000 && sobol_bits(2, 0) == 0x40000000 && sobol_bits(3, 0) == 0xc0000000);
+	static_assert(sobol_bits(1, 1) == 0x80000000 && sobol_bits(2, 1) == 0xc0000000 && sobol_bits(3, 1) == 0x40000000);
+	static_assert(sobol_bits(4, 2) == 0x60000000);
+
+	// 前2^m个点在每一维上都恰好落在2^m个区间里各一个
+	const auto stratified = [](auto&& sample, usize dims)
+	{
+		for(usize d = 0; d < dims; d++)
+		{
+			for(std::uint32_t m = 1; m <= 10; m++)
+			{
+				std::vector<bool> hit(1u << m);
+				for(std::uint32_t i = 0; i < (1u << m); i++)
+					hit[sample(i, d) >> (32 - m)] = true;
+				if(std::find(hit.begin(), hit.end(), false) != hit.end()) return false;
+			}
+		}
+		return true;
+	};
+	EXPECT_TRUE(stratified([](std::uint32_t i, usize d) { return sobol_bits(i, d); }, Sobol::DIMENSIONS));
+	EXPECT_TRUE(stratified([](std::uint32_t i, usize d) { return owen_scrambled_sobol_bits(i, d, 12345); }, Sobol::DIMENSIONS));
+
+	// 前两维是(0, m, 2)-net
+	{
+		bool net = true;
+		for(std::uint32_t mx = 0; mx <= 8; mx++)
+		{
+			const std::uint32_t my = 8 - mx;
+			std::vector<bool> hit(256);
+			for(std::uint32_t i = 0; i < 256; i++)
+			{
+				const std::uint32_t x = mx ? owen_scrambled_sobol_bits(i, 0, 99) >> (32 - mx) : 0;
+				const std::uint32_t y = my ? owen_scrambled_sobol_bits(i, 1, 99) >> (32 - my) : 0;
+				hit[(x << my) | y] = true;
+			}
+			net = net && std::find(hit.begin(), hit.end(), false) == hit.end();
+		}
+		EXPECT_TRUE(net);
+	}
+
+	{
+		constexpr usize n = 100;
+		std::vector<f32> x(n), y(n);
+		const SobolSampler sampler{7};
+		sampler.fill(5, 3, Point2SoA<f32>{x, y});
+		usize same = 0;
+		for(usize i = 0; i < n; i++)
+			if(sampler.get_2d<f32>(static_cast<std::uint32_t>(5 + i), 3) == Point2f{x[i], y[i]}) same++;
+		EXPECT_EQ(n, same);
+	}
+
+	{
+		const HaltonSampler halton;
+		EXPECT_EQ(0.5,  halton.get<f64>(1, 0));
+		EXPECT_EQ(0.25, halton.get<f64>(2, 0));
+		EXPECT_NEAR(2.0 / 3, halton.get<f64>(2, 1), 1e-15);
+
+		// 置换不改变前b^2个点的格点结构，排序后相邻的间距都是1/b^2
+		const HaltonSampler scrambled{42};
+		bool permuted = true;
+		for(usize d = 0; d < Halton::DIMENSIONS; d++)
+		{
+			const std::uint32_t base = Halton::PRIMES[d];
+			std::vector<f64> values(base * base);
+			for(std::uint32_t i = 0; i < base * base; i++)
+				values[i] = scrambled.get<f64>(i, d);
+			std::sort(values.begin(), values.end());
+			for(usize i = 1; i < values.size(); i++)
+				permuted = permuted && std::abs(values[i] - values[i - 1] - 1.0 / (base * base)) < 1e-9;
+		}
+		EXPECT_TRUE(permuted);
+		EXPECT_TRUE(scrambled.get<f32>(1, 5) != halton.get<f32>(1, 5));
+
+		std::vector<f32> x(33), y(33);
+		scrambled.fill(10, 4, Point2SoA<f32>{x, y});
+		EXPECT_EQ(scrambled.get_2d<f32>(20, 4), Point2f(x[10], y[10]));
+	}
+}
+
+static void sampling_test()
+{
+	{
+		const auto [s, c] = Sampling::sincos_quarter_pi(0.5);
+		EXPECT_NEAR(std::sin(0.5), s, 1e-15);
+		EXPECT_NEAR(std::cos(0.5), c, 1e-15);
+		const auto [sf, cf] = Sampling::sincos_quarter_pi(-PI_OVER_4<f32>);
+		EXPECT_NEAR(std::sin(-PI_OVER_4<f32>), sf, 1e-6f);
+		EXPECT_NEAR(std::cos(-PI_OVER_4<f32>), cf, 1e-6f);
+	}
+
+	constexpr usize n = 4096;
+	std::vector<f64> ux(n), uy(n);
+	Xoshiro128x8 rng{2024};
+	rng.fill(Point2SoA<f64>{ux, uy});
+	std::vector<Point2d> u(n);
+	for(usize i = 0; i < n; i++)
+		u[i] = {ux[i], uy[i]};
+
+	// 方向都是单位向量，落在对应的区域里，pdf与闭式一致
+	{
+		bool valid = true;
+		f64 cos_sum = 0;
+		for(const auto& v : u)
+		{
+			const auto [d, disk_pdf] = sample_concentric_disk(v);
+			valid = valid && d.x * d.x + d.y * d.y <= 1 + 1e-12 && disk_pdf == INV_PI<f64>;
+
+			const auto [h, h_pdf] = sample_uniform_hemisphere(v);
+			valid = valid && std::abs(h.norm() - 1) < 1e-12 && h.z >= 0 && h_pdf == INV_2PI<f64>;
+
+			const auto [sp, s_pdf] = sample_uniform_sphere(v);
+			valid = valid && std::abs(sp.norm() - 1) < 1e-12 && s_pdf == INV_4PI<f64>;
+
+			const auto [c, c_pdf] = sample_cosine_hemisphere(v);
+			valid = valid && std::abs(c.norm() - 1) < 1e-12 && std::abs(c_pdf - c.z / PI<f64>) < 1e-15;
+			cos_sum += c.z;
+
+			const auto [cone, cone_pdf] = sample_uniform_cone(v, 0.9);
+			valid = valid && std::abs(cone.norm() - 1) < 1e-12 && cone.z >= 0.9 - 1e-12
+			              && std::abs(cone_pdf * 2 * PI<f64> * 0.1 - 1) < 1e-12;
+		}
+		EXPECT_TRUE(valid);
+		// 余弦分布下E[cos] = 2/3
+		EXPECT_NEAR(2.0 / 3, cos_sum / n, 0.02);
+	}
+
+	// 均匀球面采样：上下半球各占一半
+	{
+		usize upper = 0;
+		for(const auto& v : u)
+			if(std::get<0>(sample_uniform_sphere(v)).z > 0) upper++;
+		EXPECT_NEAR(0.5, static_cast<f64>(upper) / n, 0.03);
+	}
+
+	{
+		const auto b = sample_uniform_triangle(Point2d{0.3, 0.8});
+		EXPECT_NEAR(1.0, b.x + b.y + b.z, 1e-15);
+		const Point3d p0{0, 0, 0}, p1{2, 0, 0}, p2{0, 2, 0};
+		const auto [p, pdf] = sample_uniform_triangle(p0, p1, p2, Point2d{0.3, 0.8});
+		EXPECT_NEAR(0.5, pdf, 1e-15);
+		EXPECT_TRUE(p.x >= 0 && p.y >= 0 && p.x + p.y <= 2 && p.z == 0);
+	}
+
+	// VNDF的pdf积分为1，用均匀半球采样估计
+	{
+		const Vector3d wo = Vector3d{0.3, -0.4, 0.6}.normalized();
+		f64 integral = 0;
+		for(const auto& v : u)
+		{
+			const auto [wm, pdf] = sample_uniform_hemisphere(v);
+			integral += ggx_vndf_pdf(wo, wm, 0.3, 0.6) / pdf;
+		}
+		EXPECT_NEAR(1.0, integral / n, 0.05);
+
+		bool valid = true;
+		for(const auto& v : u)
+		{
+			const auto [wm, pdf] = sample_ggx_vndf(wo, 0.3, 0.6, v);
+			valid = valid && std::abs(wm.norm() - 1) < 1e-12 && wm.z >= 0 && dot(wo, wm) >= -1e-12
+			              && std::abs(pdf - ggx_vndf_pdf(wo, wm, 0.3, 0.6)) <= 1e-12 * pdf;
+		}
+		EXPECT_TRUE(valid);
+
+		// 各向同性且alpha很小时法线集中在z轴附近
+		const auto [wm, pdf] = sample_ggx_vndf(wo, 0.001, 0.001, Point2d{0.7, 0.2});
+		EXPECT_TRUE(wm.z > 0.999);
+	}
+
+	// 批量版本与标量版本结果一致，FMA合并和向量化方式不同时允许几个ulp的误差
+	{
+		std::vector<Point2f> uf(n);
+		for(usize i = 0; i < n; i++)
+			uf[i] = Point2f(u[i]);
+		std::vector<f32> x(n), y(n), z(n), pdf(n);
+		const Vector3SoA<f32> out{x, y, z};
+
+		const auto close = [](f32 a, f32 b) { return std::abs(a - b) <= 1e-5f * std::max(1.0f, std::abs(a)); };
+		const auto same_sample = [&](const std::tuple<Vector3f, f32>& s, usize i)
+		{
+			const auto& [d, p] = s;
+			const Vector3f o = out[i];
+			return close(d.x, o.x) && close(d.y, o.y) && close(d.z, o.z) && close(p, pdf[i]);
+		};
+
+		sample_cosine_hemisphere<f32>(uf, out, pdf);
+		usize same = 0;
+		for(usize i = 0; i < n; i++)
+			if(same_sample(sample_cosine_hemisphere(uf[i]), i)) same++;
+		EXPECT_EQ(n, same);
+
+		sample_uniform_sphere<f32>(uf, out, pdf);
+		same = 0;
+		for(usize i = 0; i < n; i++)
+			if(same_sample(sample_uniform_sphere(uf[i]), i)) same++;
+		EXPECT_EQ(n, same);
+
+		std::vector<f32> ox(n, 0.2f), oy(n, 0.1f), oz(n, 0.97f);
+		sample_ggx_vndf<f32>(Vector3SoA<const f32>{Vector3SoA<f32>{ox, oy, oz}}, 0.5f, 0.5f, uf, out, pdf);
+		same = 0;
+		for(usize i = 0; i < n; i++)
+			if(same_sample(sample_ggx_vndf(Vector3f{0.2f, 0.1f, 0.97f}, 0.5f, 0.5f, uf[i]), i)) same++;
+		EXPECT_EQ(n, same);
+
+		sample_concentric_disk<f32>(uf, Point2SoA<f32>{x, y}, pdf);
+		const Point2f d = std::get<0>(sample_concentric_disk(uf[17]));
+		EXPECT_TRUE(close(d.x, x[17]) && close(d.y, y[17]));
+	}
+}
+
+static void distribution_test()
+{
+	static_assert(Distribution::find_interval<f32>(std::array{0.0f, 0.25f, 0.25f, 1.0f}, 0.25f) == 2);
+	static_assert(Distribution::find_interval<f32>(std::array{0.0f, 0.25f, 0.5f, 1.0f}, 0.1f) == 0);
+
+	PCG32 rng{7};
+	constexpr usize n = 20000;
+
+	// 经验频率与pmf一致，零权重永远不会被选中
+	{
+		const std::vector<f64> weights{1, 0, 3, 6, 0, 10};
+		const AliasTable<f64> table{weights};
+		EXPECT_NEAR(0.3, table.pmf(3), 1e-15);
+
+		std::vector<usize> count(weights.size());
+		for(usize i = 0; i < n; i++)
+			count[std::get<0>(table.sample(rng.get<f64>()))]++;
+		EXPECT_EQ(0, count[1] + count[4]);
+		bool close = true;
+		for(usize i = 0; i < weights.size(); i++)
+			close = close && std::abs(static_cast<f64>(count[i]) / n - table.pmf(i)) < 0.02;
+		EXPECT_TRUE(close);
+
+		f64 remapped = 0;
+		const auto [i, pmf] = table.sample(0.99, &remapped);
+		EXPECT_TRUE(remapped >= 0 && remapped < 1 && pmf == table.pmf(i));
+	}
+
+	// 超过一个块的权重走多线程构建
+	{
+		std::vector<f32> weights(Distribution::GRAIN * 3 + 17);
+		for(usize i = 0; i < weights.size(); i++)
+			weights[i] = static_cast<f32>(i % 7);
+		const AliasTable<f32> table{weights};
+		f64 sum = 0;
+		for(usize i = 0; i < table.size(); i++)
+			sum += table.pmf(i);
+		EXPECT_NEAR(1.0, sum, 1e-4);
+
+		std::vector<f32> u(64);
+		std::vector<std::uint32_t> index(u.size());
+		std::vector<f32> pmf(u.size());
+		for(auto& v : u) v = rng.get<f32>();
+		table.sample(u, index, pmf);
+		bool valid = true;
+		for(usize i = 0; i < u.size(); i++)
+			valid = valid && index[i] % 7 != 0 && pmf[i] == table.pmf(index[i]);
+		EXPECT_TRUE(valid);
+	}
+
+	{
+		const std::vector<f64> func{0, 1, 3};
+		const Distribution1D<f64> dist{func};
+		EXPECT_NEAR(4.0 / 3, dist.integral(), 1e-15);
+		EXPECT_NEAR(0.75, dist.discrete_pmf(2), 1e-15);
+
+		const auto [x, pdf, offset] = dist.sample_continuous(0.625);
+		EXPECT_EQ(2, offset);
+		EXPECT_NEAR(0.5 + 1.0 / 3, x, 1e-15);
+		EXPECT_NEAR(2.25, pdf, 1e-15);
+		EXPECT_EQ(pdf, dist.pdf(x));
+		EXPECT_EQ(1, std::get<0>(dist.sample_discrete(0.2)));
+		// [0, 1]以外pdf为0，边界上取最后一段
+		EXPECT_EQ(0, dist.pdf(-0.25));
+		EXPECT_EQ(0, dist.pdf(1.5));
+		EXPECT_NEAR(2.25, dist.pdf(1.0), 1e-15);
+
+		RNG<f64> r{3};
+		EXPECT_TRUE(std::get<2>(dist.sample_continuous(r)) != 0);
+
+		// 全为0时退化成均匀分布
+		const std::vector<f64> zero(4, 0.0);
+		const Distribution1D<f64> uniform{zero};
+		EXPECT_NEAR(0.3, std::get<0>(uniform.sample_continuous(0.3)), 1e-15);
+	}
+
+	{
+		constexpr usize nu = 8, nv = 4;
+		std::vector<f64> func(nu * nv);
+		for(usize v = 0; v < nv; v++)
+			for(usize u = 0; u < nu; u++)
+				func[v * nu + u] = static_cast<f64>((u + 1) * (v % 2 ? 2 : 1));
+		const Distribution2D<f64> dist{func, nu, nv};
+
+		// 以pdf为权重的估计：E[f/pdf] = 积分
+		f64 estimate = 0;
+		bool consistent = true;
+		for(usize i = 0; i < n; i++)
+		{
+			const auto [p, pdf] = dist.sample(Point2d{rng.get<f64>(), rng.get<f64>()});
+			const f64 f = func[min(static_cast<usize>(p.y * nv), nv - 1) * nu + min(static_cast<usize>(p.x * nu), nu - 1)];
+			estimate += f / pdf;
+			consistent = consistent && std::abs(pdf - dist.pdf(p)) < 1e-12;
+		}
+		EXPECT_TRUE(consistent);
+		EXPECT_NEAR(dist.integral(), estimate / n, 1e-9);
+		EXPECT_EQ(0, dist.pdf(Point2d{-0.1, 0.5}));
+		EXPECT_EQ(0, dist.pdf(Point2d{0.5, 1.1}));
+
+		std::vector<Point2d> u(16);
+		for(auto& p : u) p = {rng.get<f64>(), rng.get<f64>()};
+		std::vector<f64> x(u.size()), y(u.size()), pdf(u.size());
+		dist.sample(u, Point2SoA<f64>{x, y}, pdf);
+		EXPECT_EQ(std::get<0>(dist.sample(u[5])), Point2d(x[5], y[5]));
+
+		// 环境贴图的pdf换算成立体角后与反向查询一致
+		const auto [w, pdf_w] = sample_equirectangular(dist, Point2d{0.3, 0.6});
+		EXPECT_NEAR(1.0, w.norm(), 1e-12);
+		EXPECT_NEAR(pdf_w, equirectangular_pdf(dist, w), 1e-9 * pdf_w);
+	}
+}
+
+static void sample_table_test()
+{
+	// pmj02的每个2的幂前缀在所有基本区间上分层
+	{
+		const auto points = generate_pmj02(256, 5);
+		bool stratified = true;
+		for(std::uint32_t m = 0; m <= 8; m++)
+		{
+			const usize count = usize{1} << m;
+			for(std::uint32_t mx = 0; mx <= m; mx++)
+			{
+				const std::uint32_t my = m - mx;
+				std::vector<bool> hit(count);
+				for(usize i = 0; i < count; i++)
+				{
+					const auto x = static_cast<usize>(points[i].x * static_cast<f32>(1u << mx));
+					const auto y = static_cast<usize>(points[i].y * static_cast<f32>(1u << my));
+					hit[(x << my) | y] = true;
+				}
+				stratified = stratified && std::find(hit.begin(), hit.end(), false) == hit.end();
+			}
+		}
+		EXPECT_TRUE(stratified);
+	}
+
+	// 蓝噪声的最近点距离明显大于白噪声
+	const auto min_distance2 = [](std::span<const Point2f> p)
+	{
+		f32 ret = INFINITY_<f32>;
+		for(usize i = 0; i < p.size(); i++)
+			for(usize j = i + 1; j < p.size(); j++)
+				ret = min(ret, distance2(p[i], p[j]));
+		return ret;
+	};
+	const auto blue = generate_blue_noise(512, 3);
+	{
+		PCG32 rng{3};
+		std::vector<Point2f> white(512);
+		for(auto& p : white) p = {rng.get<f32>(), rng.get<f32>()};
+		EXPECT_TRUE(min_distance2(blue) > 20 * min_distance2(white));
+		EXPECT_TRUE(std::all_of(blue.begin(), blue.end(), [](const Point2f& p) { return p.x >= 0 && p.x < 1 && p.y >= 0 && p.y < 1; }));
+	}
+
+	// 写入后映射回来，内容一致且不拷贝
+	{
+		const auto path = std::filesystem::temp_directory_path() / "hinae_sample_table_test.bin";
+		std::filesystem::remove(path);
+
+		// 临时文件名带进程号和序号，每次都不同，写完后不会留下
+		EXPECT_TRUE(temporary_path(path) != temporary_path(path));
+		EXPECT_TRUE(temporary_path(path).parent_path() == path.parent_path());
+
+		EXPECT_TRUE(write_sample_table(path, SamplePattern::BlueNoise, 3, blue));
+		EXPECT_TRUE(std::none_of(std::filesystem::directory_iterator(path.parent_path()), std::filesystem::directory_iterator{},
+		                         [](const auto& e) { return e.path().filename().string().starts_with("hinae_sample_table_test.bin.tmp"); }));
+		const auto table = SampleTable::open(path);
+		EXPECT_TRUE(table.has_value());
+		EXPECT_TRUE(table->is_mapped());
+		EXPECT_EQ(blue.size(), table->size());
+		EXPECT_TRUE(std::equal(blue.begin(), blue.end(), table->points().begin()));
+
+		const auto cached = SampleTable::load_or_generate(path, SamplePattern::BlueNoise, 512, 3);
+		EXPECT_TRUE(cached.is_mapped());
+		EXPECT_EQ(blue[100], cached[100]);
+
+		// 参数不一致时重新生成并覆盖缓存
+		const auto regenerated = SampleTable::load_or_generate(path, SamplePattern::PMJ02, 64, 9);
+		EXPECT_EQ(64, regenerated.size());
+		EXPECT_EQ(generate_pmj02(64, 9)[10], regenerated[10]);
+		EXPECT_TRUE(regenerated.header().pattern == SamplePattern::PMJ02);
+
+		// 其他字节序的机器写出的文件魔数是反的，当作无效的缓存重新生成
+		{
+			std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+			const std::uint32_t swapped = 0x48534d50;
+			file.write(reinterpret_cast<const char*>(&swapped), sizeof(swapped));
+		}
+		EXPECT_TRUE(!SampleTable::open(path).has_value());
+		EXPECT_TRUE(SampleTable::load_or_generate(path, SamplePattern::PMJ02, 64, 9).is_mapped());
+		EXPECT_TRUE(SampleTable::open(path).has_value());
+
+		// 截断的文件不会被接受
+		std::filesystem::resize_file(path, sizeof(SampleTableHeader) + 3);
+		EXPECT_TRUE(!SampleTable::open(path).has_value());
+		EXPECT_TRUE(!MappedFile::open(path.string() + ".missing").has_value());
+		std::filesystem::remove(path);
+	}
+}
+
+static void fresnel_test()
+{
+	static_assert(Fresnel::dielectric(0.0, 1.5) == 1);
+	static_assert(Fresnel::conductor(0.0, 0.2, 3.0) == 1);
+
+	// 实数形式与复数形式一致
+	{
+		bool same = true;
+		for(f64 c = 0.0; c <= 1.0; c += 0.05)
+		{
+			const f64 complex = Fresnel::conductor(c, std::complex<f64>{1, 0}, std::complex<f64>{0.2, 3.9});
+			same = same && std::abs(complex - Fresnel::conductor(c, 0.2, 3.9)) < 1e-12;
+			same = same && std::abs(Fresnel::dielectric(c, 1.0, 1.5) - Fresnel::dielectric(c, 1.5)) < 1e-12;
+			same = same && std::abs(Fresnel::dielectric(-c, 1.0, 1.5) - Fresnel::dielectric(-c, 1.5)) < 1e-12;
+		}
+		EXPECT_TRUE(same);
+		EXPECT_NEAR(0.04, Fresnel::dielectric(1.0, 1.5), 1e-12);
+		EXPECT_EQ(1, Fresnel::dielectric(-0.1, 1.5));
+	}
+
+	// 多个波长，SSE和标量的舍入顺序不同，f32下相差几个ulp
+	{
+		const std::array<f32, 8> eta{0.2f, 0.9f, 1.1f, 0.15f, 0.3f, 2.0f, 1.4f, 0.05f};
+		const std::array<f32, 8> k{3.9f, 2.4f, 2.6f, 3.6f, 1.0f, 0.0f, 5.0f, 4.2f};
+		const auto spectral = Fresnel::conductor(0.6f, eta, k);
+		bool close = true;
+		for(usize i = 0; i < 8; i++)
+			close = close && std::abs(spectral[i] - Fresnel::conductor(0.6f, eta[i], k[i])) < 1e-5f;
+		EXPECT_TRUE(close);
+
+		constexpr auto dispersion = Fresnel::dielectric(0.3, std::array{1.4, 1.5, 1.6});
+		static_assert(dispersion[0] < dispersion[1] && dispersion[1] < dispersion[2]);
+	}
+
+	// 多个着色点
+	{
+		std::vector<f32> cos(37), out(37);
+		for(usize i = 0; i < cos.size(); i++)
+			cos[i] = static_cast<f32>(i) / 36 * 2 - 1;
+		Fresnel::conductor<f32>(cos, 0.2f, 3.9f, out);
+		bool close = true;
+		for(usize i = 0; i < cos.size(); i++)
+			close = close && std::abs(out[i] - Fresnel::conductor(cos[i], 0.2f, 3.9f)) < 1e-5f;
+		Fresnel::dielectric<f32>(cos, 1.33f, out);
+		for(usize i = 0; i < cos.size(); i++)
+			close = close && std::abs(out[i] - Fresnel::dielectric(cos[i], 1.33f)) < 1e-6f;
+		EXPECT_TRUE(close);
+	}
+}
+
+static void fresnel_table_test()
+{
+	{
+		const auto dielectric = FresnelTable<f32>::dielectric(1.5f);
+		const auto conductor = FresnelTable<f32>::conductor(0.2f, 3.9f);
+		EXPECT_TRUE(dielectric.max_error() < 1e-4f);
+		EXPECT_TRUE(dielectric.max_error<Interpolation::Cubic>() < 1e-4f);
+		EXPECT_TRUE(conductor.max_error() < 1e-5f);
+		EXPECT_TRUE(conductor.max_error<Interpolation::Cubic>() < 1e-6f);
+		// 只取两端的点
+		EXPECT_TRUE(std::isfinite(conductor.max_error(2)) && conductor.max_error(2) <= conductor.max_error());
+
+		// 全反射和两端的值精确
+		EXPECT_EQ(1, dielectric.eval(-0.2f));
+		EXPECT_NEAR(0.04f, dielectric.eval(1.0f), 1e-6f);
+		EXPECT_EQ(1, conductor.eval<Interpolation::Cubic>(0.0f));
+	}
+
+	// f16存储的误差受半精度尾数限制
+	{
+		const auto table = FresnelTable<f16>::conductor(1.1f, 2.6f, 128);
+		EXPECT_EQ(130 * sizeof(f16), table.bytes());
+		EXPECT_TRUE(table.max_error() < 5e-4f);
+		EXPECT_TRUE(table.max_error<Interpolation::Cubic>() < 5e-4f);
+	}
+
+	{
+		const auto table = FresnelTable<f32>::dielectric(1.33f, 64);
+		std::vector<f32> cos(50), out(50);
+		for(usize i = 0; i < cos.size(); i++)
+			cos[i] = static_cast<f32>(i) / 49 * 2 - 1;
+		table.eval<Interpolation::Cubic>(cos, out);
+		bool same = true;
+		for(usize i = 0; i < cos.size(); i++)
+			same = same && out[i] == table.eval<Interpolation::Cubic>(cos[i]);
+		EXPECT_TRUE(same);
+	}
+}
+
+static void microfacet_test()
+{
+	constexpr usize n = 1 << 16;
+	std::vector<Point2d> u(n);
+	{
+		const SobolSampler sobol{11};
+		for(usize i = 0; i < n; i++)
+			u[i] = sobol.get_2d<f64>(static_cast<std::uint32_t>(i), 0);
+	}
+
+	const Vector3d wo = Vector3d{0.5, 0.2, 0.6}.normalized();
+	const auto check = [&](const auto& dist)
+	{
+		// 投影面积归一化: ∫D(wm)cos(wm)dwm = 1，可见法线分布积分为1
+		f64 projected = 0, visible = 0, moment = 0;
+		for(const auto& v : u)
+		{
+			const auto [wm, pdf] = sample_uniform_hemisphere(v);
+			projected += dist.D(wm) * wm.z / pdf;
+			visible += dist.D(wo, wm) / pdf;
+			moment += dist.D(wo, wm) * wm.z / pdf;
+		}
+		EXPECT_NEAR(1.0, projected / n, 0.01);
+		EXPECT_NEAR(1.0, visible / n, 0.01);
+
+		// 采样得到的法线分布与pdf一致：比较E[wm.z]
+		f64 sampled = 0;
+		bool valid = true;
+		for(const auto& v : u)
+		{
+			const auto [wm, pdf] = dist.sample_wm(wo, v);
+			sampled += wm.z;
+			valid = valid && std::abs(wm.norm() - 1) < 1e-9 && wm.z > 0 && std::abs(pdf - dist.pdf(wo, wm)) <= 1e-9 * pdf;
+		}
+		EXPECT_TRUE(valid);
+		EXPECT_NEAR(moment / n, sampled / n, 0.01);
+
+		// 宏观法线方向没有遮蔽
+		EXPECT_NEAR(1.0, dist.G1(Vector3d{0, 0, 1}), 1e-12);
+		EXPECT_TRUE(dist.G(wo, Vector3d{0, 0.6, 0.8}) <= dist.G1(wo));
+		EXPECT_NEAR(0.0, dist.G1(Vector3d{1, 0, 0}), 1e-12);
+	};
+	check(GGX<f64>{0.3, 0.6});
+	check(Beckmann<f64>{0.3, 0.6});
+	check(Beckmann<f64>{0.5});
+
+	// 批量版本与标量版本一致
+	{
+		const GGX<f32> ggx{0.2f, 0.4f};
+		const Beckmann<f32> beckmann{0.25f};
+		constexpr usize m = 37;
+		std::vector<f32> x(m), y(m), z(m), ox(m, 0.3f), oy(m, -0.2f), oz(m, 0.932f), out(m);
+		for(usize i = 0; i < m; i++)
+		{
+			const Vector3f w = std::get<0>(sample_cosine_hemisphere(Point2f(u[i])));
+			x[i] = w.x; y[i] = w.y; z[i] = w.z;
+		}
+		const Vector3SoA<const f32> wm{Vector3SoA<f32>{x, y, z}};
+		const Vector3SoA<const f32> wo_soa{Vector3SoA<f32>{ox, oy, oz}};
+
+		bool same = true;
+		ggx.D(wm, out);
+		for(usize i = 0; i < m; i++) same = same && out[i] == ggx.D(wm[i]);
+		beckmann.D(wm, out);
+		for(usize i = 0; i < m; i++) same = same && out[i] == beckmann.D(wm[i]);
+		ggx.G(wo_soa, wm, out);
+		for(usize i = 0; i < m; i++) same = same && out[i] == ggx.G(wo_soa[i], wm[i]);
+		beckmann.pdf(wo_soa, wm, out);
+		for(usize i = 0; i < m; i++) same = same && out[i] == beckmann.pdf(wo_soa[i], wm[i]);
+		EXPECT_TRUE(same);
+
+		std::vector<Point2f> uf(m);
+		for(usize i = 0; i < m; i++) uf[i] = Point2f(u[i]);
+		std::vector<f32> sx(m), sy(m), sz(m);
+		beckmann.sample_wm(wo_soa, uf, Vector3SoA<f32>{sx, sy, sz}, out);
+		EXPECT_EQ(std::get<0>(beckmann.sample_wm(wo_soa[3], uf[3])), Vector3f(sx[3], sy[3], sz[3]));
+	}
+}
+
+static void equation_test()
+{
+	// 二次方程
+	{
+		constexpr auto r = solve_quadratic(1.0, -3.0, 2.0);
+		static_assert(r.size() == 2 && r[0] == 1 && r[1] == 2);
+		EXPECT_TRUE(solve_quadratic(1.0, 0.0, 1.0).empty());
+		EXPECT_EQ(1u, solve_quadratic(0.0, 2.0, -1.0).size());
+		EXPECT_EQ(0.5, solve_quadratic(0.0, 2.0, -1.0)[0]);
+		EXPECT_TRUE(solve_quadratic(0.0, 0.0, 1.0).empty());
+
+		// b^2远大于4ac时较小的根也没有抵消误差
+		const auto small = solve_quadratic(1.0, -1e8, 1.0);
+		EXPECT_NEAR(1e-8, small[0], 1e-22);
+		EXPECT_NEAR(1e8, small[1], 1e-6);
+		const auto small_f = solve_quadratic(1.0f, -1e4f, 1.0f);
+		EXPECT_NEAR(1e-4f, small_f[0], 1e-10f);
+
+		// 旧接口的行为不变：(c / q, q / a)，不排序
+		const auto [x1, x2] = quadratic(1.0, -3.0, 2.0).value();
+		EXPECT_EQ(1.0, x1);
+		EXPECT_EQ(2.0, x2);
+		const auto [y1, y2] = quadratic(1.0, 3.0, 2.0).value();
+		EXPECT_EQ(-1.0, y1);
+		EXPECT_EQ(-2.0, y2);
+		const auto [z1, z2] = quadratic(0.0, 2.0, -1.0).value();
+		EXPECT_EQ(0.5, z1);
+		EXPECT_EQ(-INFINITY_<f64>, z2);
+		EXPECT_TRUE(!quadratic(1.0, 0.0, 1.0).has_value());
+	}
+
+	// 三次方程
+	{
+		const auto three = solve_cubic(2.0, -12.0, 22.0, -12.0);
+		EXPECT_EQ(3u, three.size());
+		for(usize i = 0; i < 3; i++) EXPECT_NEAR(static_cast<f64>(i + 1), three[i], 1e-14);
+
+		const auto one = solve_cubic(1.0, 0.0, 1.0, -2.0);
+		EXPECT_EQ(1u, one.size());
+		EXPECT_NEAR(1.0, one[0], 1e-15);
+
+		const auto triple = solve_cubic(1.0, -3.0, 3.0, -1.0);
+		EXPECT_TRUE(!triple.empty());
+		for(f64 x : triple) EXPECT_NEAR(1.0, x, 1e-5);
+
+		// (x - 1)^2 * (x + 2)
+		const auto twice = solve_cubic(1.0f, 0.0f, -3.0f, 2.0f);
+		EXPECT_EQ(3u, twice.size());
+		EXPECT_NEAR(-2.0f, twice[0], 1e-6f);
+		EXPECT_NEAR(1.0f, twice[2], 1e-3f);
+
+		EXPECT_EQ(2u, solve_cubic(0.0, 1.0, -3.0, 2.0).size());
+	}
+
+	// 四次方程
+	{
+		// (x - 1)(x - 2)(x - 3)(x - 4)
+		const auto four = solve_quartic(1.0, -10.0, 35.0, -50.0, 24.0);
+		EXPECT_EQ(4u, four.size());
+		for(usize i = 0; i < 4; i++) EXPECT_NEAR(static_cast<f64>(i + 1), four[i], 1e-12);
+
+		const auto bi = solve_quartic(1.0f, 0.0f, -5.0f, 0.0f, 4.0f);
+		EXPECT_EQ(4u, bi.size());
+		const std::array<f32, 4> expect{-2, -1, 1, 2};
+		for(usize i = 0; i < 4; i++) EXPECT_NEAR(expect[i], bi[i], 1e-6f);
+
+		EXPECT_TRUE(solve_quartic(1.0, 0.0, 0.0, 0.0, 1.0).empty());
+
+		// (x^2 + 1)(x - 0.5)(x + 3)
+		const auto two = solve_quartic(2.0, 5.0, -1.0, 5.0, -3.0);
+		EXPECT_EQ(2u, two.size());
+		EXPECT_NEAR(-3.0, two[0], 1e-13);
+		EXPECT_NEAR(0.5, two[1], 1e-13);
+
+		// 随机根重新展开后求解
+		PCG32 rng{7};
+		for(usize n = 0; n < 1000; n++)
+		{
+			std::array<f64, 4> r;
+			for(f64& x : r) x = rng.get<f64>() * 20 - 10;
+			std::sort(r.begin(), r.end());
+			const f64 b = -(r[0] + r[1] + r[2] + r[3]);
+			const f64 c = r[0] * r[1] + r[0] * r[2] + r[0] * r[3] + r[1] * r[2] + r[1] * r[3] + r[2] * r[3];
+			const f64 d = -(r[0] * r[1] * r[2] + r[0] * r[1] * r[3] + r[0] * r[2] * r[3] + r[1] * r[2] * r[3]);
+			const f64 e = r[0] * r[1] * r[2] * r[3];
+			const auto roots = solve_quartic(1.0, b, c, d, e);
+			bool ok = roots.size() == 4;
+			for(usize i = 0; ok && i < 4; i++) ok = std::abs(roots[i] - r[i]) < 1e-6;
+			EXPECT_TRUE(ok);
+		}
+	}
+
+	// 批量版本与标量版本一致
+	{
+		constexpr usize N = 16;
+		std::array<f32, N> a, b, c, x0, x1;
+		PCG32 rng{11};
+		for(usize i = 0; i < N; i++)
+		{
+			a[i] = i % 5 == 0 ? 0.0f : rng.get<f32>() * 2 - 1;
+			b[i] = i == 10 ? 0.0f : rng.get<f32>() * 2 - 1;
+			c[i] = rng.get<f32>() * 2 - 1;
+		}
+		const std::uint32_t mask = solve_quadratic(a, b, c, x0, x1);
+
+		std::uint32_t expect = 0;
+		bool same = true;
+		for(usize i = 0; i < N; i++)
+		{
+			const auto roots = solve_quadratic(a[i], b[i], c[i]);
+			expect |= static_cast<std::uint32_t>(!roots.empty()) << i;
+			if(roots.empty())
+				same &= std::isnan(x0[i]) && std::isnan(x1[i]);
+			else
+				same &= std::abs(x0[i] - roots[0]) <= 1e-5f * max(1.0f, std::abs(roots[0]))
+				     && std::abs(x1[i] - roots[roots.size() - 1]) <= 1e-5f * max(1.0f, std::abs(roots[roots.size() - 1]));
+		}
+		EXPECT_EQ(expect, mask);
+		EXPECT_TRUE(same);
+		EXPECT_TRUE((mask & 1) == 1);
+
+		std::vector<f64> ad{1, 1, 0, 2}, bd{-3, 0, 2, 0}, cd{2, 1, -1, 0}, r0(4), r1(4);
+		std::vector<std::uint8_t> count(4);
+		EXPECT_EQ(3u, solve_quadratic<f64>(ad, bd, cd, r0, r1, count));
+		EXPECT_EQ(0.0, r0[3]);
+		EXPECT_EQ(0.0, r1[3]);
+		EXPECT_EQ(2, count[0]);
+		EXPECT_EQ(0, count[1]);
+		EXPECT_EQ(1, count[2]);
+		EXPECT_EQ(2.0, r1[0]);
+		EXPECT_TRUE(std::isnan(r0[1]));
+
+		std::vector<f64> e{24}, quartic_a{1}, quartic_b{-10}, quartic_c{35}, quartic_d{-50};
+		std::vector<Roots<f64, 4>> out(1);
+		solve_quartic<f64>(quartic_a, quartic_b, quartic_c, quartic_d, e, out);
+		EXPECT_EQ(4u, out[0].size());
+
+		std::vector<Roots<f64, 3>> cubic_out(1);
+		solve_cubic<f64>(quartic_a, quartic_b, quartic_c, quartic_d, cubic_out);
+		EXPECT_EQ(1u, cubic_out[0].size());
+	}
+}
+
+static void intersection_test()
+{
+	// 单个图元
+	{
+		const Ray3d ray{Point3d{0, 0, -5}, Vector3d{0, 0, 1}};
+		const auto hit = intersect(ray, INFINITY_<f64>, Sphere<f64>{Point3d{0, 0, 0}, 1});
+		EXPECT_TRUE(hit.has_value());
+		EXPECT_EQ(4.0, hit->t);
+		EXPECT_EQ(Vector3d(0, 0, -1), hit->normal);
+		EXPECT_TRUE(!intersect(ray, 3.0, Sphere<f64>{Point3d{0, 0, 0}, 1}).has_value());
+		EXPECT_EQ(1.0, intersect(Ray3d{Point3d{0, 0, 0}, Vector3d{0, 0, 1}}, INFINITY_<f64>, Sphere<f64>{Point3d{0, 0, 0}, 1})->t);
+		EXPECT_TRUE(!intersect(ray, INFINITY_<f64>, Sphere<f64>{Point3d{2, 0, 0}, 1}).has_value());
+
+		const auto disk = intersect(ray, INFINITY_<f64>, Disk<f64>{Point3d{0.5, 0, 1}, Vector3d{0, 0, 1}, 1});
+		EXPECT_EQ(6.0, disk->t);
+		EXPECT_TRUE(!intersect(ray, INFINITY_<f64>, Disk<f64>{Point3d{2, 0, 1}, Vector3d{0, 0, 1}, 1}).has_value());
+		EXPECT_TRUE(!intersect(ray, INFINITY_<f64>, Disk<f64>{Point3d{0, 0, 1}, Vector3d{1, 0, 0}, 1}).has_value());
+
+		// 圆柱沿y轴，光线沿z轴穿过
+		const Cylinder<f64> cylinder{Point3d{0, -1, 0}, Vector3d{0, 1, 0}, 2, 2};
+		const auto side = intersect(ray, INFINITY_<f64>, cylinder);
+		EXPECT_EQ(3.0, side->t);
+		EXPECT_EQ(Vector3d(0, 0, -1), side->normal);
+		EXPECT_TRUE(!intersect(Ray3d{Point3d{0, 2, -5}, Vector3d{0, 0, 1}}, INFINITY_<f64>, cylinder).has_value());
+		EXPECT_TRUE(!intersect(Ray3d{Point3d{0, -5, 0}, Vector3d{0, 1, 0}}, INFINITY_<f64>, cylinder).has_value());
+		EXPECT_EQ(2.0, intersect(Ray3d{Point3d{0, 0, 0}, Vector3d{1, 0, 0}}, INFINITY_<f64>, cylinder)->t);
+	}
+
+	// 很远处的小球，b^2 - ac在f32下会抵消掉
+	{
+		const Ray3f ray{Point3f{0.0009f, 0, 0}, Vector3f{0, 0, 1}};
+		const auto hit = intersect(ray, INFINITY_<f32>, Sphere<f32>{Point3f{0, 0, 10000}, 0.001f});
+		EXPECT_TRUE(hit.has_value());
+		EXPECT_NEAR(10000.0f, hit->t, 0.01f);
+	}
+
+	// SoA版本与逐个求交的结果一致
+	{
+		constexpr usize n = 101;
+		PCG32 rng{3};
+		std::vector<f32> cx(n), cy(n), cz(n), r(n), nx(n), ny(n), nz(n), h(n);
+		for(usize i = 0; i < n; i++)
+		{
+			cx[i] = rng.get<f32>() * 20 - 10;
+			cy[i] = rng.get<f32>() * 20 - 10;
+			cz[i] = rng.get<f32>() * 20 - 10;
+			r[i] = rng.get<f32>() * 2 + 0.1f;
+			h[i] = rng.get<f32>() * 3;
+			const Vector3f v = Vector3f{rng.get<f32>() - 0.5f, rng.get<f32>() - 0.5f, rng.get<f32>() - 0.5f}.normalized();
+			nx[i] = v.x; ny[i] = v.y; nz[i] = v.z;
+		}
+		const Point3SoA<const f32> center{Point3SoA<f32>{cx, cy, cz}};
+		const Vector3SoA<const f32> axis{Vector3SoA<f32>{nx, ny, nz}};
+		const SphereSoA<f32> spheres{center, r};
+		const DiskSoA<f32> disks{center, axis, r};
+		const CylinderSoA<f32> cylinders{center, axis, r, h};
+
+		const auto brute = [](const Ray3f& ray, const auto& soa) -> std::optional<PrimitiveHit<f32>>
+		{
+			std::optional<PrimitiveHit<f32>> best;
+			for(usize i = 0; i < soa.size(); i++)
+			{
+				auto hit = intersect(ray, best ? best->t : INFINITY_<f32>, soa[i]);
+				if(hit)
+				{
+					hit->index = i;
+					best = hit;
+				}
+			}
+			return best;
+		};
+		const auto same = [](const std::optional<PrimitiveHit<f32>>& a, const std::optional<PrimitiveHit<f32>>& b)
+		{
+			if(a.has_value() != b.has_value()) return false;
+			return !a || (a->index == b->index && a->t == b->t && a->normal == b->normal);
+		};
+
+		bool ok = true;
+		usize hits = 0;
+		for(usize k = 0; k < 64; k++)
+		{
+			const Ray3f ray{Point3f{0, 0, 0}, Vector3f{rng.get<f32>() - 0.5f, rng.get<f32>() - 0.5f, rng.get<f32>() - 0.5f}};
+			const auto expect = brute(ray, spheres);
+			ok &= same(expect, intersect(ray, INFINITY_<f32>, spheres));
+			ok &= same(expect, intersect<8>(ray, INFINITY_<f32>, spheres));
+			ok &= same(brute(ray, disks), intersect(ray, INFINITY_<f32>, disks));
+			ok &= same(brute(ray, cylinders), intersect<8>(ray, INFINITY_<f32>, cylinders));
+			hits += expect.has_value();
+		}
+		EXPECT_TRUE(ok);
+		EXPECT_TRUE(hits > 0);
+	}
+
+	// 一组光线和同一个图元求交
+	{
+		constexpr usize n = 16;
+		std::vector<f64> ox(n, 0), oy(n), oz(n, -5), dx(n, 0), dy(n, 0), dz(n, 1), t(n, 100), nx(n), ny(n), nz(n);
+		for(usize i = 0; i < n; i++) oy[i] = static_cast<f64>(i) * 0.1;
+		t[3] = 1;
+
+		const Sphere<f64> sphere{Point3d{0, 0, 0}, 1};
+		const Point3SoA<const f64> origin{Point3SoA<f64>{ox, oy, oz}};
+		const Vector3SoA<const f64> direction{Vector3SoA<f64>{dx, dy, dz}};
+		const usize hits = intersect<5, f64>(origin, direction, sphere, t, Vector3SoA<f64>{nx, ny, nz});
+		// 第10条光线和球相切，也算命中
+		EXPECT_EQ(10u, hits);
+		EXPECT_EQ(1.0, t[3]);
+		EXPECT_EQ(100.0, t[12]);
+		bool ok = true;
+		for(usize i = 0; i < n; i++)
+		{
+			if(i == 3 || i > 10) continue;
+			const auto hit = intersect(Ray3d{origin[i], direction[i]}, 100.0, sphere);
+			ok &= hit->t == t[i] && hit->normal == Vector3d(nx[i], ny[i], nz[i]);
+		}
+		EXPECT_TRUE(ok);
+
+		std::fill(t.begin(), t.end(), 100.0);
+		const Disk<f64> disk{Point3d{0, 0, 0}, Vector3d{0, 0, 1}, 2};
+		EXPECT_EQ(n, (intersect<8, f64>(origin, direction, disk, t, Vector3SoA<f64>{nx, ny, nz})));
+		EXPECT_EQ(5.0, t[0]);
+		std::fill(t.begin(), t.end(), 100.0);
+		const Cylinder<f64> cylinder{Point3d{0, 0, 0}, Vector3d{0, 1, 0}, 1, 2};
+		EXPECT_EQ(n, (intersect<16, f64>(origin, direction, cylinder, t, Vector3SoA<f64>{nx, ny, nz})));
+		EXPECT_EQ(4.0, t[0]);
+	}
+}
+
+static void spectrum_test()
+{
+	static_assert(Hinae::fabs(Hinae::exp(1.0) - std::numbers::e) < 1e-15);
+	static_assert(Hinae::exp(0.0f) == 1.0f);
+	for(f64 x = -700; x <= 700; x += 13.7)
+		EXPECT_NEAR(1.0, Constexpr::exp(x) / std::exp(x), 1e-14);
+
+	// 运算与逐分量的标量结果一致
+	{
+		using Spectrum8 = SampledSpectrum<f32, 8>;
+		const Spectrum8 a{{1, 2, 3, 4, 5, 6, 7, 8}}, b{{0.5f, 0.25f, 2, 4, 8, 1, 3, 9}};
+		const Spectrum8 r = (a + b) * a / b - Spectrum8(1) + 2.0f * a;
+		bool same = true;
+		for(usize i = 0; i < 8; i++)
+			same &= std::abs(r[i] - ((a[i] + b[i]) * a[i] / b[i] - 1 + 2 * a[i])) <= 1e-5f * std::abs(r[i]);
+		EXPECT_TRUE(same);
+
+		constexpr SampledSpectrum<f64, 4> c = SampledSpectrum<f64, 4>{{1, 4, 9, 16}} * 2.0;
+		static_assert(c[3] == 32 && sqrt(c / 2.0)[2] == 3);
+		static_assert(c.max_value() == 32 && c.min_value() == 2 && c.average() == 15);
+		static_assert(clamp(3.0, c, 10.0) == SampledSpectrum<f64, 4>{{3, 8, 10, 10}});
+		static_assert(!SampledSpectrum<f64, 4>() && static_cast<bool>(c));
+
+		const auto e = exp(SampledSpectrum<f32, 16>(-1.0f));
+		EXPECT_NEAR(std::exp(-1.0f), e[15], 1e-7f);
+		EXPECT_EQ(2.0f, sqrt(SampledSpectrum<f32, 16>(4.0f))[9]);
+		EXPECT_EQ(0.0f, safe_div(Spectrum8(1), Spectrum8(0))[0]);
+		Spectrum8 d = a;
+		d += b;
+		d *= 2.0f;
+		EXPECT_EQ(3.0f, d[0]);
+	}
+
+	// CIE表格与参考值相差不大
+	{
+		EXPECT_NEAR(1.0f, Spectrum::lookup(Spectrum::CIE_Y, 555.0f), 0.02f);
+		EXPECT_NEAR(1.0622f, Spectrum::lookup(Spectrum::CIE_X, 600.0f), 0.02f);
+		EXPECT_NEAR(1.7721f, Spectrum::lookup(Spectrum::CIE_Z, 445.0f), 0.03f);
+		EXPECT_NEAR(106.857f, Spectrum::CIE_Y_INTEGRAL, 1.5f);
+		EXPECT_EQ(0.0f, Spectrum::lookup(Spectrum::CIE_Y, 900.0f));
+	}
+
+	// 常数光谱1的亮度是1，两种波长采样方法的估计都收敛
+	{
+		Vector3d uniform{}, visible{};
+		constexpr usize n = 4096;
+		for(usize i = 0; i < n; i++)
+		{
+			const f64 u = (static_cast<f64>(i) + 0.5) / n;
+			uniform += to_xyz(SampledSpectrum<f64, 4>(1.0), SampledWavelengths<f64, 4>::sample_uniform(u));
+			visible += to_xyz(SampledSpectrum<f64, 4>(1.0), SampledWavelengths<f64, 4>::sample_visible(u));
+		}
+		EXPECT_NEAR(1.0, uniform.y / n, 1e-3);
+		EXPECT_NEAR(1.0, visible.y / n, 1e-2);
+		EXPECT_NEAR(uniform.x / n, visible.x / n, 2e-2);
+
+		const Vector3d rgb = xyz_to_rgb(uniform / static_cast<f64>(n));
+		EXPECT_TRUE(rgb.x > 0 && rgb.y > 0 && rgb.z > 0);
+		const Vector3d back = rgb_to_xyz(rgb) - uniform / static_cast<f64>(n);
+		EXPECT_TRUE(back.norm() < 1e-6);
+
+		auto w = SampledWavelengths<f32, 4>::sample_uniform(0.9f);
+		EXPECT_TRUE(w.lambda.max_value() <= LAMBDA_MAX && w.lambda.min_value() >= LAMBDA_MIN);
+		w.terminate_secondary();
+		EXPECT_TRUE(w.secondary_terminated());
+		EXPECT_NEAR(1.0f / (4 * (LAMBDA_MAX - LAMBDA_MIN)), w.pdf[0], 1e-9f);
+	}
+
+	// 菲涅尔项逐波长计算
+	{
+		const SampledSpectrum<f32, 8> eta{{0.2f, 0.3f, 0.4f, 0.5f, 1.1f, 1.2f, 1.3f, 1.4f}}, k(3.0f);
+		const auto fc = Fresnel::conductor(0.7f, eta, k);
+		const auto fd = Fresnel::dielectric(0.7f, eta);
+		bool same = true;
+		for(usize i = 0; i < 8; i++)
+		{
+			same &= std::abs(fc[i] - Fresnel::conductor(0.7f, eta[i], k[i])) < 1e-5f;
+			same &= std::abs(fd[i] - Fresnel::dielectric(0.7f, eta[i])) < 1e-6f;
+		}
+		EXPECT_TRUE(same);
+	}
+}
+
+static void stats_test()
+{
+	// 分桶
+	static_assert(Stats::bucket(0) == 0 && Stats::bucket(1) == 1 && Stats::bucket(2) == 2 && Stats::bucket(3) == 2);
+	static_assert(Stats::bucket(~std::uint64_t(0)) == Stats::BUCKET_COUNT - 1);
+	static_assert(Stats::bucket_floor(0) == 0 && Stats::bucket_floor(3) == 4);
+
+	// 常量求值时不计数
+	constexpr bool hit = Bounds3f({-1, -1, -1}, {1, 1, 1}).intersect(Ray3f({0, 0, -5}, {0, 0, 1}), {INFINITY_<f32>, INFINITY_<f32>, 1});
+	static_assert(hit);
+
+	Stats::reset();
+	const Bounds3f box({-1, -1, -1}, {1, 1, 1});
+	const Vector3f inv_dir{INFINITY_<f32>, INFINITY_<f32>, 1};
+
+	// 每个线程写自己的槽位，退出后计数仍然保留
+	std::vector<std::thread> threads;
+	for(usize i = 0; i < 4; i++)
+	{
+		threads.emplace_back([&, i]
+		{
+			for(usize j = 0; j < 100; j++)
+				box.intersect(Ray3f({0, 0, j % 2 == 0 ? -5.0f : 5.0f}, {0, 0, 1}), inv_dir);
+			Stats::record<Histogram::NodesPerTraversal>(i);
+		});
+	}
+	for(auto& t : threads) t.join();
+
+	std::vector<Point2f> u(33, Point2f{0.25f, 0.5f});
+	std::vector<f32> x(33), y(33), z(33), pdf(33);
+	sample_cosine_hemisphere<f32>(u, Vector3SoA<f32>(x, y, z), pdf);
+
+	const Stats::Snapshot s = Stats::snapshot();
+	if constexpr(Stats::ENABLED)
+	{
+		EXPECT_EQ(400u, s[Stat::RayBoxTests]);
+		EXPECT_EQ(200u, s[Stat::RayBoxHits]);
+		EXPECT_EQ(33u, s[Stat::SampledPoints]);
+		EXPECT_EQ(1u, s[Histogram::BatchSize][Stats::bucket(33)]);
+		EXPECT_EQ(4u, s.total(Histogram::NodesPerTraversal));
+		EXPECT_EQ(2u, s[Histogram::NodesPerTraversal][2]);
+
+		std::ostringstream csv;
+		Stats::export_csv(csv, s);
+		EXPECT_TRUE(csv.str().find("counter,ray_box_tests,,400\n") != std::string::npos);
+		EXPECT_TRUE(csv.str().find("histogram,batch_size,32,1\n") != std::string::npos);
+
+		Stats::reset();
+		EXPECT_EQ(0u, Stats::snapshot()[Stat::RayBoxTests]);
+	}
+	else
+	{
+		// 没有定义USE_STATS时所有计数都是空操作
+		EXPECT_EQ(0u, s[Stat::RayBoxTests]);
+		EXPECT_EQ(0u, s.total(Histogram::BatchSize));
+	}
+}
+
+static void parallel_test()
+{
+	// 全局线程池在单核机器上没有工作线程，这里另外建一个保证真的跨线程执行
+	for(usize threads : {0, 3})
+	{
+		ThreadPool pool(threads);
+		EXPECT_EQ(threads, pool.size());
+
+		// 每个下标恰好执行一次
+		std::vector<int> hit(10007, 0);
+		pool.parallel_for(0, hit.size(), 64, [&](usize i) { hit[i]++; });
+		EXPECT_TRUE(std::all_of(hit.begin(), hit.end(), [](int x) { return x == 1; }));
+
+		// 区间形式，每段不超过grain
+		std::atomic<usize> total = 0, largest = 0;
+		pool.parallel_for(5, 1000, 37, [&](usize begin, usize end)
+		{
+			total += end - begin;
+			for(usize m = largest; end - begin > m && !largest.compare_exchange_weak(m, end - begin);) {}
+		});
+		EXPECT_EQ(995u, total.load());
+		EXPECT_TRUE(largest <= 37);
+
+		// 空区间
+		pool.parallel_for(3, 3, [&](usize) { total = 0; });
+		EXPECT_EQ(995u, total.load());
+
+		// 嵌套并行
+		std::vector<std::vector<int>> grid(64, std::vector<int>(64));
+		pool.parallel_for(0, 64, 1, [&](usize i)
+		{
+			pool.parallel_for(0, 64, 4, [&](usize j) { grid[i][j] = static_cast<int>(i * 64 + j); });
+		});
+		bool nested = true;
+		for(usize i = 0; i < 64; i++)
+			for(usize j = 0; j < 64; j++)
+				nested &= grid[i][j] == static_cast<int>(i * 64 + j);
+		EXPECT_TRUE(nested);
+
+		// 归约
+		const u64 sum = pool.parallel_reduce(0, 100001, 100, u64(0), [](usize i) { return u64(i); }, std::plus<u64>{});
+		EXPECT_EQ(u64(5000050000), sum);
+
+		std::vector<f32> values(100000);
+		for(usize i = 0; i < values.size(); i++) values[i] = 1.0f / static_cast<f32>(i + 1);
+		const auto partial = [&](usize begin, usize end) { return std::accumulate(values.begin() + begin, values.begin() + end, 0.0f); };
+		const f32 s1 = pool.parallel_reduce(0, values.size(), 1000, 0.0f, partial, std::plus<f32>{});
+		const f32 s2 = pool.parallel_reduce(0, values.size(), 1000, 0.0f, partial, std::plus<f32>{});
+		EXPECT_EQ(s1, s2);
+		EXPECT_NEAR(12.0901461f, s1, 1e-4f);
+
+		const f32 max_value = pool.parallel_reduce(0, values.size(), -INFINITY_<f32>, [&](usize i) { return values[i]; },
+		                                           [](f32 a, f32 b) { return std::max(a, b); });
+		EXPECT_EQ(1.0f, max_value);
+
+		// 异常传回调用者，线程池仍然可用
+		bool caught = false;
+		try
+		{
+			pool.parallel_for(0, 1000, 10, [](usize i) { if(i == 777) throw std::runtime_error("777"); });
+		}
+		catch(const std::runtime_error&)
+		{
+			caught = true;
+		}
+		EXPECT_TRUE(caught);
+
+		std::atomic<int> left = 0, right = 0;
+		pool.join([&] { left = 1; }, [&] { right = 2; });
+		EXPECT_EQ(3, left + right);
+	}
+
+	// 全局线程池
+	std::atomic<usize> count = 0;
+	parallel_for(0, 1000, [&](usize) { count++; });
+	EXPECT_EQ(1000u, count.load());
+	EXPECT_EQ(u64(499500), parallel_reduce(0, 1000, u64(0), [](usize i) { return u64(i); }, std::plus<u64>{}));
+}
+
+static void allocator_test()
+{
+	// 对齐和O(1)重置
+	{
+		Arena arena(1024);
+		void* a = arena.allocate(3, 1);
+		void* b = arena.allocate(8, 8);
+		void* c = arena.allocate(100, CACHE_LINE);
+		EXPECT_TRUE(reinterpret_cast<std::uintptr_t>(a) % CACHE_LINE == 0);
+		EXPECT_TRUE(reinterpret_cast<std::uintptr_t>(b) % 8 == 0 && b != a);
+		EXPECT_TRUE(reinterpret_cast<std::uintptr_t>(c) % CACHE_LINE == 0);
+		EXPECT_EQ(1u, arena.chunk_count());
+
+		// 超过块大小的请求单独一块
+		void* big = arena.allocate(5000, 256);
+		EXPECT_TRUE(reinterpret_cast<std::uintptr_t>(big) % 256 == 0);
+		EXPECT_EQ(2u, arena.chunk_count());
+
+		arena.reset();
+		EXPECT_EQ(a, arena.allocate(3, 1));
+
+		// 最后一次分配可以归还
+		void* d = arena.allocate(64, 16);
+		arena.deallocate(d, 64);
+		EXPECT_EQ(d, arena.allocate(64, 16));
+
+		struct Node { f32 x; i32 child; };
+		const Node* node = arena.create<Node>(Node{1.5f, 7});
+		EXPECT_TRUE(node->x == 1.5f && node->child == 7);
+	}
+
+	// 每帧重建时预热之后不再申请内存
+	{
+		Arena arena(4096);
+		usize chunks = 0, capacity = 0;
+		for(usize frame = 0; frame < 4; frame++)
+		{
+			arena.reset();
+			ArenaVector<Bounds3f> nodes(arena);
+			ArenaVector<u32> indices(arena);
+			ArenaDeque<Ray3f> queue(arena);
+			for(u32 i = 0; i < 3000; i++)
+			{
+				nodes.emplace_back(Point3f(static_cast<f32>(i)));
+				indices.push_back(i);
+				queue.emplace_back(Point3f(0.0f), Vector3f(0, 0, 1));
+			}
+			while(queue.size() > 10) queue.pop_front();
+			EXPECT_TRUE(reinterpret_cast<std::uintptr_t>(nodes.data()) % CACHE_LINE == 0);
+			EXPECT_EQ(2999u, indices.back());
+			if(frame == 1)
+			{
+				chunks = arena.chunk_count();
+				capacity = arena.capacity();
+			}
+			if(frame > 1)
+			{
+				EXPECT_EQ(chunks, arena.chunk_count());
+				EXPECT_EQ(capacity, arena.capacity());
+			}
+		}
+	}
+
+	// vector扩容的旧缓冲区收不回来，先reserve只占用最终的大小
+	{
+		Arena arena(64 * 1024);
+		{
+			ArenaVector<int> v(arena);
+			v.reserve(1000);
+			for(int i = 0; i < 1000; i++) v.push_back(i);
+			EXPECT_EQ(1000 * sizeof(int), arena.used());
+		}
+		arena.reset();
+		{
+			ArenaVector<int> v(arena);
+			for(int i = 0; i < 1000; i++) v.push_back(i);
+			EXPECT_TRUE(arena.used() > v.capacity() * sizeof(int));
+			EXPECT_TRUE(arena.used() <= 2 * v.capacity() * sizeof(int) + 11 * CACHE_LINE);
+		}
+	}
+
+	// 定长池
+	{
+		Pool<Vector3d> pool(4);
+		std::vector<Vector3d*> v;
+		for(usize i = 0; i < 10; i++) v.push_back(pool.create(static_cast<f64>(i), 0.0, 0.0));
+		EXPECT_EQ(12u, pool.capacity());
+		EXPECT_EQ(9.0, v[9]->x);
+
+		pool.destroy(v[3]);
+		EXPECT_EQ(v[3], pool.allocate());
+
+		pool.reset();
+		EXPECT_EQ(v[0], pool.allocate());
+		for(usize i = 1; i < 12; i++) pool.allocate();
+		EXPECT_EQ(12u, pool.capacity());
+		pool.allocate();
+		EXPECT_EQ(16u, pool.capacity());
+	}
+
+	// 每个线程使用自己的Arena
+	{
+		ThreadArenas arenas(1024);
+		ThreadPool pool(3);
+		std::vector<u32*> result(1000);
+		for(usize frame = 0; frame < 3; frame++)
+		{
+			arenas.reset();
+			pool.parallel_for(0, result.size(), 10, [&](usize i)
+			{
+				u32* p = arenas.local().allocate_array<u32>(4);
+				std::fill(p, p + 4, static_cast<u32>(i));
+				result[i] = p;
+			});
+			bool same = true;
+			for(usize i = 0; i < result.size(); i++)
+				same &= result[i][0] == i && result[i][3] == i;
+			EXPECT_TRUE(same);
+		}
+		EXPECT_TRUE(arenas.capacity() >= 1024);
+	}
+}
+
+static void bvh_test()
+{
+	// 随机的小三角形
+	PCG32 rng(7);
+	const usize n = 2000;
+	std::vector<f32> vx, vy, vz;
+	std::vector<std::array<std::uint32_t, 3>> triangles;
+	std::vector<Bounds3f> bounds;
+	for(usize i = 0; i < n; i++)
+	{
+		const Point3f c{rng.get<f32>() * 20 - 10, rng.get<f32>() * 20 - 10, rng.get<f32>() * 20 - 10};
+		Bounds3f b(c);
+		for(usize k = 0; k < 3; k++)
+		{
+			const Point3f p = c + Vector3f{rng.get<f32>() - 0.5f, rng.get<f32>() - 0.5f, rng.get<f32>() - 0.5f};
+			vx.push_back(p.x); vy.push_back(p.y); vz.push_back(p.z);
+			b = Union(b, p);
+		}
+		const auto v = static_cast<std::uint32_t>(3 * i);
+		triangles.push_back({v, v + 1, v + 2});
+		bounds.push_back(b);
+	}
+
+	const BVH bvh = BVH::build(bounds);
+	EXPECT_TRUE(bvh.nodes.size() < 2 * n);
+	std::vector<std::uint32_t> sorted = bvh.indices;
+	std::sort(sorted.begin(), sorted.end());
+	bool permutation = sorted.size() == n;
+	for(usize i = 0; i < sorted.size(); i++) permutation &= sorted[i] == i;
+	EXPECT_TRUE(permutation);
+
+	SceneView scene;
+	scene.bvh = bvh.view();
+	scene.primitive_bounds = bounds;
+	scene.vertices = Point3SoA<const f32>(vx, vy, vz);
+	scene.triangles = triangles;
+
+	// 和逐个求交的结果一致
+	std::vector<Ray3f> rays;
+	for(usize i = 0; i < 300; i++)
+	{
+		const Point3f o{rng.get<f32>() * 30 - 15, rng.get<f32>() * 30 - 15, -20};
+		const Point3f at{rng.get<f32>() * 20 - 10, rng.get<f32>() * 20 - 10, rng.get<f32>() * 20 - 10};
+		rays.emplace_back(o, (at - o).normalized());
+	}
+	const auto brute = [&](const Ray3f& ray)
+	{
+		f32 best = INFINITY_<f32>;
+		for(const auto& [a, b, c] : triangles)
+			best = std::min(best, Intersection::triangle(ray.origin, ray.direction, best, scene.vertices[a], scene.vertices[b], scene.vertices[c]));
+		return best;
+	};
+	usize hits = 0;
+	bool same = true;
+	for(const Ray3f& ray : rays)
+	{
+		const auto hit = scene.intersect(ray, INFINITY_<f32>);
+		const f32 expect = brute(ray);
+		same &= hit ? hit->t == expect : expect == INFINITY_<f32>;
+		hits += hit.has_value();
+	}
+	EXPECT_TRUE(same);
+	EXPECT_TRUE(hits > 30);
+
+	// t_max之外的交点不算
+	EXPECT_TRUE(!scene.intersect(rays[0], 1e-3f).has_value());
+
+	const auto path = std::filesystem::temp_directory_path() / "hinae_bvh_test.bin";
+	EXPECT_TRUE(write_scene(path, scene));
+	{
+		const auto file = SceneFile::open(path);
+		EXPECT_TRUE(file.has_value());
+		EXPECT_TRUE(file->verify());
+		const SceneView& mapped = file->view();
+		EXPECT_EQ(bvh.nodes.size(), mapped.bvh.nodes.size());
+		EXPECT_EQ(n, mapped.triangles.size());
+		EXPECT_TRUE(reinterpret_cast<std::uintptr_t>(mapped.bvh.nodes.data()) % SceneFormat::ALIGNMENT == 0);
+		EXPECT_TRUE(reinterpret_cast<std::uintptr_t>(mapped.vertices.x.data()) % SceneFormat::ALIGNMENT == 0);
+
+		// 映射之后直接遍历
+		bool mapped_same = true;
+		for(const Ray3f& ray : rays)
+		{
+			const auto a = scene.intersect(ray, INFINITY_<f32>), b = mapped.intersect(ray, INFINITY_<f32>);
+			mapped_same &= a.has_value() == b.has_value() && (!a || (a->t == b->t && a->index == b->index));
+		}
+		EXPECT_TRUE(mapped_same);
+
+		// 没有指针，拷到其他满足BASE_ALIGNMENT的地址上同样可以使用
+		static_assert(SceneFormat::BASE_ALIGNMENT == 4);
+		const usize size = std::filesystem::file_size(path);
+		std::vector<std::uint32_t> copy(size / 4 + 2);
+		auto* base = reinterpret_cast<std::byte*>(copy.data() + 1);   // 不是8字节对齐
+		std::ifstream(path, std::ios::binary).read(reinterpret_cast<char*>(base), static_cast<std::streamsize>(size));
+		const auto moved = SceneFormat::parse(std::span<const std::byte>(base, size));
+		EXPECT_TRUE(moved.has_value());
+		const auto hit = moved->intersect(rays[1], INFINITY_<f32>);
+		EXPECT_TRUE(hit.has_value() == scene.intersect(rays[1], INFINITY_<f32>).has_value());
+
+		std::memmove(base + 2, base, size);
+		EXPECT_TRUE(!SceneFormat::parse(std::span<const std::byte>(base + 2, size)).has_value());
+	}
+
+	// 写入失败时返回false，不留下临时文件
+	{
+		const auto missing = std::filesystem::temp_directory_path() / "hinae_missing_dir" / "scene.bin";
+		EXPECT_TRUE(!write_scene(missing, scene));
+		EXPECT_TRUE(!std::filesystem::exists(missing.parent_path()));
+
+		// 目标是非空目录，重命名失败
+		const auto dir = std::filesystem::temp_directory_path() / "hinae_bvh_dir";
+		std::filesystem::create_directories(dir / "child");
+		EXPECT_TRUE(!write_scene(dir, scene));
+		EXPECT_TRUE(std::none_of(std::filesystem::directory_iterator(dir.parent_path()), std::filesystem::directory_iterator{},
+		                         [](const auto& e) { return e.path().filename().string().starts_with("hinae_bvh_dir.tmp"); }));
+		std::filesystem::remove_all(dir);
+	}
+
+	// 损坏的文件
+	{
+		std::vector<std::byte> bytes(std::filesystem::file_size(path));
+		std::ifstream(path, std::ios::binary).read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+
+		const auto write = [&](const std::vector<std::byte>& b)
+		{
+			std::ofstream(path, std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(b.data()), static_cast<std::streamsize>(b.size()));
+		};
+
+		auto header = bytes;
+		header[offsetof(SceneFormat::Header, sections) + 8] ^= std::byte{1};
+		write(header);
+		EXPECT_TRUE(!SceneFile::open(path).has_value());
+
+		auto payload = bytes;
+		payload[payload.size() - 5] ^= std::byte{1};
+		write(payload);
+		const auto damaged = SceneFile::open(path);
+		EXPECT_TRUE(damaged.has_value() && !damaged->verify());
+
+		write({bytes.begin(), bytes.end() - 4});
+		EXPECT_TRUE(!SceneFile::open(path).has_value());
+	}
+	std::filesystem::remove(path);
+
+	// 全部重叠的图元也能建树
+	const std::vector<Bounds3f> same_box(100, Bounds3f({0, 0, 0}, {1, 1, 1}));
+	const BVH flat = BVH::build(same_box, 4);
+	const auto any = flat.view().intersect(Ray3f({0.5f, 0.5f, -1}, {0, 0, 1}), INFINITY_<f32>, [](std::uint32_t, f32) { return 1.0f; });
+	EXPECT_TRUE(any.has_value());
+	EXPECT_EQ(1.0f, any->t);
 }
 
 int main()
@@ -436,9 +2339,32 @@ int main()
 
 	quaternion_test();
 	bounds3_test();
+	bounds3_transform_test();
 	ray3_test();
 
+	constexpr_math_test();
+	equation_test();
+	intersection_test();
 	trigonometric_test();
+	fresnel_test();
+	fresnel_table_test();
+	spectrum_test();
+	coordinate_system_test();
+	f16_test();
+	octahedral_test();
+	quantize_test();
+	pcg_test();
+	xoshiro_test();
+	counter_rng_test();
+	low_discrepancy_test();
+	sampling_test();
+	microfacet_test();
+	distribution_test();
+	sample_table_test();
+	stats_test();
+	parallel_test();
+	allocator_test();
+	bvh_test();
 
 	TEST_RESULT();
 }
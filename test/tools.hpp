@@ -21,4 +21,8 @@ static int test_pass = 0;
 
 #define EXPECT_EQ(expect, actual) EXPECT_EQ_BASE(expect == actual, expect, actual)
 
+#define EXPECT_TRUE(actual) EXPECT_EQ_BASE((actual), true, false)
+
+#define EXPECT_NEAR(expect, actual, eps) EXPECT_EQ_BASE(std::abs((expect) - (actual)) <= (eps), expect, actual)
+
 #define TEST_RESULT() printf("%d/%d (%3.2f%%) passed\n", test_pass, test_count, test_pass * 100.0 / test_count)
\ No newline at end of file
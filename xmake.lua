@@ -11,3 +11,8 @@ set_warnings("all", "error")
 target("test")
     set_kind("binary")
     add_files("test/test.cpp")
+
+target("bench")
+    set_kind("binary")
+    set_optimize("fastest")
+    add_files("bench/bench.cpp")